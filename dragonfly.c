@@ -24,8 +24,13 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <string.h>
+#include <termios.h>
+#include <unistd.h>
 
 #include <devattr.h>
 #include <sys/mouse.h>
@@ -36,13 +41,14 @@
 #include "libinput-util.h"
 #include "filter.h"
 #include "libinput-private.h"
+#include "quirks.h"
 
 extern void	libinput_seat_init(struct libinput_seat *seat,
 		    struct libinput *libinput, const char *physical_name,
 		    const char *logical_name);
-extern void	sysmouse_device_dispatch(void *data);
-extern void	keyboard_device_dispatch(void *data);
-
+extern const struct libinput_device_interface sysmouse_interface;
+extern const struct libinput_device_interface keyboard_interface;
+extern const struct libinput_device_interface evdev_interface;
 
 static const char default_seat[] = "seat0";
 static const char default_seat_name[] = "default";
@@ -71,8 +77,17 @@ dragonfly_seat_get(struct libinput *libinput, const char *seat_name_physical,
 	return seat;
 }
 
+/* Serializes devattr calls that touch the udev context refcount */
+static pthread_mutex_t udev_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Safe to call from the probe threads: it doesn't log, errors are
+ * reported through errno. If dictp is given it is set to the device's
+ * property dictionary, released by the caller.
+ */
 static char *
-get_maj_min_driver(struct libinput *libinput, int major, int minor)
+get_maj_min_driver(struct libinput *libinput, int major, int minor,
+		   prop_dictionary_t *dictp)
 {
 	struct udev_enumerate *enumerate;
 	struct udev_list_entry *current;
@@ -80,14 +95,13 @@ get_maj_min_driver(struct libinput *libinput, int major, int minor)
 	prop_dictionary_t dict;
 	char buf1[16], buf2[16];
 	char *str = NULL;
-	int ret;
+	int ret, error = ENOENT;
 
+	pthread_mutex_lock(&udev_lock);
 	enumerate = udev_enumerate_new(libinput->udev_ctx);
-	if (enumerate == NULL) {
-		log_error(libinput, "udev_enumerate_new() failed (%s)\n",
-		    strerror(errno));
+	pthread_mutex_unlock(&udev_lock);
+	if (enumerate == NULL)
 		return NULL;
-	}
 
 	memset(buf1, 0, sizeof(buf1));
 	memset(buf2, 0, sizeof(buf2));
@@ -98,67 +112,674 @@ get_maj_min_driver(struct libinput *libinput, int major, int minor)
 
 	ret = udev_enumerate_scan_devices(enumerate);
 	if (ret == -1) {
-		log_error(libinput,
-		    "udev_enumerate_scan_devices failed (%s)\n",
-		    strerror(errno));
-		udev_enumerate_unref(enumerate);
-		return NULL;
+		error = errno;
+		goto out;
 	}
 
 	current = udev_enumerate_get_list_entry(enumerate);
-	if (current == NULL) {
-		log_info(libinput, "No devices found via udev.\n");
-	} else {
-		udev_list_entry_foreach(current, current) {
-			dev = udev_list_entry_get_device(current);
-			if (dev == NULL)
-				continue;
-			dict = udev_device_get_dictionary(dev);
-			if (dict == NULL)
-				continue;
-			if (str != NULL) {
-				free(str);
-				break;
-			}
-			str = prop_string_cstring(prop_dictionary_get(dict,
-			    "driver"));
-			if (str == NULL)
-				break;
-			log_info(libinput,
-			    "major: %d, minor: %d for driver %s\n",
-			    major, minor, str);
+	udev_list_entry_foreach(current, current) {
+		dev = udev_list_entry_get_device(current);
+		if (dev == NULL)
+			continue;
+		dict = udev_device_get_dictionary(dev);
+		if (dict == NULL)
+			continue;
+		if (str != NULL) {
+			/* Ambiguous major/minor */
+			free(str);
+			str = NULL;
+			error = EEXIST;
+			break;
+		}
+		str = prop_string_cstring(prop_dictionary_get(dict,
+		    "driver"));
+		if (str == NULL)
+			break;
+		if (dictp != NULL) {
+			prop_object_retain(dict);
+			*dictp = dict;
 		}
 	}
 
+out:
+	pthread_mutex_lock(&udev_lock);
 	udev_enumerate_unref(enumerate);
+	pthread_mutex_unlock(&udev_lock);
+
+	if (str == NULL) {
+		if (dictp != NULL && *dictp != NULL) {
+			prop_object_release(*dictp);
+			*dictp = NULL;
+		}
+		errno = error;
+	}
 
 	return str;
 }
 
+static const char evdev_path_prefix[] = "/dev/input/event";
+
+/* Discard whatever the kernel has buffered for the device */
+static void
+dragonfly_device_drain(struct libinput_device *device)
+{
+	char buf[512];
+
+	/* Both sysmouse and the syscons keyboard are ttys, flushing the
+	 * input queue is a single syscall. Fall back to reading it empty,
+	 * evdev nodes need that. */
+	if (tcflush(device->fd, TCIFLUSH) == 0)
+		return;
+
+	while (read(device->fd, buf, sizeof(buf)) > 0)
+		;
+}
+
+static uint32_t
+dragonfly_sendevents_get_modes(struct libinput_device *device)
+{
+	return LIBINPUT_CONFIG_SEND_EVENTS_DISABLED;
+}
+
+static enum libinput_config_status
+dragonfly_sendevents_set_mode(struct libinput_device *device,
+			      enum libinput_config_send_events_mode mode)
+{
+	struct libinput *libinput = device->seat->libinput;
+
+	/* DISABLED overrides any other bits */
+	if (mode & LIBINPUT_CONFIG_SEND_EVENTS_DISABLED)
+		mode = LIBINPUT_CONFIG_SEND_EVENTS_DISABLED;
+
+	if (mode == device->sendevents_mode)
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	/* Suspended, libinput_resume() applies the mode */
+	if (device->fd == -1) {
+		switch (mode) {
+		case LIBINPUT_CONFIG_SEND_EVENTS_ENABLED:
+		case LIBINPUT_CONFIG_SEND_EVENTS_DISABLED:
+			device->sendevents_mode = mode;
+			return LIBINPUT_CONFIG_STATUS_SUCCESS;
+		default:
+			return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+		}
+	}
+
+	switch (mode) {
+	case LIBINPUT_CONFIG_SEND_EVENTS_ENABLED:
+		/* Whatever arrived while disabled is stale */
+		dragonfly_device_drain(device);
+		if (device->interface->reset)
+			device->interface->reset(device);
+
+		device->source = libinput_add_fd(libinput, device->fd,
+		    device->interface->dispatch, device);
+		if (!device->source) {
+			log_error(libinput,
+				  "failed to re-enable %s\n",
+				  device->devname);
+			return LIBINPUT_CONFIG_STATUS_INVALID;
+		}
+		break;
+	case LIBINPUT_CONFIG_SEND_EVENTS_DISABLED:
+		/*
+		 * Stop polling the fd so the device no longer wakes us up,
+		 * and leave the device in a neutral state: anything still
+		 * held is released now, the matching kernel events are
+		 * never read.
+		 */
+		libinput_remove_source(libinput, device->source);
+		device->source = NULL;
+
+		device->interface->suspend(device, libinput_now(libinput));
+
+		dragonfly_device_drain(device);
+		break;
+	default:
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+	}
+
+	device->sendevents_mode = mode;
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+static enum libinput_config_send_events_mode
+dragonfly_sendevents_get_mode(struct libinput_device *device)
+{
+	return device->sendevents_mode;
+}
+
+static enum libinput_config_send_events_mode
+dragonfly_sendevents_get_default_mode(struct libinput_device *device)
+{
+	return LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+}
+
+static struct libinput_device_config_send_events dragonfly_sendevents = {
+	&dragonfly_sendevents_get_modes,
+	&dragonfly_sendevents_set_mode,
+	&dragonfly_sendevents_get_mode,
+	&dragonfly_sendevents_get_default_mode
+};
+
+static struct libinput_device *
+dragonfly_device_create(struct libinput *libinput, const char *path);
+
+static void
+dragonfly_device_remove(struct libinput_device *device);
+
+static struct libinput_device *
+dragonfly_device_find(struct libinput *libinput, const char *path)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (!device->removed && streq(device->devname, path))
+				return device;
+		}
+	}
+
+	return NULL;
+}
+
+/* devattr reports device nodes relative to /dev */
+static bool
+dragonfly_udev_device_path(struct udev_device *udev_device, char *path,
+			   size_t len)
+{
+	const char *devnode;
+	int n;
+
+	devnode = udev_device_get_devnode(udev_device);
+	if (devnode == NULL)
+		return false;
+
+	if (devnode[0] == '/')
+		n = snprintf(path, len, "%s", devnode);
+	else
+		n = snprintf(path, len, "/dev/%s", devnode);
+
+	return n > 0 && (size_t)n < len;
+}
+
+static void
+dragonfly_udev_device_added(struct libinput *libinput, const char *path)
+{
+	struct libinput_device *device;
+
+	if (dragonfly_device_find(libinput, path) != NULL)
+		return;
+
+	device = dragonfly_device_create(libinput, path);
+	if (device == NULL)
+		return;
+
+	log_info(libinput, "input device '%s' added\n", path);
+	notify_added_device(device);
+}
+
+/*
+ * The node is gone, either reported by devattr or found by a backend
+ * reading EOF or an error from it. Backends call this from their
+ * dispatch and must not touch the device state afterwards.
+ */
 void
-dragonfly_libinput_destroy(struct libinput *libinput)
+dragonfly_device_lost(struct libinput_device *device)
 {
-	udev_unref(libinput->udev_ctx);
+	struct libinput *libinput = device->seat->libinput;
+
+	log_info(libinput, "input device '%s' removed\n", device->devname);
+
+	/* What the device held is released before the removed event, the
+	 * reference keeps it from being retired ahead of that event */
+	libinput_device_ref(device);
+	dragonfly_device_remove(device);
+	notify_removed_device(device);
+	libinput_device_unref(device);
 }
 
-struct libinput *
-libinput_udev_create_context(const struct libinput_interface *interface,
-	void *user_data, struct udev *udev)
+static void
+dragonfly_udev_device_removed(struct libinput *libinput, const char *path)
 {
+	struct libinput_device *device;
+
+	device = dragonfly_device_find(libinput, path);
+	if (device != NULL)
+		dragonfly_device_lost(device);
+}
+
+static void
+dragonfly_udev_monitor_dispatch(void *data)
+{
+	struct libinput *libinput = data;
+	struct udev_device *udev_device;
+	const char *action;
+	char path[PATH_MAX];
+
+	udev_device = udev_monitor_receive_device(libinput->udev_monitor);
+	if (udev_device == NULL)
+		return;
+
+	action = udev_device_get_action(udev_device);
+	if (action != NULL &&
+	    dragonfly_udev_device_path(udev_device, path, sizeof(path))) {
+		if (streq(action, "attach"))
+			dragonfly_udev_device_added(libinput, path);
+		else if (streq(action, "detach"))
+			dragonfly_udev_device_removed(libinput, path);
+	}
+
+	udev_device_unref(udev_device);
+}
+
+static int
+dragonfly_udev_enable_monitor(struct libinput *libinput)
+{
+	static char sysmouse_driver[] = "sysmouse";
+	int fd;
+
+	libinput->udev_monitor = udev_monitor_new(libinput->udev_ctx);
+	if (libinput->udev_monitor == NULL) {
+		log_error(libinput, "udev_monitor_new() failed (%s)\n",
+			  strerror(errno));
+		return -1;
+	}
+
+	udev_monitor_filter_add_match_expr(libinput->udev_monitor, "driver",
+					   sysmouse_driver);
+
+	if (udev_monitor_enable_receiving(libinput->udev_monitor) != 0) {
+		log_error(libinput, "failed to bind the udev monitor\n");
+		goto err;
+	}
+
+	fd = udev_monitor_get_fd(libinput->udev_monitor);
+	libinput->udev_monitor_source = libinput_add_fd(libinput, fd,
+	    dragonfly_udev_monitor_dispatch, libinput);
+	if (libinput->udev_monitor_source == NULL)
+		goto err;
+
+	return 0;
+
+err:
+	udev_monitor_unref(libinput->udev_monitor);
+	libinput->udev_monitor = NULL;
+	return -1;
+}
+
+static void
+dragonfly_udev_disable_monitor(struct libinput *libinput)
+{
+	if (libinput->udev_monitor_source != NULL) {
+		libinput_remove_source(libinput,
+				       libinput->udev_monitor_source);
+		libinput->udev_monitor_source = NULL;
+	}
+
+	if (libinput->udev_monitor != NULL) {
+		udev_monitor_unref(libinput->udev_monitor);
+		libinput->udev_monitor = NULL;
+	}
+}
+
+static void
+dragonfly_udev_scan_devices(struct libinput *libinput)
+{
+	static char sysmouse_driver[] = "sysmouse";
+	struct udev_enumerate *enumerate;
+	struct udev_list_entry *current;
+	struct udev_device *dev;
+	char path[PATH_MAX];
+	const char *tty;
+
+	enumerate = udev_enumerate_new(libinput->udev_ctx);
+	if (enumerate == NULL) {
+		log_error(libinput, "udev_enumerate_new() failed (%s)\n",
+		    strerror(errno));
+		return;
+	}
+
+	udev_enumerate_add_match_expr(enumerate, "driver", sysmouse_driver);
+
+	if (udev_enumerate_scan_devices(enumerate) == -1) {
+		log_error(libinput,
+		    "udev_enumerate_scan_devices failed (%s)\n",
+		    strerror(errno));
+	} else {
+		current = udev_enumerate_get_list_entry(enumerate);
+		udev_list_entry_foreach(current, current) {
+			dev = udev_list_entry_get_device(current);
+			if (dev == NULL)
+				continue;
+			if (dragonfly_udev_device_path(dev, path,
+						       sizeof(path)))
+				dragonfly_udev_device_added(libinput, path);
+		}
+	}
+
+	udev_enumerate_unref(enumerate);
+
 	/*
-	 * We do not support udev, hence creating a context from udev will
-	 * fail.
+	 * The syscons keyboard is only readable through the VT we run on,
+	 * so the keyboard is our controlling terminal, not every sc node.
 	 */
-	return NULL;
+	tty = ttyname(STDIN_FILENO);
+	if (tty != NULL)
+		dragonfly_udev_device_added(libinput, tty);
+	else
+		log_info(libinput, "not on a tty, no keyboard added\n");
 }
 
-int
+LIBINPUT_EXPORT struct libinput *
+libinput_udev_create_context(const struct libinput_interface *interface,
+	void *user_data, struct udev *udev)
+{
+	struct libinput *libinput;
+
+	if (!interface || !udev)
+		return NULL;
+
+	libinput = calloc(1, sizeof(*libinput));
+	if (libinput == NULL)
+		return NULL;
+
+	if (libinput_init(libinput, interface, user_data) != 0) {
+		free(libinput);
+		return NULL;
+	}
+
+	libinput->udev_ctx = udev_ref(udev);
+
+	return libinput;
+}
+
+LIBINPUT_EXPORT int
 libinput_udev_assign_seat(struct libinput *libinput, const char *seat_id)
 {
+	if (libinput->udev_seat_assigned)
+		return -1;
+
 	/* Multiseat is not supported. */
+	if (!streq(seat_id, default_seat)) {
+		log_error(libinput, "unsupported seat '%s'\n", seat_id);
+		return -1;
+	}
+
+	/* Subscribe before scanning, a device attached in between would
+	 * otherwise be missed. Duplicates are filtered on the path. */
+	if (dragonfly_udev_enable_monitor(libinput) != 0)
+		return -1;
+
+	dragonfly_udev_scan_devices(libinput);
+	libinput->udev_seat_assigned = true;
+
+	return 0;
+}
+
+#define DRAGONFLY_POOL_THREADS 4
+
+struct dragonfly_pool {
+	void (*func)(void *job);
+	char *jobs;
+	size_t jobsize;
+	int njobs;
+	int next;
+	pthread_mutex_t lock;
+};
+
+static void *
+dragonfly_pool_worker(void *data)
+{
+	struct dragonfly_pool *pool = data;
+	int i;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		i = pool->next++;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (i >= pool->njobs)
+			break;
+
+		pool->func(pool->jobs + i * pool->jobsize);
+	}
+
+	return NULL;
+}
+
+/*
+ * Run func on every element of jobs on a small thread pool, the calling
+ * thread takes part. The jobs must not log or touch the context beyond
+ * open_restricted(), which may be an IPC round trip to a seat manager
+ * and is what we are parallelizing in the first place.
+ */
+static void
+dragonfly_run_parallel(void (*func)(void *job), void *jobs, size_t jobsize,
+		       int njobs)
+{
+	struct dragonfly_pool pool;
+	pthread_t threads[DRAGONFLY_POOL_THREADS - 1];
+	int i, nthreads;
+
+	pool.func = func;
+	pool.jobs = jobs;
+	pool.jobsize = jobsize;
+	pool.njobs = njobs;
+	pool.next = 0;
+	pthread_mutex_init(&pool.lock, NULL);
+
+	nthreads = min(njobs, DRAGONFLY_POOL_THREADS) - 1;
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&threads[i], NULL, dragonfly_pool_worker,
+				   &pool) != 0)
+			break;
+	}
+	nthreads = i;
+
+	dragonfly_pool_worker(&pool);
+
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&pool.lock);
+}
+
+struct dragonfly_open_job {
+	struct libinput *libinput;
+	const char *path;
+	int fd;
+};
+
+static void
+dragonfly_open_job_run(void *data)
+{
+	struct dragonfly_open_job *job = data;
+
+	job->fd = open_restricted(job->libinput, job->path,
+				  O_RDWR | O_NONBLOCK | O_CLOEXEC);
+}
+
+static void
+dragonfly_device_suspend(struct libinput_device *device, uint64_t time)
+{
+	struct libinput *libinput = device->seat->libinput;
+
+	if (device->fd == -1)
+		return;
+
+	if (device->source) {
+		libinput_remove_source(libinput, device->source);
+		device->source = NULL;
+	}
+
+	/* Whatever is held now will be released before we see it again */
+	device->interface->suspend(device, time);
+
+	device->interface->destroy(device);
+	close_restricted(libinput, device->fd);
+	device->fd = -1;
+}
+
+static int
+dragonfly_device_resume(struct libinput_device *device, int fd,
+			uint64_t time)
+{
+	struct libinput *libinput = device->seat->libinput;
+
+	if (fd < 0) {
+		log_info(libinput,
+			 "reopening input device '%s' failed (%s).\n",
+			 device->devname, strerror(-fd));
+		return -1;
+	}
+
+	device->fd = fd;
+
+	/* Anything queued before the switch back is stale */
+	dragonfly_device_drain(device);
+
+	if (device->interface->init(device) != 0)
+		goto err;
+
+	if (device->filter)
+		filter_restart(device->filter, device, time);
+
+	if (device->sendevents_mode == LIBINPUT_CONFIG_SEND_EVENTS_ENABLED) {
+		device->source = libinput_add_fd(libinput, fd,
+		    device->interface->dispatch, device);
+		if (!device->source) {
+			device->interface->destroy(device);
+			goto err;
+		}
+	}
+
+	return 0;
+
+err:
+	close_restricted(libinput, device->fd);
+	device->fd = -1;
 	return -1;
 }
 
+void
+dragonfly_libinput_suspend(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	uint64_t now;
+
+	if (libinput->suspended)
+		return;
+
+	/* Hotplug events stay queued on the monitor until we resume */
+	if (libinput->udev_monitor_source != NULL) {
+		libinput_remove_source(libinput,
+				       libinput->udev_monitor_source);
+		libinput->udev_monitor_source = NULL;
+	}
+
+	now = libinput_now(libinput);
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (!device->removed)
+				dragonfly_device_suspend(device, now);
+		}
+	}
+
+	libinput->suspended = true;
+}
+
+int
+dragonfly_libinput_resume(struct libinput *libinput)
+{
+	struct dragonfly_open_job *jobs;
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	uint64_t start, now;
+	int i, njobs = 0, nfailed = 0;
+
+	if (!libinput->suspended)
+		return 0;
+
+	start = libinput_now(libinput);
+
+	if (libinput->udev_monitor != NULL) {
+		libinput->udev_monitor_source = libinput_add_fd(libinput,
+		    udev_monitor_get_fd(libinput->udev_monitor),
+		    dragonfly_udev_monitor_dispatch, libinput);
+		if (libinput->udev_monitor_source == NULL)
+			return -1;
+	}
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (!device->removed)
+				njobs++;
+		}
+	}
+
+	libinput->suspended = false;
+	if (njobs == 0)
+		return 0;
+
+	jobs = calloc(njobs, sizeof(*jobs));
+	if (jobs == NULL) {
+		libinput->suspended = true;
+		return -1;
+	}
+
+	i = 0;
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (device->removed)
+				continue;
+			jobs[i].libinput = libinput;
+			jobs[i].path = device->devname;
+			i++;
+		}
+	}
+
+	dragonfly_run_parallel(dragonfly_open_job_run, jobs, sizeof(*jobs),
+			       njobs);
+
+	now = libinput_now(libinput);
+	i = 0;
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (device->removed)
+				continue;
+			/* Unplugged while suspended or no longer usable,
+			 * the caller sees it go instead of a dead device */
+			if (dragonfly_device_resume(device, jobs[i].fd,
+						    now) != 0) {
+				dragonfly_device_lost(device);
+				nfailed++;
+			}
+			i++;
+		}
+	}
+
+	free(jobs);
+
+	log_debug(libinput,
+		  "resumed %d of %d devices in %" PRIu64 "us (open %" PRIu64 "us)\n",
+		  njobs - nfailed, njobs,
+		  libinput_now(libinput) - start, now - start);
+
+	return nfailed == njobs ? -1 : 0;
+}
+
+void
+dragonfly_libinput_destroy(struct libinput *libinput)
+{
+	dragonfly_udev_disable_monitor(libinput);
+	udev_unref(libinput->udev_ctx);
+}
 
 LIBINPUT_EXPORT struct libinput *
 libinput_path_create_context(const struct libinput_interface *interface,
@@ -187,60 +808,128 @@ libinput_path_create_context(const struct libinput_interface *interface,
 	return libinput;
 }
 
-extern struct libinput_device_config_accel sysmouse_accel;
-extern int sysmouse_init_accel(struct libinput_device *device,
-			       enum libinput_config_accel_profile which);
+/* Everything done for a device before it is committed to the seat */
+struct dragonfly_probe {
+	struct libinput *libinput;
+	const char *path;
+	const struct libinput_device_interface *interface;
+	char *driver;
+	struct device_quirks quirks;
+	int fd;
+	int error;		/* errno of the failed step */
+	enum {
+		PROBE_OK,
+		PROBE_STAT,
+		PROBE_DRIVER,
+		PROBE_UNSUPPORTED,
+		PROBE_OPEN,
+	} failed;
+	uint64_t start, end;	/* microseconds */
+};
 
-LIBINPUT_EXPORT struct libinput_device *
-libinput_path_add_device(struct libinput *libinput,
-	const char *path)
+/* Doesn't log, may run on a pool thread */
+static void
+dragonfly_device_probe(void *data)
 {
+	struct dragonfly_probe *probe = data;
+	struct libinput *libinput = probe->libinput;
+	prop_dictionary_t props = NULL;
+	struct stat sb;
+
+	probe->start = libinput_now(libinput);
+	probe->fd = -1;
+	probe->failed = PROBE_OK;
+
+	if (stat(probe->path, &sb) != 0) {
+		probe->error = errno;
+		probe->failed = PROBE_STAT;
+		goto out;
+	}
+
+	/* evdev nodes are recognized by name, no devattr lookup needed */
+	if (strncmp(probe->path, evdev_path_prefix,
+		    sizeof(evdev_path_prefix) - 1) == 0) {
+		probe->interface = &evdev_interface;
+		probe->driver = strdup("evdev");
+		goto open;
+	}
+
+	probe->driver = get_maj_min_driver(libinput, major(sb.st_rdev),
+	    minor(sb.st_rdev), &props);
+	if (probe->driver == NULL) {
+		probe->error = errno;
+		probe->failed = PROBE_DRIVER;
+		goto out;
+	}
+	if (strcmp(probe->driver, "sc") == 0) {
+		probe->interface = &keyboard_interface;
+	} else if (strcmp(probe->driver, "sysmouse") == 0) {
+		probe->interface = &sysmouse_interface;
+	} else if (strcmp(probe->driver, "evdev") == 0) {
+		probe->interface = &evdev_interface;
+	} else {
+		probe->failed = PROBE_UNSUPPORTED;
+		goto out;
+	}
+
+open:
+	quirks_db_lookup(libinput->quirks, probe->driver, props,
+			 &probe->quirks);
+
+	probe->fd = open_restricted(libinput, probe->path,
+				    O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (probe->fd < 0) {
+		probe->error = -probe->fd;
+		probe->failed = PROBE_OPEN;
+	}
+
+out:
+	if (props != NULL)
+		prop_object_release(props);
+	probe->end = libinput_now(libinput);
+}
+
+static struct libinput_device *
+dragonfly_device_commit(struct dragonfly_probe *probe)
+{
+	struct libinput *libinput = probe->libinput;
 	struct libinput_seat *seat = NULL;
 	struct libinput_device *device;
-	struct stat sb;
-	enum devkind kind;
-	char *driver;
-	int fd, level;
+	const char *path = probe->path;
+	int fd = probe->fd;
 
-	if (stat(path, &sb) != 0) {
+	switch (probe->failed) {
+	case PROBE_OK:
+		break;
+	case PROBE_STAT:
 		log_info(libinput,
 			 "stat for input device '%s' failed (%s).\n",
-			 path, strerror(errno));
+			 path, strerror(probe->error));
 		return NULL;
-	}
-
-	driver = get_maj_min_driver(libinput, major(sb.st_rdev),
-	    minor(sb.st_rdev));
-	if (driver == NULL) {
+	case PROBE_DRIVER:
 		log_error(libinput,
 			 "failed to get driver of input device '%s' (%s).\n",
-			 path, strerror(errno));
+			 path, strerror(probe->error));
 		return NULL;
-	}
-	if (strcmp(driver, "sc") == 0) {
-		kind = TTYKBD;
-	} else if (strcmp(driver, "sysmouse") == 0) {
-		kind = SYSMOUSE;
-	} else {
+	case PROBE_UNSUPPORTED:
 		log_error(libinput, "unsupported device driver \"%s\"\n",
-			  driver);
-		free(driver);
+			  probe->driver);
 		return NULL;
-	}
-	free(driver);
-
-	fd = open_restricted(libinput, path,
-			     O_RDWR | O_NONBLOCK | O_CLOEXEC);
-	if (fd < 0) {
+	case PROBE_OPEN:
 		log_info(libinput,
 			 "opening input device '%s' failed (%s).\n",
-			 path, strerror(-fd));
+			 path, strerror(probe->error));
 		return NULL;
 	}
 
+	log_info(libinput, "input device '%s' uses driver %s\n",
+		 path, probe->driver);
+
 	device = calloc(1, sizeof(*device));
-	if (device == NULL)
+	if (device == NULL) {
+		close_restricted(libinput, fd);
 		return NULL;
+	}
 
 	/* Only one (default) seat is supported. */
 	seat = dragonfly_seat_get(libinput, default_seat, default_seat_name);
@@ -254,89 +943,162 @@ libinput_path_add_device(struct libinput *libinput,
 	if (device->devname == NULL)
 		goto err;
 
-	device->kind = kind;
+	device->interface = probe->interface;
+	device->quirks = probe->quirks;
+	device->sendevents_mode = LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+	device->config.sendevents = &dragonfly_sendevents;
 
-	if (device->kind == SYSMOUSE) {
-		level = 1;
-		ioctl(fd, MOUSE_SETLEVEL, &level);
-		device->source =
-			libinput_add_fd(libinput, fd, sysmouse_device_dispatch,
-			    device);
-		if (!device->source)
-			goto err;
-		if (sysmouse_init_accel(device,
-		    LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE) == -1) {
-			log_error(libinput,
-				  "failed to initialize pointer acceleration for %s\n",
-				  device->devname);
-			libinput_remove_source(libinput, device->source);
-			goto err;
-		}
-	} else if (device->kind == TTYKBD) {
-		device->kbdst = kbdev_new_state(fd);
-		if (device->kbdst == NULL)
-			goto err;
-		device->source =
-			libinput_add_fd(libinput, fd, keyboard_device_dispatch,
-			    device);
-		if (!device->source) {
-			kbdev_destroy_state(device->kbdst);
-			goto err;
-		}
-	} else {
-		log_error(libinput, "unsupported device kind %d\n",
-			  device->kind);
+	if (device->interface->init(device) != 0)
+		goto err;
+
+	device->source = libinput_add_fd(libinput, fd,
+	    device->interface->dispatch, device);
+	if (!device->source) {
+		device->interface->destroy(device);
+		goto err;
+	}
+
+	if (device->interface->init_accel &&
+	    device->interface->init_accel(device,
+	    device->quirks.accel_profile ? device->quirks.accel_profile :
+	    LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE) == -1) {
+		log_error(libinput,
+			  "failed to initialize pointer acceleration for %s\n",
+			  device->devname);
+		libinput_remove_source(libinput, device->source);
+		device->interface->destroy(device);
 		goto err;
 	}
 
 	list_insert(&seat->devices_list, &device->link);
 
+	log_debug(libinput,
+		  "input device '%s' probed in %" PRIu64 "us, ready after %" PRIu64 "us\n",
+		  path, probe->end - probe->start,
+		  libinput_now(libinput) - probe->start);
+
 	return device;
 
 err:
-	close_restricted(libinput, device->fd);
+	close_restricted(libinput, fd);
+	event_queue_destroy(device->queue);
+	free(device->abs);
 	free(device->devname);
 	free(device);
 	return NULL;
 }
 
-LIBINPUT_EXPORT void
-libinput_path_remove_device(struct libinput_device *device)
+static struct libinput_device *
+dragonfly_device_create(struct libinput *libinput, const char *path)
+{
+	struct libinput_device *device;
+	struct dragonfly_probe probe = {
+		.libinput = libinput,
+		.path = path,
+	};
+
+	dragonfly_device_probe(&probe);
+	device = dragonfly_device_commit(&probe);
+	free(probe.driver);
+
+	return device;
+}
+
+static void
+dragonfly_device_remove(struct libinput_device *device)
 {
 	struct libinput *libinput = device->seat->libinput;
 
-	libinput_remove_source(libinput, device->source);
+	/*
+	 * The caller or unread events may keep the device around, it stays
+	 * on the seat's list but suspend, resume and lookups skip it.
+	 */
+	if (device->removed)
+		return;
+	device->removed = true;
+
+	/* A disabled device has no source */
+	if (device->source)
+		libinput_remove_source(libinput, device->source);
 	device->source = NULL;
 
-	if (device->kind == SYSMOUSE)
+	/* Lift touches, keys and tools, a suspended device already did */
+	if (device->fd != -1)
+		device->interface->suspend(device, libinput_now(libinput));
+
+	if (device->filter)
 		filter_destroy(device->filter);
+	device->filter = NULL;
 
-	if (device->kind == TTYKBD)
-		kbdev_destroy_state(device->kbdst);
+	device->interface->destroy(device);
 
-	close_restricted(libinput, device->fd);
+	/* A suspended device has no fd */
+	if (device->fd != -1)
+		close_restricted(libinput, device->fd);
 	device->fd = -1;
 
 	libinput_device_unref(device);
 }
 
+LIBINPUT_EXPORT struct libinput_device *
+libinput_path_add_device(struct libinput *libinput,
+	const char *path)
+{
+	return dragonfly_device_create(libinput, path);
+}
+
+LIBINPUT_EXPORT int
+libinput_path_add_devices(struct libinput *libinput,
+			  const char * const *paths,
+			  struct libinput_device **devices,
+			  int ndevices)
+{
+	struct dragonfly_probe *probes;
+	struct libinput_device *device;
+	int i, nadded = 0;
+
+	if (ndevices <= 0)
+		return 0;
+
+	probes = calloc(ndevices, sizeof(*probes));
+	if (probes == NULL)
+		return -1;
+
+	for (i = 0; i < ndevices; i++) {
+		probes[i].libinput = libinput;
+		probes[i].path = paths[i];
+	}
+
+	dragonfly_run_parallel(dragonfly_device_probe, probes,
+			       sizeof(*probes), ndevices);
+
+	/* Commit in the caller's order so the seat's device list is
+	 * the same as with a sequence of libinput_path_add_device */
+	for (i = 0; i < ndevices; i++) {
+		device = dragonfly_device_commit(&probes[i]);
+		free(probes[i].driver);
+		if (devices)
+			devices[i] = device;
+		if (device)
+			nadded++;
+	}
+
+	free(probes);
+
+	return nadded;
+}
+
+LIBINPUT_EXPORT void
+libinput_path_remove_device(struct libinput_device *device)
+{
+	dragonfly_device_remove(device);
+}
+
 
 LIBINPUT_EXPORT void
 libinput_device_led_update(struct libinput_device *device,
 	enum libinput_led leds)
 {
-	if (device->kind == TTYKBD) {
-		int mask = 0;
-		/*
-		 * XXX We could directly use leds as mask, but this should
-		 *     be better for future proofing the code.
-		 */
-		if (leds & LIBINPUT_LED_NUM_LOCK)
-			mask |= (1 << 0);
-		if (leds & LIBINPUT_LED_CAPS_LOCK)
-			mask |= (1 << 1);
-		if (leds & LIBINPUT_LED_SCROLL_LOCK)
-			mask |= (1 << 2);
-		kbdev_set_leds(device->kbdst, mask);
-	}
+	if (device->interface->led_update)
+		device->interface->led_update(device, leds);
 }
@@ -0,0 +1,1357 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+
+#include "evdev.h"
+#include "libinput.h"
+#include "libinput-util.h"
+#include "filter.h"
+#include "libinput-private.h"
+#include "gesture.h"
+
+extern void dragonfly_device_lost(struct libinput_device *device);
+extern struct motion_filter *pointer_create_accel_filter(
+	enum libinput_config_accel_profile which, int dpi);
+extern int device_init_pointer_acceleration(struct libinput_device *device,
+	struct motion_filter *filter);
+
+#define EVDEV_NBUTTONS		(EVDEV_BTN_TASK - EVDEV_BTN_MOUSE + 1)
+#define EVDEV_MAX_SLOTS		16
+#define EVDEV_NTOOLS		(EVDEV_BTN_TOOL_LENS - EVDEV_BTN_TOOL_PEN + 1)
+#define EVDEV_NTOOL_BUTTONS	6
+/* ABS_PRESSURE to ABS_TILT_Y */
+#define EVDEV_TABLET_NAXES	(ABS_TILT_Y - ABS_PRESSURE + 1)
+
+enum evdev_touch {
+	EVDEV_TOUCH_NONE,
+	EVDEV_TOUCH_SINGLE,	/* BTN_TOUCH and ABS_X/ABS_Y, one slot */
+	EVDEV_TOUCH_MT,		/* multitouch protocol B */
+};
+
+/* One contact, changes are applied on SYN_REPORT */
+struct evdev_slot {
+	bool active;		/* down as far as the caller knows */
+	bool down_pending;
+	bool up_pending;
+	bool dirty;		/* moved */
+	int32_t seat_slot;
+	struct device_coords point;
+};
+
+struct evdev_tablet {
+	unsigned int tools;		/* bits of BTN_TOOL_* down */
+	uint32_t serial;		/* MSC_SERIAL */
+	uint32_t tool_id;		/* ABS_MISC */
+	bool tip;
+	unsigned int buttons;		/* bits of evdev_tool_button_map */
+	struct tablet_axes axes;
+	unsigned char changed[NCHARS(LIBINPUT_TABLET_TOOL_AXIS_MAX + 1)];
+
+	/*
+	 * As last reported. The tool is looked up once when it comes into
+	 * proximity and kept until it leaves, NULL while out of proximity.
+	 */
+	struct libinput_tablet_tool *tool;
+	bool tip_reported;
+	unsigned int buttons_reported;
+	struct device_coords point_reported;
+
+	unsigned char axis_caps[NCHARS(LIBINPUT_TABLET_TOOL_AXIS_MAX + 1)];
+	unsigned int button_caps;
+	struct input_absinfo absinfo[EVDEV_TABLET_NAXES];
+};
+
+struct evdev_state {
+	bool dropped;		/* discarding until the next SYN_REPORT */
+
+	/* Relative axes accumulated until the next SYN_REPORT */
+	bool rel_pointer;
+	int rel_x, rel_y;
+	int wheel, hwheel;
+
+	/* Absolute position, reported on SYN_REPORT if it changed */
+	bool abs_pointer;
+	struct device_coords abs;
+	bool abs_changed;
+
+	/* Touchscreen contacts, indexed by the kernel's slot */
+	enum evdev_touch touch;
+	bool touch_changed;
+	int slot;		/* current ABS_MT_SLOT, -1 if out of range */
+	int nslots;
+	struct evdev_slot slots[EVDEV_MAX_SLOTS];
+
+	/* Touchpad contacts go to the gesture recognizer instead */
+	bool touchpad;
+	struct gesture gesture;
+
+	/* Tablet tool, changes are applied on SYN_REPORT */
+	bool tablet;
+	struct evdev_tablet tablet_state;
+
+	unsigned char key_down[NCHARS(KEY_CNT)];
+	unsigned char button_down[NCHARS(EVDEV_NBUTTONS)];
+
+	/* Trailing bytes of a short read, only possible on pipes */
+	size_t npartial;
+	char partial[sizeof(struct input_event)];
+};
+
+/* evdev BTN_LEFT... in order, mapped to the <linux/input.h> shim */
+static const int evdev_button_map[EVDEV_NBUTTONS] = {
+	BTN_LEFT,
+	BTN_RIGHT,
+	BTN_MIDDLE,
+	BTN_SIDE,
+	BTN_EXTRA,
+	BTN_FORWARD,
+	BTN_BACK,
+	BTN_TASK,
+};
+
+/* BTN_TOOL_PEN... in order, BTN_TOOL_FINGER is not a tablet tool */
+static const enum libinput_tablet_tool_type evdev_tool_map[EVDEV_NTOOLS] = {
+	LIBINPUT_TABLET_TOOL_TYPE_PEN,
+	LIBINPUT_TABLET_TOOL_TYPE_ERASER,
+	LIBINPUT_TABLET_TOOL_TYPE_BRUSH,
+	LIBINPUT_TABLET_TOOL_TYPE_PENCIL,
+	LIBINPUT_TABLET_TOOL_TYPE_AIRBRUSH,
+	0,
+	LIBINPUT_TABLET_TOOL_TYPE_MOUSE,
+	LIBINPUT_TABLET_TOOL_TYPE_LENS,
+};
+
+/* Stylus and puck buttons, mapped to the <linux/input.h> shim */
+static const struct {
+	int code;
+	int button;
+} evdev_tool_button_map[EVDEV_NTOOL_BUTTONS] = {
+	{ EVDEV_BTN_STYLUS, BTN_STYLUS },
+	{ EVDEV_BTN_STYLUS2, BTN_STYLUS2 },
+	{ EVDEV_BTN_STYLUS3, BTN_STYLUS3 },
+	{ EVDEV_BTN_MOUSE, BTN_LEFT },
+	{ EVDEV_BTN_MOUSE + 1, BTN_RIGHT },
+	{ EVDEV_BTN_MOUSE + 2, BTN_MIDDLE },
+};
+
+/* ABS_PRESSURE... in order */
+static const enum libinput_tablet_tool_axis
+evdev_tablet_axis_map[EVDEV_TABLET_NAXES] = {
+	LIBINPUT_TABLET_TOOL_AXIS_PRESSURE,
+	LIBINPUT_TABLET_TOOL_AXIS_DISTANCE,
+	LIBINPUT_TABLET_TOOL_AXIS_TILT_X,
+	LIBINPUT_TABLET_TOOL_AXIS_TILT_Y,
+};
+
+static uint64_t
+evdev_event_time(const struct input_event *ev)
+{
+	return s2us(ev->time.tv_sec) + ev->time.tv_usec;
+}
+
+/* Fold the calibration into the mapping from the axis ranges to [0, 1) */
+static void
+evdev_abs_update_transform(struct device_abs *abs)
+{
+	const float *c = abs->calibration;
+	double sx, sy, tx, ty;
+	int row;
+
+	sx = 1.0 / (abs->max_x - abs->min_x + 1);
+	sy = 1.0 / (abs->max_y - abs->min_y + 1);
+	tx = -abs->min_x * sx;
+	ty = -abs->min_y * sy;
+
+	for (row = 0; row < 2; row++) {
+		abs->unit[row][0] = c[row * 3] * sx;
+		abs->unit[row][1] = c[row * 3 + 1] * sy;
+		abs->unit[row][2] = c[row * 3] * tx + c[row * 3 + 1] * ty +
+				    c[row * 3 + 2];
+	}
+}
+
+static int
+evdev_calibration_has_matrix(struct libinput_device *device)
+{
+	return 1;
+}
+
+static enum libinput_config_status
+evdev_calibration_set_matrix(struct libinput_device *device,
+			     const float matrix[6])
+{
+	memcpy(device->abs->calibration, matrix,
+	       sizeof(device->abs->calibration));
+	evdev_abs_update_transform(device->abs);
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+static int
+evdev_calibration_get_matrix(struct libinput_device *device,
+			     float matrix[6])
+{
+	struct device_abs *abs = device->abs;
+	struct matrix m;
+
+	memcpy(matrix, abs->calibration, sizeof(abs->calibration));
+	matrix_from_farray6(&m, matrix);
+
+	return !matrix_is_identity(&m);
+}
+
+static int
+evdev_calibration_get_default_matrix(struct libinput_device *device,
+				     float matrix[6])
+{
+	struct device_abs *abs = device->abs;
+	struct matrix m;
+
+	memcpy(matrix, abs->default_calibration,
+	       sizeof(abs->default_calibration));
+	matrix_from_farray6(&m, matrix);
+
+	return !matrix_is_identity(&m);
+}
+
+static struct libinput_device_config_calibration evdev_calibration = {
+	&evdev_calibration_has_matrix,
+	&evdev_calibration_set_matrix,
+	&evdev_calibration_get_matrix,
+	&evdev_calibration_get_default_matrix
+};
+
+/*
+ * Set the axis ranges. The first time around this sets up the
+ * calibration, a reopened fd only refreshes the ranges.
+ */
+static bool
+evdev_abs_set_ranges(struct libinput_device *device,
+		     const struct input_absinfo *ax,
+		     const struct input_absinfo *ay)
+{
+	static const float identity[6] = { 1, 0, 0, 0, 1, 0 };
+	struct device_abs *abs = device->abs;
+
+	if (ax->maximum <= ax->minimum || ay->maximum <= ay->minimum)
+		return false;
+
+	if (abs == NULL) {
+		abs = zalloc(sizeof(*abs));
+		if (abs == NULL)
+			return false;
+		memcpy(abs->calibration, identity, sizeof(identity));
+		memcpy(abs->default_calibration, identity, sizeof(identity));
+		device->abs = abs;
+		device->config.calibration = &evdev_calibration;
+	}
+
+	abs->min_x = ax->minimum;
+	abs->max_x = ax->maximum;
+	abs->res_x = ax->resolution;
+	abs->min_y = ay->minimum;
+	abs->max_y = ay->maximum;
+	abs->res_y = ay->resolution;
+	evdev_abs_update_transform(abs);
+
+	return true;
+}
+
+static bool
+evdev_probe_abs(struct libinput_device *device, int code_x, int code_y)
+{
+	struct input_absinfo ax, ay;
+
+	if (ioctl(device->fd, EVIOCGABS(code_x), &ax) < 0 ||
+	    ioctl(device->fd, EVIOCGABS(code_y), &ay) < 0)
+		return false;
+
+	return evdev_abs_set_ranges(device, &ax, &ay);
+}
+
+static void
+evdev_probe_touch(struct libinput_device *device,
+		  const unsigned char *absbits)
+{
+	struct evdev_state *st = device->evdevst;
+	struct input_absinfo slotinfo;
+
+	if (bit_is_set(absbits, ABS_MT_SLOT) &&
+	    bit_is_set(absbits, ABS_MT_POSITION_X) &&
+	    bit_is_set(absbits, ABS_MT_POSITION_Y) &&
+	    ioctl(device->fd, EVIOCGABS(ABS_MT_SLOT), &slotinfo) == 0 &&
+	    evdev_probe_abs(device, ABS_MT_POSITION_X, ABS_MT_POSITION_Y)) {
+		st->touch = EVDEV_TOUCH_MT;
+		st->nslots = min(slotinfo.maximum + 1, EVDEV_MAX_SLOTS);
+		st->slot = slotinfo.value < st->nslots ? slotinfo.value : -1;
+	} else if (bit_is_set(absbits, ABS_X) && bit_is_set(absbits, ABS_Y) &&
+		   evdev_probe_abs(device, ABS_X, ABS_Y)) {
+		st->touch = EVDEV_TOUCH_SINGLE;
+		st->nslots = 1;
+		st->slot = 0;
+	}
+}
+
+static bool
+evdev_probe_tablet(struct libinput_device *device,
+		   const unsigned char *absbits,
+		   const unsigned char *keybits)
+{
+	struct evdev_tablet *t = &device->evdevst->tablet_state;
+	bool have_tool = false;
+	int i;
+
+	for (i = 0; i < EVDEV_NTOOLS; i++) {
+		if (evdev_tool_map[i] != 0 &&
+		    bit_is_set(keybits, EVDEV_BTN_TOOL_PEN + i))
+			have_tool = true;
+	}
+	if (!have_tool ||
+	    !bit_is_set(absbits, ABS_X) || !bit_is_set(absbits, ABS_Y) ||
+	    !evdev_probe_abs(device, ABS_X, ABS_Y))
+		return false;
+
+	set_bit(t->axis_caps, LIBINPUT_TABLET_TOOL_AXIS_X);
+	set_bit(t->axis_caps, LIBINPUT_TABLET_TOOL_AXIS_Y);
+	for (i = 0; i < EVDEV_TABLET_NAXES; i++) {
+		if (bit_is_set(absbits, ABS_PRESSURE + i) &&
+		    ioctl(device->fd, EVIOCGABS(ABS_PRESSURE + i),
+			  &t->absinfo[i]) == 0 &&
+		    t->absinfo[i].maximum > t->absinfo[i].minimum)
+			set_bit(t->axis_caps, evdev_tablet_axis_map[i]);
+	}
+
+	for (i = 0; i < EVDEV_NTOOL_BUTTONS; i++) {
+		if (bit_is_set(keybits, evdev_tool_button_map[i].code))
+			t->button_caps |= 1u << i;
+	}
+
+	device->evdevst->tablet = true;
+
+	return true;
+}
+
+static uint32_t
+evdev_probe_caps(struct libinput_device *device)
+{
+	unsigned char relbits[NCHARS(REL_MAX + 1)];
+	unsigned char absbits[NCHARS(ABS_MAX + 1)];
+	unsigned char keybits[NCHARS(EVDEV_KEY_MAX + 1)];
+	uint32_t caps = 0;
+	int code;
+
+	memset(relbits, 0, sizeof(relbits));
+	memset(absbits, 0, sizeof(absbits));
+	memset(keybits, 0, sizeof(keybits));
+
+	if (ioctl(device->fd, EVIOCGBIT(EV_REL, sizeof(relbits)),
+		  relbits) < 0 ||
+	    ioctl(device->fd, EVIOCGBIT(EV_KEY, sizeof(keybits)),
+		  keybits) < 0) {
+		/*
+		 * Not a real evdev node (e.g. a pipe), take anything. There
+		 * are no axis ranges to ask for, multitouch positions are
+		 * taken to be 16 bit. Whether the stream carries ABS_MT_*
+		 * only shows after the device was added and its caps can't
+		 * change then, so every pipe is also a touchscreen.
+		 */
+		static const struct input_absinfo range = {
+			.minimum = 0,
+			.maximum = 0xffff,
+		};
+
+		caps = DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_POINTER) |
+		       DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_KEYBOARD);
+		device->evdevst->rel_pointer = true;
+		if (evdev_abs_set_ranges(device, &range, &range)) {
+			device->evdevst->touch = EVDEV_TOUCH_MT;
+			device->evdevst->nslots = EVDEV_MAX_SLOTS;
+			caps |= DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_TOUCH);
+		}
+		return caps;
+	}
+	ioctl(device->fd, EVIOCGBIT(EV_ABS, sizeof(absbits)), absbits);
+
+	if (bit_is_set(relbits, REL_X) && bit_is_set(relbits, REL_Y)) {
+		device->evdevst->rel_pointer = true;
+		caps |= DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_POINTER);
+	}
+
+	/* Pens and pucks on a graphics tablet */
+	if (evdev_probe_tablet(device, absbits, keybits))
+		caps |= DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_TABLET_TOOL);
+
+	/*
+	 * VM tablets and KVM absolute mice. Touchscreens and tablets also
+	 * have ABS_X/ABS_Y but report contact through BTN_TOUCH or a tool.
+	 */
+	if (!device->evdevst->tablet &&
+	    bit_is_set(absbits, ABS_X) && bit_is_set(absbits, ABS_Y) &&
+	    !bit_is_set(keybits, EVDEV_BTN_TOUCH) &&
+	    !bit_is_set(keybits, EVDEV_BTN_TOOL_PEN) &&
+	    evdev_probe_abs(device, ABS_X, ABS_Y)) {
+		device->evdevst->abs_pointer = true;
+		caps |= DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_POINTER);
+	}
+
+	if (bit_is_set(keybits, EVDEV_BTN_TOUCH) &&
+	    !bit_is_set(keybits, EVDEV_BTN_TOOL_FINGER) &&
+	    !bit_is_set(keybits, EVDEV_BTN_TOOL_PEN)) {
+		evdev_probe_touch(device, absbits);
+		if (device->evdevst->touch != EVDEV_TOUCH_NONE)
+			caps |= DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_TOUCH);
+	}
+
+	/*
+	 * Touchpads have BTN_TOOL_FINGER. Only multitouch ones are taken,
+	 * their positions are relative to the pad, so no calibration.
+	 */
+	if (bit_is_set(keybits, EVDEV_BTN_TOUCH) &&
+	    bit_is_set(keybits, EVDEV_BTN_TOOL_FINGER) &&
+	    !bit_is_set(keybits, EVDEV_BTN_TOOL_PEN)) {
+		evdev_probe_touch(device, absbits);
+		device->config.calibration = NULL;
+		if (device->evdevst->touch == EVDEV_TOUCH_MT) {
+			device->evdevst->touchpad = true;
+			gesture_init(&device->evdevst->gesture, device->abs);
+			caps |= DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_POINTER) |
+				DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_GESTURE);
+		} else {
+			device->evdevst->touch = EVDEV_TOUCH_NONE;
+		}
+	}
+
+	/* Mice with a few multimedia keys are not keyboards */
+	for (code = EVDEV_KEY_ESC; code <= EVDEV_KEY_KP_DOT; code++) {
+		if (bit_is_set(keybits, code)) {
+			caps |= DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_KEYBOARD);
+			break;
+		}
+	}
+
+	return caps;
+}
+
+/* Pick up the current position, e.g. after events were dropped */
+static void
+evdev_sync_abs(struct libinput_device *device)
+{
+	struct evdev_state *st = device->evdevst;
+	struct input_absinfo ax, ay;
+
+	if (ioctl(device->fd, EVIOCGABS(ABS_X), &ax) < 0 ||
+	    ioctl(device->fd, EVIOCGABS(ABS_Y), &ay) < 0)
+		return;
+
+	if (ax.value != st->abs.x || ay.value != st->abs.y) {
+		st->abs.x = ax.value;
+		st->abs.y = ay.value;
+		st->abs_changed = true;
+	}
+}
+
+/* Returns false if the key isn't one of the tablet's */
+static bool
+evdev_tablet_key(struct evdev_tablet *t, int code, bool pressed)
+{
+	unsigned int bit;
+	int i;
+
+	if (code >= EVDEV_BTN_TOOL_PEN && code <= EVDEV_BTN_TOOL_LENS) {
+		if (evdev_tool_map[code - EVDEV_BTN_TOOL_PEN] == 0)
+			return false;
+		bit = 1u << (code - EVDEV_BTN_TOOL_PEN);
+		t->tools = pressed ? t->tools | bit : t->tools & ~bit;
+		return true;
+	}
+
+	if (code == EVDEV_BTN_TOUCH) {
+		t->tip = pressed;
+		return true;
+	}
+
+	for (i = 0; i < EVDEV_NTOOL_BUTTONS; i++) {
+		if (evdev_tool_button_map[i].code == code) {
+			bit = 1u << i;
+			t->buttons = pressed ? t->buttons | bit
+					     : t->buttons & ~bit;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/* Axis values are converted on SYN_REPORT, only the raw value is kept */
+static void
+evdev_tablet_abs(struct evdev_tablet *t, int code, int32_t value)
+{
+	int i;
+
+	switch (code) {
+	case ABS_X:
+		if (t->axes.point.x != value) {
+			t->axes.point.x = value;
+			set_bit(t->changed, LIBINPUT_TABLET_TOOL_AXIS_X);
+		}
+		return;
+	case ABS_Y:
+		if (t->axes.point.y != value) {
+			t->axes.point.y = value;
+			set_bit(t->changed, LIBINPUT_TABLET_TOOL_AXIS_Y);
+		}
+		return;
+	case ABS_MISC:
+		t->tool_id = value;
+		return;
+	}
+
+	if (code < ABS_PRESSURE || code > ABS_TILT_Y)
+		return;
+
+	i = code - ABS_PRESSURE;
+	if (!bit_is_set(t->axis_caps, evdev_tablet_axis_map[i]) ||
+	    t->absinfo[i].value == value)
+		return;
+
+	t->absinfo[i].value = value;
+	set_bit(t->changed, evdev_tablet_axis_map[i]);
+}
+
+/* Pick up the tool state, e.g. after events were dropped */
+static void
+evdev_sync_tablet(struct libinput_device *device)
+{
+	static const int abs_codes[] = {
+		ABS_X, ABS_Y, ABS_PRESSURE, ABS_DISTANCE, ABS_TILT_X,
+		ABS_TILT_Y, ABS_MISC,
+	};
+	struct evdev_tablet *t = &device->evdevst->tablet_state;
+	unsigned char keybits[NCHARS(EVDEV_KEY_MAX + 1)];
+	struct input_absinfo ai;
+	int code, i;
+
+	memset(keybits, 0, sizeof(keybits));
+	if (ioctl(device->fd, EVIOCGKEY(sizeof(keybits)), keybits) == 0) {
+		for (code = EVDEV_BTN_TOOL_PEN; code <= EVDEV_BTN_TOOL_LENS;
+		     code++)
+			evdev_tablet_key(t, code, bit_is_set(keybits, code));
+		evdev_tablet_key(t, EVDEV_BTN_TOUCH,
+				 bit_is_set(keybits, EVDEV_BTN_TOUCH));
+		for (i = 0; i < EVDEV_NTOOL_BUTTONS; i++) {
+			code = evdev_tool_button_map[i].code;
+			evdev_tablet_key(t, code, bit_is_set(keybits, code));
+		}
+	}
+
+	for (i = 0; i < (int)ARRAY_LENGTH(abs_codes); i++) {
+		if (ioctl(device->fd, EVIOCGABS(abs_codes[i]), &ai) == 0)
+			evdev_tablet_abs(t, abs_codes[i], ai.value);
+	}
+}
+
+static int
+evdev_device_init(struct libinput_device *device)
+{
+	struct evdev_state *st;
+	int clockid = CLOCK_MONOTONIC;
+
+	st = zalloc(sizeof(*st));
+	if (st == NULL)
+		return -1;
+
+	device->evdevst = st;
+	device->caps = evdev_probe_caps(device);
+
+	/* Start from the current position, not from the origin */
+	if (st->abs_pointer) {
+		evdev_sync_abs(device);
+		st->abs_changed = false;
+	}
+	/* A tool already in proximity comes in with the first report */
+	if (st->tablet)
+		evdev_sync_tablet(device);
+
+	/* Event timestamps are CLOCK_REALTIME unless told otherwise */
+	ioctl(device->fd, EVIOCSCLOCKID, &clockid);
+
+	return 0;
+}
+
+static void
+evdev_device_destroy(struct libinput_device *device)
+{
+	free(device->evdevst);
+	device->evdevst = NULL;
+}
+
+static void
+evdev_flush_rel(struct libinput_device *device, uint64_t time)
+{
+	struct evdev_state *st = device->evdevst;
+	struct normalized_coords unaccel, accel;
+	struct discrete_coords disc;
+	struct device_float_coords raw;
+	uint32_t axes = 0;
+
+	if (st->wheel != 0 || st->hwheel != 0) {
+		memset(&disc, 0, sizeof(disc));
+		memset(&accel, 0, sizeof(accel));
+
+		/* evdev wheel up is positive, ours is negative */
+		if (st->wheel != 0) {
+			axes |= AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+			accel.y = device_wheel_degrees(device, -st->wheel);
+			disc.y = -st->wheel;
+		}
+		if (st->hwheel != 0) {
+			axes |= AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+			accel.x = device_wheel_degrees(device, st->hwheel);
+			disc.x = st->hwheel;
+		}
+
+		pointer_notify_axis(device, time, axes,
+		    LIBINPUT_POINTER_AXIS_SOURCE_WHEEL, &accel, &disc);
+	}
+
+	/* Skip the accelerator if nobody consumes motion events */
+	if ((st->rel_x != 0 || st->rel_y != 0) &&
+	    libinput_motion_wanted(device->seat->libinput)) {
+		raw.x = st->rel_x;
+		raw.y = st->rel_y;
+		unaccel.x = st->rel_x;
+		unaccel.y = st->rel_y;
+
+		if (device->filter)
+			accel = filter_dispatch(device->filter, &unaccel,
+						device, time);
+		else
+			accel = unaccel;
+
+		if (!normalized_is_zero(accel) || !normalized_is_zero(unaccel))
+			pointer_notify_motion(device, time, &accel, &raw);
+	}
+
+	st->rel_x = 0;
+	st->rel_y = 0;
+	st->wheel = 0;
+	st->hwheel = 0;
+}
+
+static void
+evdev_flush_abs(struct libinput_device *device, uint64_t time)
+{
+	struct evdev_state *st = device->evdevst;
+
+	if (!st->abs_changed)
+		return;
+
+	st->abs_changed = false;
+	pointer_notify_motion_absolute(device, time, &st->abs);
+}
+
+static void
+evdev_touch_begin(struct evdev_state *st, struct evdev_slot *slot)
+{
+	slot->up_pending = slot->active;
+	slot->down_pending = true;
+	st->touch_changed = true;
+}
+
+static void
+evdev_touch_end(struct evdev_state *st, struct evdev_slot *slot)
+{
+	slot->up_pending = slot->active;
+	slot->down_pending = false;
+	st->touch_changed = true;
+}
+
+static void
+evdev_touch_move(struct evdev_state *st, int axis, int32_t value)
+{
+	struct evdev_slot *slot;
+
+	if (st->slot < 0)
+		return;
+
+	slot = &st->slots[st->slot];
+	if (axis == 0)
+		slot->point.x = value;
+	else
+		slot->point.y = value;
+	slot->dirty = true;
+	st->touch_changed = true;
+}
+
+/* Hand the contact changes of one report to the gesture recognizer */
+static void
+evdev_flush_touchpad(struct libinput_device *device, uint64_t time)
+{
+	struct evdev_state *st = device->evdevst;
+	struct evdev_slot *slot;
+	int i;
+
+	for (i = 0; i < st->nslots; i++) {
+		slot = &st->slots[i];
+
+		if (slot->up_pending) {
+			gesture_contact_up(&st->gesture, i);
+			slot->active = false;
+		}
+
+		if (slot->down_pending) {
+			gesture_contact_down(&st->gesture, i, &slot->point);
+			slot->active = true;
+		} else if (slot->dirty && slot->active) {
+			gesture_contact_move(&st->gesture, i, &slot->point);
+		}
+
+		slot->up_pending = false;
+		slot->down_pending = false;
+		slot->dirty = false;
+	}
+
+	gesture_frame(device, &st->gesture, time);
+}
+
+/* Post the contact changes of one report, followed by a frame */
+static void
+evdev_flush_touch(struct libinput_device *device, uint64_t time)
+{
+	struct evdev_state *st = device->evdevst;
+	struct libinput_seat *seat = device->seat;
+	struct evdev_slot *slot;
+	bool posted = false;
+	int i;
+
+	if (!st->touch_changed)
+		return;
+	st->touch_changed = false;
+
+	if (st->touchpad) {
+		evdev_flush_touchpad(device, time);
+		return;
+	}
+
+	for (i = 0; i < st->nslots; i++) {
+		slot = &st->slots[i];
+
+		if (slot->up_pending) {
+			touch_notify_touch_up(device, time, i,
+					      slot->seat_slot);
+			seat_slot_release(seat, slot->seat_slot);
+			slot->active = false;
+			posted = true;
+		}
+
+		if (slot->down_pending) {
+			slot->seat_slot = seat_slot_alloc(seat);
+			/* More contacts on the seat than slots, drop it */
+			if (slot->seat_slot != -1) {
+				touch_notify_touch_down(device, time, i,
+							slot->seat_slot,
+							&slot->point);
+				slot->active = true;
+				posted = true;
+			}
+		} else if (slot->dirty && slot->active) {
+			touch_notify_touch_motion(device, time, i,
+						  slot->seat_slot,
+						  &slot->point);
+			posted = true;
+		}
+
+		slot->up_pending = false;
+		slot->down_pending = false;
+		slot->dirty = false;
+	}
+
+	if (posted)
+		touch_notify_frame(device, time);
+}
+
+/* Lift every contact, e.g. on suspend or after events were dropped */
+static void
+evdev_release_touches(struct libinput_device *device, uint64_t time)
+{
+	struct evdev_state *st = device->evdevst;
+	int i;
+
+	/* The fingers did not lift, a swipe or pinch did not finish */
+	if (st->touchpad)
+		gesture_cancel(device, &st->gesture, time);
+	for (i = 0; i < st->nslots; i++)
+		evdev_touch_end(st, &st->slots[i]);
+	evdev_flush_touch(device, time);
+}
+
+/* Per-slot values of one ABS_MT_* axis, as EVIOCGMTSLOTS fills them */
+struct evdev_mt_values {
+	uint32_t code;
+	int32_t values[EVDEV_MAX_SLOTS];
+};
+
+static bool
+evdev_get_mt_values(struct libinput_device *device, uint32_t code,
+		    struct evdev_mt_values *mt)
+{
+	memset(mt, 0, sizeof(*mt));
+	mt->code = code;
+
+	return ioctl(device->fd, EVIOCGMTSLOTS(sizeof(*mt)), mt) == 0;
+}
+
+/*
+ * Contacts may have ended, started or changed their tracking ID in the
+ * dropped events. End them all, then ask the kernel which slots hold a
+ * contact now and start those again at their current position. The up
+ * and down go out in one frame.
+ */
+static void
+evdev_sync_touches(struct libinput_device *device, uint64_t time)
+{
+	struct evdev_state *st = device->evdevst;
+	struct evdev_mt_values ids, xs, ys;
+	struct input_absinfo ai, ax, ay;
+	unsigned char keybits[NCHARS(EVDEV_KEY_MAX + 1)];
+	struct evdev_slot *slot;
+	int i;
+
+	for (i = 0; i < st->nslots; i++)
+		evdev_touch_end(st, &st->slots[i]);
+
+	if (st->touch == EVDEV_TOUCH_MT &&
+	    ioctl(device->fd, EVIOCGABS(ABS_MT_SLOT), &ai) == 0 &&
+	    evdev_get_mt_values(device, ABS_MT_TRACKING_ID, &ids) &&
+	    evdev_get_mt_values(device, ABS_MT_POSITION_X, &xs) &&
+	    evdev_get_mt_values(device, ABS_MT_POSITION_Y, &ys)) {
+		st->slot = ai.value >= 0 && ai.value < st->nslots ?
+			   ai.value : -1;
+		for (i = 0; i < st->nslots; i++) {
+			if (ids.values[i] < 0)
+				continue;
+			slot = &st->slots[i];
+			slot->point.x = xs.values[i];
+			slot->point.y = ys.values[i];
+			evdev_touch_begin(st, slot);
+		}
+	} else if (st->touch == EVDEV_TOUCH_SINGLE) {
+		memset(keybits, 0, sizeof(keybits));
+		if (ioctl(device->fd, EVIOCGKEY(sizeof(keybits)),
+			  keybits) == 0 &&
+		    bit_is_set(keybits, EVDEV_BTN_TOUCH) &&
+		    ioctl(device->fd, EVIOCGABS(ABS_X), &ax) == 0 &&
+		    ioctl(device->fd, EVIOCGABS(ABS_Y), &ay) == 0) {
+			slot = &st->slots[0];
+			slot->point.x = ax.value;
+			slot->point.y = ay.value;
+			evdev_touch_begin(st, slot);
+		}
+	}
+
+	evdev_flush_touch(device, time);
+}
+
+static double
+evdev_abs_fraction(const struct input_absinfo *ai)
+{
+	return (double)(ai->value - ai->minimum) / (ai->maximum - ai->minimum);
+}
+
+/* Tilt resolution is in units/radian, without one the range is +-64° */
+static double
+evdev_abs_tilt(const struct input_absinfo *ai)
+{
+	if (ai->resolution > 0)
+		return ai->value * 180.0 / M_PI / ai->resolution;
+
+	return (evdev_abs_fraction(ai) * 2.0 - 1.0) * 64.0;
+}
+
+static bool
+evdev_tablet_changed(const struct evdev_tablet *t)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(t->changed); i++) {
+		if (t->changed[i])
+			return true;
+	}
+
+	return false;
+}
+
+/* Convert the changed axes, the delta is since the last report */
+static void
+evdev_tablet_update_axes(struct libinput_device *device)
+{
+	struct evdev_tablet *t = &device->evdevst->tablet_state;
+	const struct device_abs *abs = device->abs;
+	const struct input_absinfo *ai;
+	double dx, dy;
+	int i;
+
+	for (i = 0; i < EVDEV_TABLET_NAXES; i++) {
+		if (!bit_is_set(t->changed, evdev_tablet_axis_map[i]))
+			continue;
+
+		ai = &t->absinfo[i];
+		switch (ABS_PRESSURE + i) {
+		case ABS_PRESSURE:
+			t->axes.pressure = evdev_abs_fraction(ai);
+			break;
+		case ABS_DISTANCE:
+			t->axes.distance = evdev_abs_fraction(ai);
+			break;
+		case ABS_TILT_X:
+			t->axes.tilt.x = evdev_abs_tilt(ai);
+			break;
+		case ABS_TILT_Y:
+			t->axes.tilt.y = evdev_abs_tilt(ai);
+			break;
+		}
+	}
+
+	/* In 1000dpi units like mouse motion */
+	dx = t->axes.point.x - t->point_reported.x;
+	dy = t->axes.point.y - t->point_reported.y;
+	t->axes.delta.x = abs->res_x > 0 ? dx * 1000.0 / 25.4 / abs->res_x : dx;
+	t->axes.delta.y = abs->res_y > 0 ? dy * 1000.0 / 25.4 / abs->res_y : dy;
+	t->point_reported = t->axes.point;
+}
+
+static enum libinput_tablet_tool_tip_state
+evdev_tablet_tip_state(const struct evdev_tablet *t)
+{
+	return t->tip_reported ? LIBINPUT_TABLET_TOOL_TIP_DOWN
+			       : LIBINPUT_TABLET_TOOL_TIP_UP;
+}
+
+static void
+evdev_tablet_notify_buttons(struct libinput_device *device, uint64_t time,
+			    unsigned int buttons)
+{
+	struct evdev_tablet *t = &device->evdevst->tablet_state;
+	unsigned int changed = buttons ^ t->buttons_reported;
+	int i;
+
+	for (i = 0; i < EVDEV_NTOOL_BUTTONS; i++) {
+		if (!(changed & (1u << i)))
+			continue;
+
+		tablet_notify_button(device, time, t->tool,
+				     evdev_tablet_tip_state(t), &t->axes,
+				     evdev_tool_button_map[i].button,
+				     buttons & (1u << i) ?
+				     LIBINPUT_BUTTON_STATE_PRESSED :
+				     LIBINPUT_BUTTON_STATE_RELEASED);
+	}
+	t->buttons_reported = buttons;
+}
+
+/* Release the buttons, lift the tip and leave proximity */
+static void
+evdev_tablet_out(struct libinput_device *device, uint64_t time)
+{
+	struct evdev_tablet *t = &device->evdevst->tablet_state;
+
+	if (t->tool == NULL)
+		return;
+
+	evdev_tablet_notify_buttons(device, time, 0);
+
+	evdev_tablet_update_axes(device);
+	if (t->tip_reported) {
+		t->tip_reported = false;
+		tablet_notify_tip(device, time, t->tool,
+				  LIBINPUT_TABLET_TOOL_TIP_UP,
+				  t->changed, &t->axes);
+		memset(t->changed, 0, sizeof(t->changed));
+	}
+	tablet_notify_proximity(device, time, t->tool,
+				LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_OUT,
+				t->changed, &t->axes);
+	memset(t->changed, 0, sizeof(t->changed));
+	t->tool = NULL;
+}
+
+/*
+ * Post the tool changes of one report. Only proximity in looks up the
+ * tool, everything else uses the one kept in the state.
+ */
+static void
+evdev_flush_tablet(struct libinput_device *device, uint64_t time)
+{
+	struct evdev_tablet *t = &device->evdevst->tablet_state;
+	enum libinput_tablet_tool_type type;
+	size_t i;
+
+	/* The lowest tool wins if the kernel reports several */
+	type = t->tools ? evdev_tool_map[__builtin_ffs(t->tools) - 1] : 0;
+
+	/* Out of proximity, or the tool changed in dropped events */
+	if (t->tool != NULL && t->tool->type != type)
+		evdev_tablet_out(device, time);
+
+	if (t->tool == NULL) {
+		if (type != 0)
+			t->tool = tablet_tool_get(device->seat->libinput, type,
+						  t->tool_id, t->serial);
+		if (t->tool == NULL) {
+			memset(t->changed, 0, sizeof(t->changed));
+			return;
+		}
+
+		for (i = 0; i < sizeof(t->axis_caps); i++)
+			t->tool->axis_caps[i] |= t->axis_caps[i];
+		for (i = 0; i < EVDEV_NTOOL_BUTTONS; i++) {
+			if (t->button_caps & (1u << i))
+				set_bit(t->tool->buttons,
+					evdev_tool_button_map[i].button);
+		}
+
+		/* Everything is new to the caller */
+		memcpy(t->changed, t->axis_caps, sizeof(t->changed));
+		t->point_reported = t->axes.point;
+		evdev_tablet_update_axes(device);
+		tablet_notify_proximity(device, time, t->tool,
+					LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
+					t->changed, &t->axes);
+		memset(t->changed, 0, sizeof(t->changed));
+	}
+
+	if (t->tip != t->tip_reported) {
+		evdev_tablet_update_axes(device);
+		t->tip_reported = t->tip;
+		tablet_notify_tip(device, time, t->tool,
+				  evdev_tablet_tip_state(t),
+				  t->changed, &t->axes);
+		memset(t->changed, 0, sizeof(t->changed));
+	} else if (evdev_tablet_changed(t)) {
+		evdev_tablet_update_axes(device);
+		tablet_notify_axis(device, time, t->tool,
+				   evdev_tablet_tip_state(t),
+				   t->changed, &t->axes);
+		memset(t->changed, 0, sizeof(t->changed));
+	}
+
+	evdev_tablet_notify_buttons(device, time, t->buttons);
+}
+
+static void
+evdev_notify_key(struct libinput_device *device, uint64_t time, int code,
+		 bool pressed)
+{
+	struct evdev_state *st = device->evdevst;
+	int button;
+
+	if (code > 0 && code < KEY_CNT) {
+		if (!!bit_is_set(st->key_down, code) == pressed)
+			return;
+		if (pressed)
+			set_bit(st->key_down, code);
+		else
+			clear_bit(st->key_down, code);
+		keyboard_notify_key(device, time, code,
+		    pressed ? LIBINPUT_KEY_STATE_PRESSED
+			    : LIBINPUT_KEY_STATE_RELEASED);
+	} else if (code >= EVDEV_BTN_MOUSE && code <= EVDEV_BTN_TASK) {
+		button = code - EVDEV_BTN_MOUSE;
+		if (!!bit_is_set(st->button_down, button) == pressed)
+			return;
+		if (pressed)
+			set_bit(st->button_down, button);
+		else
+			clear_bit(st->button_down, button);
+		pointer_notify_button(device, time, evdev_button_map[button],
+		    pressed ? LIBINPUT_BUTTON_STATE_PRESSED
+			    : LIBINPUT_BUTTON_STATE_RELEASED);
+	}
+}
+
+/*
+ * After a SYN_DROPPED the kernel discarded events, including possibly key
+ * releases. Ask for the current key state and emit the difference.
+ */
+static void
+evdev_sync_keys(struct libinput_device *device, uint64_t time)
+{
+	struct evdev_state *st = device->evdevst;
+	unsigned char keybits[NCHARS(EVDEV_KEY_MAX + 1)];
+	int code;
+
+	memset(keybits, 0, sizeof(keybits));
+	if (ioctl(device->fd, EVIOCGKEY(sizeof(keybits)), keybits) < 0)
+		return;
+
+	for (code = 1; code < KEY_CNT; code++)
+		evdev_notify_key(device, time, code,
+				 bit_is_set(keybits, code));
+	for (code = EVDEV_BTN_MOUSE; code <= EVDEV_BTN_TASK; code++)
+		evdev_notify_key(device, time, code,
+				 bit_is_set(keybits, code));
+}
+
+static void
+evdev_process(struct libinput_device *device, const struct input_event *ev)
+{
+	struct evdev_state *st = device->evdevst;
+	uint64_t time = evdev_event_time(ev);
+
+	switch (ev->type) {
+	case EV_SYN:
+		if (ev->code == SYN_DROPPED) {
+			log_info(device->seat->libinput,
+				 "%s: kernel event queue overflow\n",
+				 device->devname);
+			st->dropped = true;
+			st->rel_x = st->rel_y = 0;
+			st->wheel = st->hwheel = 0;
+			st->abs_changed = false;
+		} else if (ev->code == SYN_REPORT) {
+			if (st->dropped) {
+				st->dropped = false;
+				if (st->touch != EVDEV_TOUCH_NONE)
+					evdev_sync_touches(device, time);
+				if (st->abs_pointer)
+					evdev_sync_abs(device);
+				evdev_flush_abs(device, time);
+				evdev_sync_keys(device, time);
+				if (st->tablet)
+					evdev_sync_tablet(device);
+			} else {
+				evdev_flush_abs(device, time);
+				evdev_flush_rel(device, time);
+				evdev_flush_touch(device, time);
+			}
+			if (st->tablet)
+				evdev_flush_tablet(device, time);
+			pointer_notify_frame(device, time);
+		}
+		break;
+	case EV_REL:
+		if (st->dropped)
+			break;
+		switch (ev->code) {
+		case REL_X:
+			st->rel_x += ev->value;
+			break;
+		case REL_Y:
+			st->rel_y += ev->value;
+			break;
+		case REL_WHEEL:
+			st->wheel += ev->value;
+			break;
+		case REL_HWHEEL:
+			st->hwheel += ev->value;
+			break;
+		}
+		break;
+	case EV_ABS:
+		if (st->dropped)
+			break;
+		if (st->touch == EVDEV_TOUCH_MT) {
+			switch (ev->code) {
+			case ABS_MT_SLOT:
+				st->slot = ev->value >= 0 &&
+					   ev->value < st->nslots ?
+					   ev->value : -1;
+				break;
+			case ABS_MT_TRACKING_ID:
+				if (st->slot < 0)
+					break;
+				if (ev->value >= 0)
+					evdev_touch_begin(st,
+							  &st->slots[st->slot]);
+				else
+					evdev_touch_end(st,
+							&st->slots[st->slot]);
+				break;
+			case ABS_MT_POSITION_X:
+				evdev_touch_move(st, 0, ev->value);
+				break;
+			case ABS_MT_POSITION_Y:
+				evdev_touch_move(st, 1, ev->value);
+				break;
+			}
+		} else if (st->touch == EVDEV_TOUCH_SINGLE) {
+			if (ev->code == ABS_X || ev->code == ABS_Y)
+				evdev_touch_move(st, ev->code == ABS_Y,
+						 ev->value);
+		} else if (st->tablet) {
+			evdev_tablet_abs(&st->tablet_state, ev->code,
+					 ev->value);
+		} else if (st->abs_pointer) {
+			switch (ev->code) {
+			case ABS_X:
+				st->abs_changed |= st->abs.x != ev->value;
+				st->abs.x = ev->value;
+				break;
+			case ABS_Y:
+				st->abs_changed |= st->abs.y != ev->value;
+				st->abs.y = ev->value;
+				break;
+			}
+		}
+		break;
+	case EV_KEY:
+		/* Autorepeat is left to the caller */
+		if (st->dropped || ev->value == 2)
+			break;
+		if (st->tablet &&
+		    evdev_tablet_key(&st->tablet_state, ev->code,
+				     ev->value != 0))
+			break;
+		if (ev->code == EVDEV_BTN_TOUCH) {
+			/* Multitouch contacts come with tracking IDs */
+			if (st->touch == EVDEV_TOUCH_SINGLE) {
+				if (ev->value)
+					evdev_touch_begin(st, &st->slots[0]);
+				else
+					evdev_touch_end(st, &st->slots[0]);
+			}
+			break;
+		}
+		/* Motion within the frame happened before the button */
+		evdev_flush_abs(device, time);
+		evdev_flush_rel(device, time);
+		evdev_notify_key(device, time, ev->code, ev->value != 0);
+		break;
+	case EV_MSC:
+		if (!st->dropped && st->tablet && ev->code == MSC_SERIAL)
+			st->tablet_state.serial = ev->value;
+		break;
+	}
+}
+
+static void
+evdev_device_dispatch(void *data)
+{
+	struct libinput_device *device = data;
+	struct evdev_state *st = device->evdevst;
+	union {
+		struct input_event evs[64];
+		char bytes[64 * sizeof(struct input_event)];
+	} buf;
+	ssize_t len;
+	size_t have, i, n, pending;
+
+	pending = libinput_source_get_pending(device->source);
+
+	do {
+		memcpy(buf.bytes, st->partial, st->npartial);
+		len = read(device->fd, buf.bytes + st->npartial,
+			   sizeof(buf) - st->npartial);
+		if (len == 0 ||
+		    (len < 0 && errno != EAGAIN && errno != EINTR)) {
+			/* Unplugged, or the writer of a pipe went away */
+			dragonfly_device_lost(device);
+			return;
+		}
+		if (len < 0)
+			return;
+
+		have = st->npartial + len;
+		n = have / sizeof(struct input_event);
+		st->npartial = have % sizeof(struct input_event);
+		memcpy(st->partial, buf.bytes + n * sizeof(struct input_event),
+		       st->npartial);
+
+		for (i = 0; i < n; i++)
+			evdev_process(device, &buf.evs[i]);
+
+		pending = pending > (size_t)len ? pending - len : 0;
+	} while (have == sizeof(buf) && pending > 0);
+}
+
+static void
+evdev_release_all(struct libinput_device *device, uint64_t time)
+{
+	struct evdev_state *st = device->evdevst;
+	int code;
+
+	for (code = 1; code < KEY_CNT; code++)
+		evdev_notify_key(device, time, code, false);
+	for (code = EVDEV_BTN_MOUSE; code <= EVDEV_BTN_TASK; code++)
+		evdev_notify_key(device, time, code, false);
+	pointer_notify_frame(device, time);
+	evdev_release_touches(device, time);
+	if (st->tablet)
+		evdev_tablet_out(device, time);
+
+	st->rel_x = st->rel_y = 0;
+	st->wheel = st->hwheel = 0;
+	st->abs_changed = false;
+	st->dropped = false;
+	st->npartial = 0;
+}
+
+/*
+ * Absolute pointers and tablets move to where they are told, only
+ * relative motion gets a filter. Touchpad deltas are normalized to
+ * DEFAULT_MOUSE_DPI by the gesture code.
+ */
+static int
+evdev_init_accel(struct libinput_device *device,
+		 enum libinput_config_accel_profile which)
+{
+	struct evdev_state *st = device->evdevst;
+	struct motion_filter *filter;
+	int dpi;
+
+	if (st->touchpad) {
+		if (which == LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE)
+			filter = create_pointer_accelerator_filter_touchpad(
+				DEFAULT_MOUSE_DPI);
+		else
+			filter = pointer_create_accel_filter(which,
+							     DEFAULT_MOUSE_DPI);
+	} else if (st->rel_pointer) {
+		dpi = device->quirks.dpi ? device->quirks.dpi :
+					   DEFAULT_MOUSE_DPI;
+		filter = pointer_create_accel_filter(which, dpi);
+	} else {
+		return 0;
+	}
+
+	if (!filter)
+		return -1;
+
+	return device_init_pointer_acceleration(device, filter);
+}
+
+const struct libinput_device_interface evdev_interface = {
+	.dispatch = evdev_device_dispatch,
+	.init = evdev_device_init,
+	.destroy = evdev_device_destroy,
+	.suspend = evdev_release_all,
+	.reset = NULL,
+	.led_update = NULL,
+	.init_accel = evdev_init_accel,
+};
@@ -0,0 +1,101 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Linux evdev wire format. The installed <linux/input.h> is only a
+ * compatibility shim for the button numbering, it doesn't describe the
+ * event stream, so the parts of the protocol we read are defined here.
+ */
+
+#ifndef _EVDEV_H_
+#define _EVDEV_H_
+
+#include <sys/ioccom.h>
+#include <sys/time.h>
+
+struct input_event {
+	struct timeval	time;
+	uint16_t	type;
+	uint16_t	code;
+	int32_t		value;
+};
+
+struct input_absinfo {
+	int32_t		value;
+	int32_t		minimum;
+	int32_t		maximum;
+	int32_t		fuzz;
+	int32_t		flat;
+	int32_t		resolution;	/* units/mm */
+};
+
+#define EV_SYN			0x00
+#define EV_KEY			0x01
+#define EV_REL			0x02
+#define EV_ABS			0x03
+#define EV_MSC			0x04
+#define EV_MAX			0x1f
+
+#define SYN_REPORT		0
+#define SYN_DROPPED		3
+
+#define MSC_SERIAL		0x00
+
+#define REL_X			0x00
+#define REL_Y			0x01
+#define REL_HWHEEL		0x06
+#define REL_WHEEL		0x08
+#define REL_MAX			0x0f
+
+#define ABS_X			0x00
+#define ABS_Y			0x01
+#define ABS_PRESSURE		0x18
+#define ABS_DISTANCE		0x19
+#define ABS_TILT_X		0x1a
+#define ABS_TILT_Y		0x1b
+#define ABS_MISC		0x28
+#define ABS_MT_SLOT		0x2f
+#define ABS_MT_POSITION_X	0x35
+#define ABS_MT_POSITION_Y	0x36
+#define ABS_MT_TRACKING_ID	0x39
+#define ABS_MAX			0x3f
+
+/* Key codes below KEY_CNT are the same as those kbdev produces */
+#define EVDEV_KEY_ESC		1
+#define EVDEV_KEY_KP_DOT	83
+#define EVDEV_BTN_MOUSE		0x110
+#define EVDEV_BTN_TASK		0x117
+#define EVDEV_BTN_TOOL_PEN	0x140
+#define EVDEV_BTN_TOOL_FINGER	0x145
+#define EVDEV_BTN_TOOL_LENS	0x147
+#define EVDEV_BTN_STYLUS3	0x149
+#define EVDEV_BTN_TOUCH		0x14a
+#define EVDEV_BTN_STYLUS	0x14b
+#define EVDEV_BTN_STYLUS2	0x14c
+#define EVDEV_KEY_MAX		0x2ff
+
+#define EVIOCGMTSLOTS(len)	_IOC(IOC_OUT, 'E', 0x0a, len)
+#define EVIOCGKEY(len)		_IOC(IOC_OUT, 'E', 0x18, len)
+#define EVIOCGBIT(ev, len)	_IOC(IOC_OUT, 'E', 0x20 + (ev), len)
+#define EVIOCGABS(abs)		_IOR('E', 0x40 + (abs), struct input_absinfo)
+#define EVIOCSCLOCKID		_IOW('E', 0xa0, int)
+
+#endif /* !_EVDEV_H_ */
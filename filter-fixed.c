@@ -0,0 +1,591 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Q16.16 fixed-point versions of the adaptive (linear) and flat pointer
+ * filters, for targets without a floating point unit. The behaviour
+ * follows filter.c; doubles are only converted on the way in and out of
+ * the filter interface, the velocity tracking and the profile run on
+ * integers.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "libinput-util.h"
+#include "filter.h"
+#include "filter-private.h"
+
+typedef int32_t fix16_t;
+
+#define FIX16_SHIFT	16
+#define FIX16_ONE	((fix16_t)1 << FIX16_SHIFT)
+
+/* Compile-time conversion of a constant, do not use on run-time values */
+#define FIX16_CONST(d)	((fix16_t)((d) * FIX16_ONE + ((d) < 0 ? -0.5 : 0.5)))
+
+static inline fix16_t
+fix16_from_double(double d)
+{
+	return (fix16_t)(d * FIX16_ONE + (d < 0 ? -0.5 : 0.5));
+}
+
+static inline double
+fix16_to_double(fix16_t f)
+{
+	return f / (double)FIX16_ONE;
+}
+
+static inline fix16_t
+fix16_mul(fix16_t a, fix16_t b)
+{
+	return (fix16_t)(((int64_t)a * b) >> FIX16_SHIFT);
+}
+
+static inline fix16_t
+fix16_abs(fix16_t a)
+{
+	return a < 0 ? -a : a;
+}
+
+static uint32_t
+isqrt64(uint64_t v)
+{
+	uint64_t res = 0;
+	uint64_t bit = (uint64_t)1 << 62;
+
+	while (bit > v)
+		bit >>= 2;
+
+	while (bit != 0) {
+		if (v >= res + bit) {
+			v -= res + bit;
+			res = (res >> 1) + bit;
+		} else {
+			res >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return (uint32_t)res;
+}
+
+/* sqrt(x² + y²), the squares are kept below 2^61 so the sum can't
+ * overflow, large vectors lose their low bits instead */
+static fix16_t
+fix16_hypot(fix16_t x, fix16_t y)
+{
+	uint64_t ux = (uint32_t)fix16_abs(x);
+	uint64_t uy = (uint32_t)fix16_abs(y);
+	unsigned int shift = 0;
+
+	while ((ux | uy) >= ((uint64_t)1 << 30)) {
+		ux >>= 1;
+		uy >>= 1;
+		shift++;
+	}
+
+	return (fix16_t)((uint64_t)isqrt64(ux * ux + uy * uy) << shift);
+}
+
+/* tan(4.5°) and tan(40.5°) in 1/10000 */
+#define TAN_4_5		787
+#define TAN_40_5	8541
+
+/* Integer equivalent of normalized_get_direction(). Instead of the atan2
+ * octant, compare the slope against the octant center ±0.4 octants: close
+ * to an axis or a diagonal only that octant is marked, in between both. */
+static int
+fix16_get_direction(fix16_t x, fix16_t y)
+{
+	int dir = UNDEFINED_DIRECTION;
+	int64_t ax = fix16_abs(x), ay = fix16_abs(y);
+	int64_t lo, hi;
+	int axis, diag;
+
+	if (ax < 2 * FIX16_ONE && ay < 2 * FIX16_ONE) {
+		if (x > 0 && y > 0)
+			dir = S | SE | E;
+		else if (x > 0 && y < 0)
+			dir = N | NE | E;
+		else if (x < 0 && y > 0)
+			dir = S | SW | W;
+		else if (x < 0 && y < 0)
+			dir = N | NW | W;
+		else if (x > 0)
+			dir = NE | E | SE;
+		else if (x < 0)
+			dir = NW | W | SW;
+		else if (y > 0)
+			dir = SE | S | SW;
+		else if (y < 0)
+			dir = NE | N | NW;
+
+		return dir;
+	}
+
+	if (ay > ax) {
+		axis = y < 0 ? N : S;
+		lo = ax;
+		hi = ay;
+	} else {
+		axis = x > 0 ? E : W;
+		lo = ay;
+		hi = ax;
+	}
+
+	if (x > 0)
+		diag = y < 0 ? NE : SE;
+	else
+		diag = y < 0 ? NW : SW;
+
+	if (lo * 10000 <= hi * TAN_4_5)
+		dir = axis;
+	else if (lo * 10000 >= hi * TAN_40_5)
+		dir = diag;
+	else
+		dir = axis | diag;
+
+	return dir;
+}
+
+/*
+ * Same defaults as the floating point filters, velocities are in units/ms
+ * here so the thresholds keep enough fractional bits.
+ */
+
+#define DEFAULT_THRESHOLD	FIX16_CONST(0.4)	/* units/ms */
+#define MINIMUM_THRESHOLD	FIX16_CONST(0.2)	/* units/ms */
+#define DEFAULT_ACCELERATION	FIX16_CONST(2.0)	/* unitless factor */
+#define DEFAULT_INCLINE		FIX16_CONST(1.1)	/* unitless factor */
+
+#define DECEL_SPEED		FIX16_CONST(0.07)	/* units/ms */
+#define DECEL_INCLINE		FIX16_CONST(10.0)
+#define DECEL_MINIMUM		FIX16_CONST(0.3)
+#define ONE_SIXTH		FIX16_CONST(1.0/6.0)
+
+#define MAX_VELOCITY_DIFF	FIX16_ONE		/* units/ms */
+#define MOTION_TIMEOUT		ms2us(1000)
+#define NUM_POINTER_TRACKERS	16
+
+struct pointer_tracker_fixed {
+	fix16_t dx, dy;	/* delta to most recent event */
+	uint64_t time;	/* us */
+	int dir;
+};
+
+struct pointer_accelerator_fixed {
+	struct motion_filter base;
+
+	fix16_t last_velocity;	/* units/ms */
+
+	struct pointer_tracker_fixed trackers[NUM_POINTER_TRACKERS];
+	int cur_tracker;
+
+	fix16_t threshold;	/* units/ms */
+	fix16_t accel;		/* unitless factor */
+	fix16_t incline;	/* incline of the function */
+};
+
+struct pointer_accelerator_flat_fixed {
+	struct motion_filter base;
+
+	fix16_t factor;		/* speed factor times dpi factor */
+	fix16_t dpi_factor;
+};
+
+static void
+feed_trackers(struct pointer_accelerator_fixed *accel,
+	      fix16_t dx, fix16_t dy,
+	      uint64_t time)
+{
+	int i, current;
+	struct pointer_tracker_fixed *trackers = accel->trackers;
+
+	for (i = 0; i < NUM_POINTER_TRACKERS; i++) {
+		trackers[i].dx += dx;
+		trackers[i].dy += dy;
+	}
+
+	current = (accel->cur_tracker + 1) % NUM_POINTER_TRACKERS;
+	accel->cur_tracker = current;
+
+	trackers[current].dx = 0;
+	trackers[current].dy = 0;
+	trackers[current].time = time;
+	trackers[current].dir = fix16_get_direction(dx, dy);
+}
+
+static struct pointer_tracker_fixed *
+tracker_by_offset(struct pointer_accelerator_fixed *accel,
+		  unsigned int offset)
+{
+	unsigned int index =
+		(accel->cur_tracker + NUM_POINTER_TRACKERS - offset)
+		% NUM_POINTER_TRACKERS;
+	return &accel->trackers[index];
+}
+
+static fix16_t
+calculate_tracker_velocity(struct pointer_tracker_fixed *tracker,
+			   uint64_t time)
+{
+	uint64_t tdelta = time - tracker->time + 1;
+	int64_t v;
+
+	v = (int64_t)fix16_hypot(tracker->dx, tracker->dy) * 1000 /
+		(int64_t)tdelta;
+
+	return v > INT32_MAX ? INT32_MAX : (fix16_t)v; /* units/ms */
+}
+
+static fix16_t
+calculate_velocity(struct pointer_accelerator_fixed *accel, uint64_t time)
+{
+	struct pointer_tracker_fixed *tracker;
+	fix16_t velocity;
+	fix16_t result = 0;
+	fix16_t initial_velocity = 0;
+	unsigned int offset;
+
+	unsigned int dir = tracker_by_offset(accel, 0)->dir;
+
+	/* See calculate_velocity() in filter.c */
+	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
+		tracker = tracker_by_offset(accel, offset);
+
+		if (time - tracker->time > MOTION_TIMEOUT ||
+		    tracker->time > time) {
+			if (offset == 1)
+				result = calculate_tracker_velocity(tracker,
+						tracker->time + MOTION_TIMEOUT);
+			break;
+		}
+
+		velocity = calculate_tracker_velocity(tracker, time);
+
+		dir &= tracker->dir;
+		if (dir == 0) {
+			if (offset == 1)
+				result = velocity;
+			break;
+		}
+
+		if (initial_velocity == 0) {
+			result = initial_velocity = velocity;
+		} else {
+			if (fix16_abs(initial_velocity - velocity) >
+			    MAX_VELOCITY_DIFF)
+				break;
+
+			result = velocity;
+		}
+	}
+
+	return result; /* units/ms */
+}
+
+static fix16_t
+accel_profile_linear_fixed(struct pointer_accelerator_fixed *accel,
+			   fix16_t speed_in) /* units/ms */
+{
+	fix16_t factor;
+
+	/* See pointer_accel_profile_linear() for the shape */
+	if (speed_in < DECEL_SPEED)
+		factor = fix16_mul(DECEL_INCLINE, speed_in) + DECEL_MINIMUM;
+	else if (speed_in < accel->threshold)
+		factor = FIX16_ONE;
+	else
+		factor = fix16_mul(accel->incline,
+				   speed_in - accel->threshold) + FIX16_ONE;
+
+	return min(accel->accel, factor);
+}
+
+static fix16_t
+calculate_acceleration(struct pointer_accelerator_fixed *accel,
+		       fix16_t velocity,
+		       fix16_t last_velocity)
+{
+	fix16_t mid = (fix16_t)(((int64_t)velocity + last_velocity) / 2);
+	fix16_t factor;
+
+	/* Simpson's rule, see filter.c */
+	factor = accel_profile_linear_fixed(accel, velocity);
+	factor += accel_profile_linear_fixed(accel, last_velocity);
+	factor += 4 * accel_profile_linear_fixed(accel, mid);
+
+	return fix16_mul(factor, ONE_SIXTH);
+}
+
+static struct normalized_coords
+accelerator_filter_fixed(struct motion_filter *filter,
+			 const struct normalized_coords *unaccelerated,
+			 void *data, uint64_t time)
+{
+	struct pointer_accelerator_fixed *accel =
+		(struct pointer_accelerator_fixed *) filter;
+	fix16_t dx = fix16_from_double(unaccelerated->x);
+	fix16_t dy = fix16_from_double(unaccelerated->y);
+	fix16_t velocity, factor;
+	struct normalized_coords accelerated;
+
+	feed_trackers(accel, dx, dy, time);
+	velocity = calculate_velocity(accel, time);
+	factor = calculate_acceleration(accel, velocity, accel->last_velocity);
+	accel->last_velocity = velocity;
+
+	accelerated.x = fix16_to_double(fix16_mul(factor, dx));
+	accelerated.y = fix16_to_double(fix16_mul(factor, dy));
+
+	return accelerated;
+}
+
+static struct normalized_coords
+accelerator_filter_noop_fixed(struct motion_filter *filter,
+			      const struct normalized_coords *unaccelerated,
+			      void *data, uint64_t time)
+{
+	return *unaccelerated;
+}
+
+static void
+accelerator_restart_fixed(struct motion_filter *filter,
+			  void *data,
+			  uint64_t time)
+{
+	struct pointer_accelerator_fixed *accel =
+		(struct pointer_accelerator_fixed *) filter;
+	unsigned int offset;
+	struct pointer_tracker_fixed *tracker;
+
+	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
+		tracker = tracker_by_offset(accel, offset);
+		tracker->time = 0;
+		tracker->dir = 0;
+		tracker->dx = 0;
+		tracker->dy = 0;
+	}
+
+	tracker = tracker_by_offset(accel, 0);
+	tracker->time = time;
+	tracker->dir = UNDEFINED_DIRECTION;
+}
+
+static bool
+accelerator_predict_fixed(struct motion_filter *filter,
+			  void *data,
+			  uint64_t time,
+			  struct normalized_coords *predicted)
+{
+	struct pointer_accelerator_fixed *accel =
+		(struct pointer_accelerator_fixed *) filter;
+	struct pointer_tracker_fixed *tracker, *oldest = NULL;
+	struct pointer_tracker_fixed *newest = tracker_by_offset(accel, 0);
+	fix16_t v, initial_velocity = 0;
+	fix16_t factor;
+	unsigned int offset, dir;
+	int64_t tdelta, ahead;
+
+	predicted->x = 0.0;
+	predicted->y = 0.0;
+
+	if (time <= newest->time || time - newest->time > MOTION_TIMEOUT)
+		return true;
+
+	/* Tracker selection as in calculate_velocity_vector() */
+	dir = newest->dir;
+	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
+		tracker = tracker_by_offset(accel, offset);
+
+		if (newest->time - tracker->time > MOTION_TIMEOUT ||
+		    tracker->time > newest->time)
+			break;
+
+		dir &= tracker->dir;
+		if (dir == 0 && offset > 1)
+			break;
+
+		v = calculate_tracker_velocity(tracker, newest->time);
+		if (initial_velocity == 0)
+			initial_velocity = v;
+		else if (fix16_abs(initial_velocity - v) > MAX_VELOCITY_DIFF)
+			break;
+
+		oldest = tracker;
+		if (dir == 0)
+			break;
+	}
+
+	if (!oldest)
+		return true;
+
+	factor = accel_profile_linear_fixed(accel, accel->last_velocity);
+	tdelta = (int64_t)(newest->time - oldest->time + 1);
+	ahead = (int64_t)(time - newest->time);
+
+	/* delta/tdelta is the velocity in units/us, scaled by the time
+	 * ahead of the newest event; ahead <= MOTION_TIMEOUT keeps the
+	 * product well within 64 bits */
+	predicted->x = fix16_to_double(fix16_mul(factor,
+				(fix16_t)(oldest->dx * ahead / tdelta)));
+	predicted->y = fix16_to_double(fix16_mul(factor,
+				(fix16_t)(oldest->dy * ahead / tdelta)));
+
+	return true;
+}
+
+static void
+accelerator_destroy_fixed(struct motion_filter *filter)
+{
+	struct pointer_accelerator_fixed *accel =
+		(struct pointer_accelerator_fixed *) filter;
+
+	free(accel);
+}
+
+static bool
+accelerator_set_speed_fixed(struct motion_filter *filter,
+			    double speed_adjustment)
+{
+	struct pointer_accelerator_fixed *accel =
+		(struct pointer_accelerator_fixed *) filter;
+	fix16_t speed;
+
+	assert(speed_adjustment >= -1.0 && speed_adjustment <= 1.0);
+
+	/* Same magic as accelerator_set_speed(), this is the only place
+	 * the speed is converted, not per event */
+	speed = fix16_from_double(speed_adjustment);
+
+	accel->threshold = DEFAULT_THRESHOLD -
+		fix16_mul(FIX16_CONST(0.25), speed);
+	if (accel->threshold < MINIMUM_THRESHOLD)
+		accel->threshold = MINIMUM_THRESHOLD;
+
+	accel->accel = DEFAULT_ACCELERATION + fix16_mul(speed,
+							FIX16_CONST(1.5));
+	accel->incline = DEFAULT_INCLINE + fix16_mul(speed,
+						     FIX16_CONST(0.75));
+
+	filter->speed_adjustment = speed_adjustment;
+	return true;
+}
+
+struct motion_filter_interface accelerator_interface_fixed = {
+	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
+	.filter = accelerator_filter_fixed,
+	.filter_constant = accelerator_filter_noop_fixed,
+	.restart = accelerator_restart_fixed,
+	.destroy = accelerator_destroy_fixed,
+	.set_speed = accelerator_set_speed_fixed,
+	.predict = accelerator_predict_fixed,
+};
+
+struct motion_filter *
+create_pointer_accelerator_filter_linear_fixed(int dpi)
+{
+	struct pointer_accelerator_fixed *filter;
+
+	filter = zalloc(sizeof *filter);
+	if (filter == NULL)
+		return NULL;
+
+	filter->base.interface = &accelerator_interface_fixed;
+	filter->threshold = DEFAULT_THRESHOLD;
+	filter->accel = DEFAULT_ACCELERATION;
+	filter->incline = DEFAULT_INCLINE;
+
+	return &filter->base;
+}
+
+static struct normalized_coords
+accelerator_filter_flat_fixed(struct motion_filter *filter,
+			      const struct normalized_coords *unaccelerated,
+			      void *data, uint64_t time)
+{
+	struct pointer_accelerator_flat_fixed *accel_filter =
+		(struct pointer_accelerator_flat_fixed *)filter;
+	struct normalized_coords accelerated;
+
+	accelerated.x = fix16_to_double(fix16_mul(accel_filter->factor,
+				fix16_from_double(unaccelerated->x)));
+	accelerated.y = fix16_to_double(fix16_mul(accel_filter->factor,
+				fix16_from_double(unaccelerated->y)));
+
+	return accelerated;
+}
+
+static bool
+accelerator_set_speed_flat_fixed(struct motion_filter *filter,
+				 double speed_adjustment)
+{
+	struct pointer_accelerator_flat_fixed *accel_filter =
+		(struct pointer_accelerator_flat_fixed *)filter;
+
+	assert(speed_adjustment >= -1.0 && speed_adjustment <= 1.0);
+
+	/* 0-200% of the nominal speed, see accelerator_set_speed_flat().
+	 * The dpi factor is folded in so the filter is one multiply */
+	accel_filter->factor = fix16_mul(FIX16_ONE +
+					 fix16_from_double(speed_adjustment),
+					 accel_filter->dpi_factor);
+	filter->speed_adjustment = speed_adjustment;
+
+	return true;
+}
+
+static void
+accelerator_destroy_flat_fixed(struct motion_filter *filter)
+{
+	struct pointer_accelerator_flat_fixed *accel =
+		(struct pointer_accelerator_flat_fixed *) filter;
+
+	free(accel);
+}
+
+struct motion_filter_interface accelerator_interface_flat_fixed = {
+	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT,
+	.filter = accelerator_filter_flat_fixed,
+	.filter_constant = accelerator_filter_noop_fixed,
+	.restart = NULL,
+	.destroy = accelerator_destroy_flat_fixed,
+	.set_speed = accelerator_set_speed_flat_fixed,
+};
+
+struct motion_filter *
+create_pointer_accelerator_filter_flat_fixed(int dpi)
+{
+	struct pointer_accelerator_flat_fixed *filter;
+
+	filter = zalloc(sizeof *filter);
+	if (filter == NULL)
+		return NULL;
+
+	filter->base.interface = &accelerator_interface_flat_fixed;
+	filter->dpi_factor = (fix16_t)(((int64_t)dpi << FIX16_SHIFT) /
+				       DEFAULT_MOUSE_DPI);
+	filter->factor = filter->dpi_factor;
+
+	return &filter->base;
+}
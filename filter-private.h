@@ -42,6 +42,9 @@ struct motion_filter_interface {
 	void (*destroy)(struct motion_filter *filter);
 	bool (*set_speed)(struct motion_filter *filter,
 			  double speed_adjustment);
+	bool (*predict)(struct motion_filter *filter,
+			void *data, uint64_t time,
+			struct normalized_coords *predicted);
 };
 
 struct motion_filter {
@@ -78,6 +78,24 @@ filter_restart(struct motion_filter *filter,
 		filter->interface->restart(filter, data, time);
 }
 
+bool
+filter_predict(struct motion_filter *filter,
+	       void *data, uint64_t time,
+	       double damping,
+	       struct normalized_coords *predicted)
+{
+	if (!filter->interface->predict)
+		return false;
+
+	if (!filter->interface->predict(filter, data, time, predicted))
+		return false;
+
+	predicted->x *= damping;
+	predicted->y *= damping;
+
+	return true;
+}
+
 void
 filter_destroy(struct motion_filter *filter)
 {
@@ -154,6 +172,19 @@ struct pointer_accelerator {
 	double dpi_factor;
 };
 
+#define CUSTOM_ACCEL_MAX_POINTS	64
+#define CUSTOM_ACCEL_BUCKETS	256
+
+struct pointer_accelerator_custom {
+	struct pointer_accelerator base;
+
+	/* The curve sampled at evenly spaced speeds. Filled in once when
+	 * the points are set, the profile only interpolates. */
+	double min_speed;	/* units/ms */
+	double inv_step;	/* buckets per units/ms */
+	double samples[CUSTOM_ACCEL_BUCKETS + 1];
+};
+
 struct pointer_accelerator_flat {
 	struct motion_filter base;
 
@@ -276,6 +307,53 @@ calculate_velocity(struct pointer_accelerator *accel, uint64_t time)
 	return result; /* units/us */
 }
 
+static bool
+calculate_velocity_vector(struct pointer_accelerator *accel,
+			  struct normalized_coords *velocity)
+{
+	struct pointer_tracker *tracker, *newest, *oldest = NULL;
+	double initial_velocity = 0.0;
+	double v, tdelta;
+	unsigned int offset, dir;
+
+	newest = tracker_by_offset(accel, 0);
+	dir = newest->dir;
+
+	/* Same selection as calculate_velocity(), but keep the direction:
+	 * the least recent tracker within the timeout, direction and
+	 * velocity diff limits. */
+	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
+		tracker = tracker_by_offset(accel, offset);
+
+		if (newest->time - tracker->time > MOTION_TIMEOUT ||
+		    tracker->time > newest->time)
+			break;
+
+		dir &= tracker->dir;
+		if (dir == 0 && offset > 1)
+			break;
+
+		v = calculate_tracker_velocity(tracker, newest->time);
+		if (initial_velocity == 0.0)
+			initial_velocity = v;
+		else if (fabs(initial_velocity - v) > MAX_VELOCITY_DIFF)
+			break;
+
+		oldest = tracker;
+		if (dir == 0)
+			break;
+	}
+
+	if (!oldest)
+		return false;
+
+	tdelta = newest->time - oldest->time + 1;
+	velocity->x = oldest->delta.x / tdelta;
+	velocity->y = oldest->delta.y / tdelta;
+
+	return true; /* units/us */
+}
+
 static double
 acceleration_profile(struct pointer_accelerator *accel,
 		     void *data, double velocity, uint64_t time)
@@ -492,6 +570,44 @@ accelerator_restart(struct motion_filter *filter,
 	tracker->dir = UNDEFINED_DIRECTION;
 }
 
+static bool
+accelerator_predict(struct motion_filter *filter,
+		    void *data,
+		    uint64_t time,
+		    struct normalized_coords *predicted)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+	struct pointer_tracker *newest = tracker_by_offset(accel, 0);
+	struct normalized_coords velocity; /* units/us */
+	double accel_factor; /* unitless factor */
+	uint64_t tdelta;
+
+	predicted->x = 0.0;
+	predicted->y = 0.0;
+
+	/* The pointer is considered to have stopped once the motion
+	 * timeout expired, there is nothing to extrapolate */
+	if (time <= newest->time || time - newest->time > MOTION_TIMEOUT)
+		return true;
+
+	if (!calculate_velocity_vector(accel, &velocity))
+		return true;
+
+	/* The velocity history is in the units the profile was fed, so
+	 * applying the factor for the most recent velocity gives the
+	 * delta the filter would produce at the same speed */
+	accel_factor = acceleration_profile(accel, data,
+					    accel->last_velocity,
+					    newest->time);
+	tdelta = time - newest->time;
+
+	predicted->x = accel_factor * velocity.x * tdelta;
+	predicted->y = accel_factor * velocity.y * tdelta;
+
+	return true;
+}
+
 static void
 accelerator_destroy(struct motion_filter *filter)
 {
@@ -732,6 +848,37 @@ trackpoint_accel_profile(struct motion_filter *filter,
 	return factor;
 }
 
+/**
+ * Client supplied curve, see filter_set_custom_points(). The speed is
+ * bucketed into the precomputed table, so this is a multiply and a
+ * linear interpolation between two neighbouring samples.
+ */
+static double
+custom_accel_profile(struct motion_filter *filter,
+		     void *data,
+		     double speed_in, /* 1000-dpi normalized */
+		     uint64_t time)
+{
+	struct pointer_accelerator_custom *accel_filter =
+		(struct pointer_accelerator_custom *)filter;
+	const double *samples = accel_filter->samples;
+	double pos;
+	int i;
+
+	pos = (v_us2ms(speed_in) - accel_filter->min_speed) *
+		accel_filter->inv_step;
+
+	/* Flat beyond the first and last point */
+	if (pos <= 0)
+		return samples[0];
+	if (pos >= CUSTOM_ACCEL_BUCKETS)
+		return samples[CUSTOM_ACCEL_BUCKETS];
+
+	i = (int)pos;
+
+	return samples[i] + (samples[i + 1] - samples[i]) * (pos - i);
+}
+
 struct motion_filter_interface accelerator_interface = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter,
@@ -739,6 +886,7 @@ struct motion_filter_interface accelerator_interface = {
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
 	.set_speed = accelerator_set_speed,
+	.predict = accelerator_predict,
 };
 
 static struct pointer_accelerator *
@@ -787,6 +935,7 @@ struct motion_filter_interface accelerator_interface_low_dpi = {
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
 	.set_speed = accelerator_set_speed,
+	.predict = accelerator_predict,
 };
 
 struct motion_filter *
@@ -811,6 +960,7 @@ struct motion_filter_interface accelerator_interface_touchpad = {
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
 	.set_speed = accelerator_set_speed,
+	.predict = accelerator_predict,
 };
 
 struct motion_filter *
@@ -835,6 +985,7 @@ struct motion_filter_interface accelerator_interface_x230 = {
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
 	.set_speed = accelerator_set_speed,
+	.predict = accelerator_predict,
 };
 
 /* The Lenovo x230 has a bad touchpad. This accel method has been
@@ -874,6 +1025,7 @@ struct motion_filter_interface accelerator_interface_trackpoint = {
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
 	.set_speed = accelerator_set_speed,
+	.predict = accelerator_predict,
 };
 
 struct motion_filter *
@@ -894,6 +1046,139 @@ create_pointer_accelerator_filter_trackpoint(int dpi)
 	return &filter->base;
 }
 
+struct motion_filter_interface accelerator_interface_custom = {
+	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM,
+	.filter = accelerator_filter,
+	.filter_constant = accelerator_filter_noop,
+	.restart = accelerator_restart,
+	.destroy = accelerator_destroy,
+	.set_speed = accelerator_set_speed,
+	.predict = accelerator_predict,
+};
+
+struct motion_filter *
+create_pointer_accelerator_filter_custom(int dpi)
+{
+	struct pointer_accelerator_custom *filter;
+	struct pointer_accelerator *base;
+	int i;
+
+	filter = zalloc(sizeof *filter);
+	if (filter == NULL)
+		return NULL;
+
+	base = &filter->base;
+	base->base.interface = &accelerator_interface_custom;
+	base->profile = custom_accel_profile;
+	base->last_velocity = 0.0;
+	base->trackers =
+		calloc(NUM_POINTER_TRACKERS, sizeof *base->trackers);
+	base->cur_tracker = 0;
+	base->threshold = DEFAULT_THRESHOLD;
+	base->accel = DEFAULT_ACCELERATION;
+	base->incline = DEFAULT_INCLINE;
+	base->dpi_factor = dpi/(double)DEFAULT_MOUSE_DPI;
+
+	/* Until the client sets points the curve is 1:1 */
+	filter->min_speed = 0.0;
+	filter->inv_step = 1.0;
+	for (i = 0; i <= CUSTOM_ACCEL_BUCKETS; i++)
+		filter->samples[i] = 1.0;
+
+	return &base->base;
+}
+
+bool
+filter_set_custom_points(struct motion_filter *filter,
+			 const double *speeds,
+			 const double *factors,
+			 size_t npoints)
+{
+	struct pointer_accelerator_custom *accel_filter =
+		(struct pointer_accelerator_custom *)filter;
+	double delta[CUSTOM_ACCEL_MAX_POINTS];	/* secant slopes */
+	double tangent[CUSTOM_ACCEL_MAX_POINTS];
+	double a, b, h, t, t2, t3, x, y, step;
+	size_t k;
+	int i;
+
+	if (filter->interface != &accelerator_interface_custom)
+		return false;
+
+	if (npoints < 2 || npoints > CUSTOM_ACCEL_MAX_POINTS)
+		return false;
+
+	for (k = 0; k < npoints; k++) {
+		if (!isfinite(speeds[k]) || speeds[k] < 0.0 ||
+		    !isfinite(factors[k]) || factors[k] < 0.0)
+			return false;
+		if (k > 0 && speeds[k] <= speeds[k - 1])
+			return false;
+	}
+
+	/*
+	 * Fritsch-Carlson monotone cubic interpolation: the curve goes
+	 * through every point and never overshoots between them, so a
+	 * monotone set of points gives a monotone curve.
+	 */
+	for (k = 0; k < npoints - 1; k++)
+		delta[k] = (factors[k + 1] - factors[k]) /
+			   (speeds[k + 1] - speeds[k]);
+
+	tangent[0] = delta[0];
+	tangent[npoints - 1] = delta[npoints - 2];
+	for (k = 1; k < npoints - 1; k++) {
+		if (delta[k - 1] * delta[k] <= 0.0)
+			tangent[k] = 0.0;
+		else
+			tangent[k] = (delta[k - 1] + delta[k]) / 2.0;
+	}
+
+	for (k = 0; k < npoints - 1; k++) {
+		if (delta[k] == 0.0) {
+			tangent[k] = 0.0;
+			tangent[k + 1] = 0.0;
+			continue;
+		}
+
+		a = tangent[k] / delta[k];
+		b = tangent[k + 1] / delta[k];
+		h = a * a + b * b;
+		if (h > 9.0) {
+			t = 3.0 / sqrt(h);
+			tangent[k] = t * a * delta[k];
+			tangent[k + 1] = t * b * delta[k];
+		}
+	}
+
+	step = (speeds[npoints - 1] - speeds[0]) / CUSTOM_ACCEL_BUCKETS;
+
+	k = 0;
+	for (i = 0; i <= CUSTOM_ACCEL_BUCKETS; i++) {
+		x = speeds[0] + i * step;
+		while (k < npoints - 2 && x > speeds[k + 1])
+			k++;
+
+		h = speeds[k + 1] - speeds[k];
+		t = min(1.0, max(0.0, (x - speeds[k]) / h));
+		t2 = t * t;
+		t3 = t2 * t;
+
+		/* Cubic Hermite basis */
+		y = (2 * t3 - 3 * t2 + 1) * factors[k] +
+		    (t3 - 2 * t2 + t) * h * tangent[k] +
+		    (-2 * t3 + 3 * t2) * factors[k + 1] +
+		    (t3 - t2) * h * tangent[k + 1];
+
+		accel_filter->samples[i] = max(0.0, y);
+	}
+
+	accel_filter->min_speed = speeds[0];
+	accel_filter->inv_step = 1.0 / step;
+
+	return true;
+}
+
 static struct normalized_coords
 accelerator_filter_flat(struct motion_filter *filter,
 			const struct normalized_coords *unaccelerated,
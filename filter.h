@@ -63,6 +63,19 @@ void
 filter_restart(struct motion_filter *filter,
 	       void *data, uint64_t time);
 
+/**
+ * Extrapolate the accelerated motion to the given time, based on the
+ * velocity of the most recent motion. The result is the delta expected
+ * between the most recent event and the given time, scaled by damping.
+ *
+ * @return false if the filter does not keep a motion history
+ */
+bool
+filter_predict(struct motion_filter *filter,
+	       void *data, uint64_t time,
+	       double damping,
+	       struct normalized_coords *predicted);
+
 void
 filter_destroy(struct motion_filter *filter);
 
@@ -102,6 +115,33 @@ create_pointer_accelerator_filter_trackpoint(int dpi);
 struct motion_filter *
 create_pointer_accelerator_filter_tablet(int xres, int yres);
 
+struct motion_filter *
+create_pointer_accelerator_filter_custom(int dpi);
+
+#ifdef LIBINPUT_FIXED_ACCEL
+/* Q16.16 fixed-point variants of the linear and flat filters, filter-fixed.c */
+struct motion_filter *
+create_pointer_accelerator_filter_linear_fixed(int dpi);
+
+struct motion_filter *
+create_pointer_accelerator_filter_flat_fixed(int dpi);
+#endif
+
+/**
+ * Replace the curve of a filter created with
+ * create_pointer_accelerator_filter_custom(). Speeds are in 1000-dpi
+ * normalized units/ms and must be strictly increasing, factors are
+ * unitless and non-negative.
+ *
+ * @return false if the filter is not a custom one or the points are
+ * invalid, the previous curve is kept in that case
+ */
+bool
+filter_set_custom_points(struct motion_filter *filter,
+			 const double *speeds,
+			 const double *factors,
+			 size_t npoints);
+
 /*
  * Pointer acceleration profiles.
  */
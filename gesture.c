@@ -0,0 +1,323 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <string.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "filter.h"
+#include "libinput-private.h"
+#include "gesture.h"
+
+/* Centroid travel or spread change that starts a gesture */
+#define GESTURE_THRESHOLD_MM	3.0
+/* Without a resolution, the same as a fraction of the diagonal */
+#define GESTURE_THRESHOLD_DIAG	0.03
+/* Rotation of the anchor fingers that makes it a pinch */
+#define GESTURE_PINCH_ANGLE	10.0
+
+void
+gesture_init(struct gesture *g, const struct device_abs *abs)
+{
+	memset(g, 0, sizeof(*g));
+	g->anchor[0] = -1;
+	g->anchor[1] = -1;
+	g->mode = GESTURE_NONE;
+
+	/* Normalized units are those of a 1000dpi mouse */
+	g->norm_x = abs->res_x > 0 ? 1000.0 / 25.4 / abs->res_x : 1.0;
+	g->norm_y = abs->res_y > 0 ? 1000.0 / 25.4 / abs->res_y : 1.0;
+
+	if (abs->res_x > 0)
+		g->threshold = GESTURE_THRESHOLD_MM * abs->res_x;
+	else
+		g->threshold = GESTURE_THRESHOLD_DIAG *
+			       hypot(abs->max_x - abs->min_x,
+				     abs->max_y - abs->min_y);
+}
+
+void
+gesture_contact_down(struct gesture *g, int contact,
+		     const struct device_coords *point)
+{
+	struct gesture_contact *c = &g->contacts[contact];
+
+	if (c->down) {
+		gesture_contact_move(g, contact, point);
+		return;
+	}
+
+	c->down = true;
+	c->x = point->x;
+	c->y = point->y;
+	g->sum_x += c->x;
+	g->sum_y += c->y;
+	g->sum_sq += (int64_t)c->x * c->x + (int64_t)c->y * c->y;
+	g->ncontacts++;
+	g->count_changed = true;
+}
+
+void
+gesture_contact_move(struct gesture *g, int contact,
+		     const struct device_coords *point)
+{
+	struct gesture_contact *c = &g->contacts[contact];
+
+	if (!c->down || (c->x == point->x && c->y == point->y))
+		return;
+
+	g->sum_x += point->x - c->x;
+	g->sum_y += point->y - c->y;
+	g->sum_sq += (int64_t)point->x * point->x + (int64_t)point->y * point->y -
+		     (int64_t)c->x * c->x - (int64_t)c->y * c->y;
+	c->x = point->x;
+	c->y = point->y;
+	g->moved = true;
+}
+
+void
+gesture_contact_up(struct gesture *g, int contact)
+{
+	struct gesture_contact *c = &g->contacts[contact];
+
+	if (!c->down)
+		return;
+
+	c->down = false;
+	g->sum_x -= c->x;
+	g->sum_y -= c->y;
+	g->sum_sq -= (int64_t)c->x * c->x + (int64_t)c->y * c->y;
+	g->ncontacts--;
+	g->count_changed = true;
+}
+
+/* Root mean square distance of the contacts from the centroid */
+static double
+gesture_spread(const struct gesture *g, double cx, double cy)
+{
+	double var;
+
+	var = (double)g->sum_sq / g->ncontacts - cx * cx - cy * cy;
+
+	return var > 0.0 ? sqrt(var) : 0.0;
+}
+
+/* Direction of the line through the anchors in degrees, y pointing down */
+static double
+gesture_angle(const struct gesture *g)
+{
+	const struct gesture_contact *a = &g->contacts[g->anchor[0]];
+	const struct gesture_contact *b = &g->contacts[g->anchor[1]];
+
+	return atan2((b->y - a->y) * g->norm_y,
+		     (b->x - a->x) * g->norm_x) * 180.0 / M_PI;
+}
+
+static double
+gesture_angle_diff(double a, double b)
+{
+	double d = a - b;
+
+	if (d > 180.0)
+		d -= 360.0;
+	else if (d <= -180.0)
+		d += 360.0;
+
+	return d;
+}
+
+static void
+gesture_start(struct gesture *g)
+{
+	int i, n = 0;
+
+	for (i = 0; i < GESTURE_MAX_CONTACTS && n < 2; i++) {
+		if (g->contacts[i].down)
+			g->anchor[n++] = i;
+	}
+
+	g->mode = GESTURE_UNKNOWN;
+	g->finger_count = g->ncontacts;
+	g->start_x = g->last_x = (double)g->sum_x / g->ncontacts;
+	g->start_y = g->last_y = (double)g->sum_y / g->ncontacts;
+	g->start_spread = gesture_spread(g, g->start_x, g->start_y);
+	g->start_angle = g->last_angle = gesture_angle(g);
+	g->scale = 1.0;
+}
+
+static void
+gesture_end(struct libinput_device *device, struct gesture *g,
+	    uint64_t time, bool cancelled)
+{
+	switch (g->mode) {
+	case GESTURE_SWIPE:
+		gesture_notify_swipe_end(device, time, g->finger_count,
+					 cancelled);
+		break;
+	case GESTURE_PINCH:
+		gesture_notify_pinch_end(device, time, g->finger_count,
+					 g->scale, cancelled);
+		break;
+	default:
+		break;
+	}
+
+	g->mode = GESTURE_NONE;
+	g->anchor[0] = -1;
+	g->anchor[1] = -1;
+}
+
+/* Decide between swipe and pinch once the fingers moved far enough */
+static void
+gesture_classify(struct libinput_device *device, struct gesture *g,
+		 uint64_t time, double cx, double cy)
+{
+	const struct normalized_coords zero = { 0.0, 0.0 };
+	double spread;
+
+	spread = gesture_spread(g, cx, cy);
+	if (fabs(spread - g->start_spread) > g->threshold ||
+	    fabs(gesture_angle_diff(gesture_angle(g), g->start_angle)) >
+	    GESTURE_PINCH_ANGLE) {
+		g->mode = GESTURE_PINCH;
+		g->start_spread = max(spread, 1.0);
+		g->last_angle = gesture_angle(g);
+		gesture_notify_pinch(device, time,
+				     LIBINPUT_EVENT_GESTURE_PINCH_BEGIN,
+				     g->finger_count, &zero, &zero, 1.0, 0.0);
+	} else if (hypot(cx - g->start_x, cy - g->start_y) > g->threshold) {
+		g->mode = GESTURE_SWIPE;
+		gesture_notify_swipe(device, time,
+				     LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN,
+				     g->finger_count, &zero, &zero);
+	}
+}
+
+static void
+gesture_pointer_motion(struct libinput_device *device, struct gesture *g,
+		       uint64_t time, double dx, double dy)
+{
+	struct normalized_coords unaccel, accel;
+	struct device_float_coords raw;
+
+	if (!libinput_motion_wanted(device->seat->libinput))
+		return;
+
+	raw.x = dx;
+	raw.y = dy;
+	unaccel.x = dx * g->norm_x;
+	unaccel.y = dy * g->norm_y;
+
+	if (device->filter)
+		accel = filter_dispatch(device->filter, &unaccel, device, time);
+	else
+		accel = unaccel;
+
+	pointer_notify_motion(device, time, &accel, &raw);
+}
+
+/*
+ * Post what the contact changes since the last call amount to. One finger
+ * moves the pointer, two or more make a swipe or a pinch. A change in
+ * the number of fingers ends the gesture, lifting all but one finger ends
+ * it normally, anything else cancels it.
+ */
+void
+gesture_frame(struct libinput_device *device, struct gesture *g,
+	      uint64_t time)
+{
+	struct normalized_coords unaccel, accel;
+	double cx, cy, angle;
+
+	if (g->count_changed) {
+		g->count_changed = false;
+		g->moved = false;
+
+		gesture_end(device, g, time, g->ncontacts >= 2);
+		if (g->ncontacts >= 2) {
+			gesture_start(g);
+		} else if (g->ncontacts == 1) {
+			g->last_x = g->sum_x;
+			g->last_y = g->sum_y;
+		}
+		return;
+	}
+
+	if (!g->moved)
+		return;
+	g->moved = false;
+
+	cx = (double)g->sum_x / g->ncontacts;
+	cy = (double)g->sum_y / g->ncontacts;
+
+	switch (g->mode) {
+	case GESTURE_NONE:
+		gesture_pointer_motion(device, g, time,
+				       cx - g->last_x, cy - g->last_y);
+		break;
+	case GESTURE_UNKNOWN:
+		gesture_classify(device, g, time, cx, cy);
+		break;
+	case GESTURE_SWIPE:
+	case GESTURE_PINCH:
+		unaccel.x = (cx - g->last_x) * g->norm_x;
+		unaccel.y = (cy - g->last_y) * g->norm_y;
+		if (device->filter)
+			accel = filter_dispatch(device->filter, &unaccel,
+						device, time);
+		else
+			accel = unaccel;
+
+		if (g->mode == GESTURE_SWIPE) {
+			gesture_notify_swipe(device, time,
+					     LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE,
+					     g->finger_count, &accel, &unaccel);
+			break;
+		}
+
+		angle = gesture_angle(g);
+		g->scale = gesture_spread(g, cx, cy) / g->start_spread;
+		gesture_notify_pinch(device, time,
+				     LIBINPUT_EVENT_GESTURE_PINCH_UPDATE,
+				     g->finger_count, &accel, &unaccel,
+				     g->scale,
+				     gesture_angle_diff(angle, g->last_angle));
+		g->last_angle = angle;
+		break;
+	}
+
+	g->last_x = cx;
+	g->last_y = cy;
+}
+
+/*
+ * End a gesture in progress as cancelled, e.g. when the device goes away
+ * with the fingers still down. Lifting the contacts afterwards posts
+ * nothing more.
+ */
+void
+gesture_cancel(struct libinput_device *device, struct gesture *g,
+	       uint64_t time)
+{
+	gesture_end(device, g, time, true);
+}
@@ -0,0 +1,93 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Touchpad gesture recognizer. Contacts are fed in as they change, the
+ * centroid, spread and angle are kept up to date from those changes, so
+ * a frame costs the same no matter how many fingers are down.
+ */
+
+#ifndef _GESTURE_H_
+#define _GESTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define GESTURE_MAX_CONTACTS	16
+
+struct libinput_device;
+struct device_abs;
+struct device_coords;
+
+enum gesture_mode {
+	GESTURE_NONE,		/* fewer than two fingers */
+	GESTURE_UNKNOWN,	/* fingers down, not yet classified */
+	GESTURE_SWIPE,
+	GESTURE_PINCH,
+};
+
+struct gesture_contact {
+	bool down;
+	int x, y;
+};
+
+struct gesture {
+	struct gesture_contact contacts[GESTURE_MAX_CONTACTS];
+	int ncontacts;
+	bool count_changed;	/* a contact went down or up this frame */
+	bool moved;
+
+	/* Running sums over the contacts that are down */
+	int64_t sum_x, sum_y;
+	int64_t sum_sq;		/* of x * x + y * y */
+
+	/* The two contacts that give the angle, -1 if unset */
+	int anchor[2];
+
+	enum gesture_mode mode;
+	int finger_count;
+
+	/* At the start of the gesture and at the previous frame */
+	double start_x, start_y;
+	double start_spread;
+	double start_angle;
+	double last_x, last_y;
+	double last_angle;
+	double scale;
+
+	/* Device units to normalized (1000dpi) units */
+	double norm_x, norm_y;
+	/* Centroid travel or spread change that decides the gesture */
+	double threshold;
+};
+
+void gesture_init(struct gesture *g, const struct device_abs *abs);
+void gesture_contact_down(struct gesture *g, int contact,
+			  const struct device_coords *point);
+void gesture_contact_move(struct gesture *g, int contact,
+			  const struct device_coords *point);
+void gesture_contact_up(struct gesture *g, int contact);
+void gesture_frame(struct libinput_device *device, struct gesture *g,
+		   uint64_t time);
+void gesture_cancel(struct libinput_device *device, struct gesture *g,
+		    uint64_t time);
+
+#endif /* !_GESTURE_H_ */
@@ -35,6 +35,11 @@
 
 #define BTN_JOYSTICK		21			/* 0x120 */
 
+/* Tablet tool buttons, not from wscons(4). */
+#define BTN_STYLUS		22			/* 0x14b */
+#define BTN_STYLUS2		23			/* 0x14c */
+#define BTN_STYLUS3		24			/* 0x149 */
+
 #define KEY_MAX			255
 #define KEY_CNT			KEY_MAX+1
 
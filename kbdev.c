@@ -35,14 +35,29 @@
 
 #include "kbdev.h"
 
+#define KBDEV_BUFSIZE	512
+
 struct kbdev_state {
 	int kbdfd;
 
 	uint8_t lastread_code;
 
+	/*
+	 * Scancodes read from the tty but not yet returned as events.
+	 * Only refilled once empty, so this never needs to wrap.
+	 */
+	uint8_t buf[KBDEV_BUFSIZE];
+	size_t bufpos;
+	size_t buflen;
+
 	/* Just track all keys for now, to avoid stuck modifiers */
 	uint8_t pressed[256];
 	int npressed;
+
+	/* Presses of keys that were already down, for the caller to log */
+	unsigned int nrepeated;
+	uint8_t repeated_atcode;
+	int repeated_keycode;
 };
 
 static struct kbdev_event atcode_to_event(uint8_t atcode);
@@ -63,7 +78,7 @@ atcode_to_event(uint8_t atcode)
 		 * Translate keycodes as in sys/dev/misc/kbd/atkbd.c
 		 * from DragonFly to evdev key values.
 		 */
-		int code_to_key[128] = {
+		static const int code_to_key[128] = {
 			[0x54] = 99,	/* sysrq */
 			[0x59] = 96,	/* right enter key */
 			[0x5a] = 97,	/* right ctrl key */
@@ -154,8 +169,9 @@ kbdev_new_state(int fd)
 	if (state == NULL)
 		return NULL;
 
+	/* Without a tty, scancodes only come from kbdev_push_scancodes() */
 	state->kbdfd = fd;
-	if (ioctl(state->kbdfd, KDSKBMODE, K_CODE) != 0) {
+	if (fd != -1 && ioctl(state->kbdfd, KDSKBMODE, K_CODE) != 0) {
 		warn("KDSKBMODE");
 		free(state);
 		return NULL;
@@ -167,7 +183,8 @@ kbdev_new_state(int fd)
 void
 kbdev_destroy_state(struct kbdev_state *state)
 {
-	if (ioctl(state->kbdfd, KDSKBMODE, K_XLATE) != 0) {
+	if (state->kbdfd != -1 &&
+	    ioctl(state->kbdfd, KDSKBMODE, K_XLATE) != 0) {
 		warn("KDSKBMODE");
 	}
 	free(state);
@@ -178,61 +195,119 @@ kbdev_reset_state(struct kbdev_state *state)
 {
 	state->lastread_code = 0;
 	state->npressed = 0;
+	state->bufpos = 0;
+	state->buflen = 0;
+}
+
+size_t
+kbdev_buffered(struct kbdev_state *state)
+{
+	return state->buflen - state->bufpos;
+}
+
+/*
+ * Append scancodes as if the tty had queued them, for feeding a state
+ * without a tty. Returns how many fit in the buffer.
+ */
+size_t
+kbdev_push_scancodes(struct kbdev_state *state, const uint8_t *codes,
+		     size_t len)
+{
+	if (state->bufpos == state->buflen) {
+		state->bufpos = 0;
+		state->buflen = 0;
+	}
+
+	if (len > sizeof(state->buf) - state->buflen)
+		len = sizeof(state->buf) - state->buflen;
+	memcpy(&state->buf[state->buflen], codes, len);
+	state->buflen += len;
+
+	return len;
 }
 
-/* Returns -1 on error, 0 on end-of-file, number-of-events read otherwise */
+/*
+ * Returns -1 on error, 0 on end-of-file, number-of-events read otherwise.
+ * Issues at most one read(), and only when nothing is buffered.
+ */
 int
 kbdev_read_events(struct kbdev_state *state, struct kbdev_event *out, int cnt)
 {
-	uint8_t buf[128];
 	struct kbdev_event ev;
-	int n = 0, val, i;
+	ssize_t val;
+	uint8_t code;
+	int n = 0;
 
-	while (n < cnt) {
-		val = read(state->kbdfd, buf,
-		    MIN((unsigned)cnt - n, sizeof(buf)));
+	if (state->bufpos == state->buflen) {
+		state->bufpos = 0;
+		state->buflen = 0;
+
+		/* Take whatever the tty has queued in one go */
+		val = read(state->kbdfd, state->buf, sizeof(state->buf));
 		if (val == 0) {
-			return n;
+			return 0;
 		} else if (val < 0) {
 			if (errno == EAGAIN)
-				return n;
+				return 0;
 			else
 				return val;
 		}
+		state->buflen = val;
+	}
 
-		for (i = 0; i < val; i++) {
-			if (state->lastread_code == buf[i] &&
-			    !(buf[i] & 0x80)) {
-				continue;
-			}
+	while (n < cnt && state->bufpos < state->buflen) {
+		code = state->buf[state->bufpos++];
 
-			ev = atcode_to_event(buf[i]);
-			if (ev.keycode == 0)
-				continue;
+		if (state->lastread_code == code && !(code & 0x80))
+			continue;
 
-			state->lastread_code = buf[i];
+		ev = atcode_to_event(code);
+		if (ev.keycode == 0)
+			continue;
 
-			/*
-			 * XXX Debug this issue
-			 *     (might be Latitude E5450 specific)
-			 */
-			if (ev.pressed && ispressed(state, buf[i] & 0x7f))
-				warnx("atcode 0x%02x keycode 0x%02x was "
-				    "already pressed", buf[i], ev.keycode);
+		state->lastread_code = code;
 
-			if (ev.pressed)
-				press(state, buf[i] & 0x7f);
-			else
-				release(state, buf[i] & 0x7f);
+		/*
+		 * Drop releases of keys we never reported as
+		 * pressed, e.g. keys held down across a resume.
+		 */
+		if (!ev.pressed && !ispressed(state, code & 0x7f))
+			continue;
 
-			out[n] = ev;
-			n++;
+		/*
+		 * XXX Debug this issue
+		 *     (might be Latitude E5450 specific)
+		 */
+		if (ev.pressed && ispressed(state, code & 0x7f)) {
+			state->nrepeated++;
+			state->repeated_atcode = code;
+			state->repeated_keycode = ev.keycode;
 		}
+
+		if (ev.pressed)
+			press(state, code & 0x7f);
+		else
+			release(state, code & 0x7f);
+
+		out[n] = ev;
+		n++;
 	}
 
 	return n;
 }
 
+unsigned int
+kbdev_take_repeated(struct kbdev_state *state, int *atcode, int *keycode)
+{
+	unsigned int n = state->nrepeated;
+
+	*atcode = state->repeated_atcode;
+	*keycode = state->repeated_keycode;
+	state->nrepeated = 0;
+
+	return n;
+}
+
 /* Returns 0 if no more pressed keys in queue, 1 otherwise */
 int
 kbdev_pop_pressed(struct kbdev_state *state, struct kbdev_event *out)
@@ -42,6 +42,17 @@ void kbdev_reset_state(struct kbdev_state *state);
 /* The fd needs to be set to non-blocking before calling this function */
 int kbdev_read_events(struct kbdev_state *state, struct kbdev_event *out,
 		      int cnt);
+/* Number of scancode bytes read but not yet returned as events */
+size_t kbdev_buffered(struct kbdev_state *state);
+size_t kbdev_push_scancodes(struct kbdev_state *state, const uint8_t *codes,
+			    size_t len);
+
+/*
+ * Number of presses of keys that were already down since the last call,
+ * atcode and keycode are set to the most recent one.
+ */
+unsigned int kbdev_take_repeated(struct kbdev_state *state, int *atcode,
+				 int *keycode);
 
 int kbdev_pop_pressed(struct kbdev_state *state, struct kbdev_event *out);
 
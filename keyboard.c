@@ -33,25 +33,107 @@
 #include "libinput-util.h"
 #include "libinput-private.h"
 
-void
+static void
 keyboard_device_dispatch(void *data)
 {
 	struct libinput_device *device = data;
+	struct libinput *libinput = device->seat->libinput;
 	struct kbdev_event evs[64];
 	struct timespec ts;
 	uint64_t time;
-	int i, n;
-
-	n = kbdev_read_events(device->kbdst, evs, 64);
-	if (n <= 0)
-		return;
+	int i, n, atcode, keycode;
+	unsigned int nrepeated;
 
         clock_gettime(CLOCK_MONOTONIC, &ts);
         time = ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 
-	for (i = 0; i < n; i++) {
-		keyboard_notify_key(device, time, evs[i].keycode,
-		    evs[i].pressed ? LIBINPUT_KEY_STATE_PRESSED
-				   : LIBINPUT_KEY_STATE_RELEASED);
-	}
+	/* One read fills the kbdev buffer, then consume all of it */
+	do {
+		n = kbdev_read_events(device->kbdst, evs, 64);
+		if (n < 0)
+			return;
+
+		for (i = 0; i < n; i++) {
+			keyboard_notify_key(device, time, evs[i].keycode,
+			    evs[i].pressed ? LIBINPUT_KEY_STATE_PRESSED
+					   : LIBINPUT_KEY_STATE_RELEASED);
+		}
+	} while (kbdev_buffered(device->kbdst) > 0);
+
+	/* Presses without a release in between, see kbdev_read_events() */
+	nrepeated = kbdev_take_repeated(device->kbdst, &atcode, &keycode);
+	if (nrepeated > 0)
+		log_info_ratelimit(libinput,
+				   &libinput->log_ratelimit.kbd_repeat,
+				   "%s: atcode 0x%02x keycode 0x%02x was already pressed (%u repeated presses)\n",
+				   device->devname, atcode, keycode, nrepeated);
+}
+
+static void
+keyboard_release_keys(struct libinput_device *device, uint64_t time)
+{
+	struct kbdev_event ev;
+
+	while (kbdev_pop_pressed(device->kbdst, &ev))
+		keyboard_notify_key(device, time, ev.keycode,
+		    LIBINPUT_KEY_STATE_RELEASED);
+}
+
+static int
+keyboard_device_init(struct libinput_device *device)
+{
+	device->kbdst = kbdev_new_state(device->fd);
+	if (device->kbdst == NULL)
+		return -1;
+
+	device->caps = DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_KEYBOARD);
+
+	return 0;
+}
+
+static void
+keyboard_device_destroy(struct libinput_device *device)
+{
+	if (device->kbdst == NULL)
+		return;
+
+	/* Switches the keyboard back to K_XLATE */
+	kbdev_destroy_state(device->kbdst);
+	device->kbdst = NULL;
+}
+
+static void
+keyboard_device_reset(struct libinput_device *device)
+{
+	kbdev_reset_state(device->kbdst);
+}
+
+static void
+keyboard_led_update(struct libinput_device *device, enum libinput_led leds)
+{
+	int mask = 0;
+
+	if (device->kbdst == NULL)
+		return;
+
+	/*
+	 * XXX We could directly use leds as mask, but this should
+	 *     be better for future proofing the code.
+	 */
+	if (leds & LIBINPUT_LED_NUM_LOCK)
+		mask |= (1 << 0);
+	if (leds & LIBINPUT_LED_CAPS_LOCK)
+		mask |= (1 << 1);
+	if (leds & LIBINPUT_LED_SCROLL_LOCK)
+		mask |= (1 << 2);
+	kbdev_set_leds(device->kbdst, mask);
 }
+
+const struct libinput_device_interface keyboard_interface = {
+	.dispatch = keyboard_device_dispatch,
+	.init = keyboard_device_init,
+	.destroy = keyboard_device_destroy,
+	.suspend = keyboard_release_keys,
+	.reset = keyboard_device_reset,
+	.led_update = keyboard_led_update,
+};
@@ -83,9 +83,30 @@ struct tablet_axes {
 };
 
 
+#define LIBINPUT_EVENT_TYPE_MAX LIBINPUT_EVENT_GESTURE_PINCH_END
+
+/*
+ * Progress of one event queue, the counters are free-running. A device is
+ * freed once every queue it posted to has taken and released everything
+ * that was posted before its last reference was dropped, so events don't
+ * hold a device reference.
+ */
+struct event_epoch {
+	uint32_t posted;	/* written by the dispatching thread */
+	/* Written by the queue's consumer */
+	uint32_t taken __attribute__((aligned(64)));
+	uint32_t released;	/* events destroyed */
+};
+
+#define TABLET_TOOL_HASH_SIZE	64	/* power of two */
+
 struct libinput {
 	int kq;
 	struct udev *udev_ctx;
+	/* Only set for contexts created with libinput_udev_create_context */
+	struct udev_monitor *udev_monitor;
+	struct libinput_source *udev_monitor_source;
+	bool udev_seat_assigned;
 	struct list source_destroy_list;
 
 	struct list seat_list;
@@ -95,13 +116,45 @@ struct libinput {
 	size_t events_len;
 	size_t events_in;
 	size_t events_out;
+	struct event_epoch events_epoch;
+
+	/* Event types the caller doesn't want, these are never allocated */
+	unsigned char events_masked[NCHARS(LIBINPUT_EVENT_TYPE_MAX + 1)];
+
+	enum libinput_event_queue_mode event_queue_mode;
+	/* Devices whose last reference was dropped, linked through
+	 * dead_next. Pushed from any thread, libinput_dispatch() moves
+	 * them to retired_devices */
+	struct libinput_device *dead_devices;
+	/* Waiting for their events to be released, dispatching thread only */
+	struct libinput_device *retired_devices;
+	uint32_t next_device_id;
+
+	struct motion_batch *motion_batch;	/* NULL unless enabled */
+
+	/* Tablet tools, chained by hash of (serial, tool_id, type) */
+	struct list tool_hash[TABLET_TOOL_HASH_SIZE];
 
-	struct list tool_list;
+	/* Device fds are closed between libinput_suspend/_resume */
+	bool suspended;
+
+	/* mmap'd quirks index, NULL if there is none */
+	struct quirks_db *quirks;
 
 	const struct libinput_interface *interface;
 
 	libinput_log_handler log_handler;
 	enum libinput_log_priority log_priority;
+	enum libinput_log_mode log_mode;
+	struct log_ring *log_ring;	/* NULL in LIBINPUT_LOG_MODE_SYNC */
+
+	/* Log sites that may fire for every event */
+	struct {
+		struct ratelimit device_cap;
+		struct ratelimit kbd_repeat;
+		struct ratelimit event_queue;
+		struct ratelimit motion_batch;
+	} log_ratelimit;
 	void *user_data;
 	int refcount;
 };
@@ -116,6 +169,10 @@ struct libinput_seat {
 	char *physical_name;
 	char *logical_name;
 
+	uint32_t slot_map;	/* seat slots in use, see seat_slot_alloc() */
+
+	struct event_queue *queue;	/* LIBINPUT_EVENT_QUEUE_SEAT only */
+
 	uint32_t button_count[KEY_CNT];
 };
 
@@ -130,6 +187,7 @@ struct libinput_device_config {
 	struct libinput_device_config_click_method *click_method;
 	struct libinput_device_config_middle_emulation *middle_emulation;
 	struct libinput_device_config_dwt *dwt;
+	struct libinput_device_config_scroll_coalesce *scroll_coalesce;
 };
 
 struct libinput_device_config_accel {
@@ -144,16 +202,98 @@ struct libinput_device_config_accel {
 						   enum libinput_config_accel_profile);
 	enum libinput_config_accel_profile (*get_profile)(struct libinput_device *device);
 	enum libinput_config_accel_profile (*get_default_profile)(struct libinput_device *device);
+	enum libinput_config_status (*set_custom_points)(struct libinput_device *device,
+							 const double *speeds,
+							 const double *factors,
+							 size_t npoints);
+};
+
+struct libinput_device_config_calibration {
+	int (*has_matrix)(struct libinput_device *device);
+	enum libinput_config_status (*set_matrix)(struct libinput_device *device,
+						  const float matrix[6]);
+	int (*get_matrix)(struct libinput_device *device,
+			  float matrix[6]);
+	int (*get_default_matrix)(struct libinput_device *device,
+				  float matrix[6]);
+};
+
+struct libinput_device_config_send_events {
+	uint32_t (*get_modes)(struct libinput_device *device);
+	enum libinput_config_status (*set_mode)(struct libinput_device *device,
+						   enum libinput_config_send_events_mode mode);
+	enum libinput_config_send_events_mode (*get_mode)(struct libinput_device *device);
+	enum libinput_config_send_events_mode (*get_default_mode)(struct libinput_device *device);
+};
+
+struct libinput_device_config_scroll_coalesce {
+	enum libinput_config_status (*set_window)(struct libinput_device *device,
+						  uint32_t ms);
+	uint32_t (*get_window)(struct libinput_device *device);
+	uint32_t (*get_default_window)(struct libinput_device *device);
 };
 
 struct libinput_device_group {
 };
 
-enum devkind {
-	TTYKBD = 1,
-	SYSMOUSE
+/* Wheel clicks merged into one axis event, see sysmouse_scroll() */
+struct scroll_coalesce {
+	struct libinput_source *timer;
+	uint32_t window;	/* ms, 0 posts every click right away */
+	uint64_t first;		/* time of the first merged click */
+	uint64_t last;		/* time of the latest merged click */
+	int vclicks;
+	int hclicks;
 };
 
+/*
+ * Absolute pointer axes. The backend fills in the ranges, the calibration
+ * is kept across suspend and unit is rebuilt whenever either changes.
+ */
+struct device_abs {
+	int min_x, max_x, res_x;	/* res in units/mm, 0 if unknown */
+	int min_y, max_y, res_y;
+	float calibration[6];
+	float default_calibration[6];
+	/* Device coordinates to the calibrated unit square */
+	double unit[2][3];
+};
+
+/* Per-device settings from the quirks database, 0 where it has none */
+struct device_quirks {
+	int dpi;
+	int wheel_click_angle;	/* degrees */
+	enum libinput_config_accel_profile accel_profile;
+};
+
+typedef void (*libinput_source_dispatch_t)(void *data);
+
+/*
+ * Operations of a device backend. Each backend (sysmouse.c, keyboard.c,
+ * evdev.c) provides one table, the core only goes through it.
+ */
+struct libinput_device_interface {
+	libinput_source_dispatch_t dispatch;
+	/* Set up a freshly opened fd and device->caps, -1 on error */
+	int (*init)(struct libinput_device *device);
+	/* Undo init, the fd stays open */
+	void (*destroy)(struct libinput_device *device);
+	/* Post releases for everything held down, the device stops
+	 * reporting until it is re-enabled or resumed */
+	void (*suspend)(struct libinput_device *device, uint64_t time);
+	/* Optional: forget partially read input after the fd was drained */
+	void (*reset)(struct libinput_device *device);
+	/* Optional */
+	void (*led_update)(struct libinput_device *device,
+			   enum libinput_led leds);
+	/* Optional: set up device->filter for the profile, 0 without
+	 * anything to accelerate, -1 on error */
+	int (*init_accel)(struct libinput_device *device,
+			  enum libinput_config_accel_profile profile);
+};
+
+#define DEVICE_CAP_BIT(cap_) (1u << (cap_))
+
 struct libinput_device {
 	struct libinput_seat *seat;
 	struct list link;
@@ -162,16 +302,53 @@ struct libinput_device {
 
 	struct libinput_source *source;
 	char *devname;
-	enum devkind kind;
+	const struct libinput_device_interface *interface;
+	uint32_t caps;		/* DEVICE_CAP_BIT()s, set by interface->init */
+	/* Backend state, owned by the interface */
 	union {
-		int sysmouse_oldmask;
+		struct {
+			int sysmouse_oldmask;
+			int sysmouse_oldextmask;	/* buttons 4 to 10 */
+			struct scroll_coalesce sysmouse_scroll;
+		};
 		struct kbdev_state *kbdst;
+		struct evdev_state *evdevst;
 	};
 	struct motion_filter *filter;
+	/* Last custom accel curve, speeds then factors, applied again
+	 * when the profile goes back to custom */
+	double *custom_accel;
+	size_t ncustom_accel;
 	struct libinput_device_config config;
+	enum libinput_config_send_events_mode sendevents_mode;
+	struct device_quirks quirks;
 	int fd;
+	uint32_t id;
+	/* Torn down by the backend, listed until the last reference goes */
+	bool removed;
+	/* Pointer events were posted since the last frame */
+	bool pointer_frame_pending;
+	struct device_abs *abs;		/* NULL unless absolute */
+
+	struct event_queue *queue;	/* LIBINPUT_EVENT_QUEUE_DEVICE only */
+	struct libinput_device *dead_next;
+	/* event_epoch.posted of the context queue and of the seat or device
+	 * queue when the last reference was dropped */
+	uint32_t retire_context;
+	uint32_t retire_queue;
 };
 
+#define DEFAULT_WHEEL_CLICK_ANGLE 15	/* degrees */
+
+/* Wheel axis values are in degrees, see libinput_event_pointer_get_axis_value */
+static inline double
+device_wheel_degrees(struct libinput_device *device, int clicks)
+{
+	int angle = device->quirks.wheel_click_angle;
+
+	return clicks * (angle ? angle : DEFAULT_WHEEL_CLICK_ANGLE);
+}
+
 enum libinput_tablet_tool_axis {
 	LIBINPUT_TABLET_TOOL_AXIS_X = 1,
 	LIBINPUT_TABLET_TOOL_AXIS_Y = 2,
@@ -187,7 +364,7 @@ enum libinput_tablet_tool_axis {
 #define LIBINPUT_TABLET_TOOL_AXIS_MAX LIBINPUT_TABLET_TOOL_AXIS_REL_WHEEL
 
 struct libinput_tablet_tool {
-	struct list link;
+	struct list link;		/* in libinput->tool_hash */
 	uint32_t serial;
 	uint32_t tool_id;
 	enum libinput_tablet_tool_type type;
@@ -205,9 +382,9 @@ struct libinput_tablet_tool {
 struct libinput_event {
 	enum libinput_event_type type;
 	struct libinput_device *device;
+	struct event_epoch *epoch;	/* of the queue it was posted to */
 };
 
-typedef void (*libinput_source_dispatch_t)(void *data);
 
 #define log_debug(li_, ...) log_msg((li_), LIBINPUT_LOG_PRIORITY_DEBUG, __VA_ARGS__)
 #define log_info(li_, ...) log_msg((li_), LIBINPUT_LOG_PRIORITY_INFO, __VA_ARGS__)
@@ -243,6 +420,26 @@ log_msg_va(struct libinput *libinput,
 	   va_list args)
 	LIBINPUT_ATTRIBUTE_PRINTF(3, 0);
 
+/* Queued logging, log.c */
+struct log_ring *
+log_ring_create(struct libinput *libinput, bool threaded);
+
+void
+log_ring_destroy(struct log_ring *ring);
+
+void
+log_ring_push(struct log_ring *ring,
+	      enum libinput_log_priority priority,
+	      const char *format,
+	      va_list args)
+	LIBINPUT_ATTRIBUTE_PRINTF(3, 0);
+
+void
+log_ring_flush(struct log_ring *ring);
+
+void
+event_queue_destroy(struct event_queue *queue);
+
 int
 libinput_init(struct libinput *libinput,
 	      const struct libinput_interface *interface,
@@ -254,10 +451,27 @@ libinput_add_fd(struct libinput *libinput,
 		libinput_source_dispatch_t dispatch,
 		void *data);
 
+/* A timer source starts out disarmed, see libinput_timer_set() */
+struct libinput_source *
+libinput_add_timer(struct libinput *libinput,
+		   libinput_source_dispatch_t dispatch,
+		   void *user_data);
+
+/* Fire once after timeout microseconds, 0 disarms the timer */
+int
+libinput_timer_set(struct libinput *libinput,
+		   struct libinput_source *source,
+		   uint64_t timeout);
+
 void
 libinput_remove_source(struct libinput *libinput,
 		       struct libinput_source *source);
 
+/* Only valid from within the source's dispatch function. Readers use
+ * it to stop without a final read() that would fail with EAGAIN. */
+size_t
+libinput_source_get_pending(struct libinput_source *source);
+
 int
 open_restricted(struct libinput *libinput,
 		const char *path, int flags);
@@ -269,6 +483,12 @@ void
 libinput_device_init(struct libinput_device *device,
 		     struct libinput_seat *seat);
 
+void
+notify_added_device(struct libinput_device *device);
+
+void
+notify_removed_device(struct libinput_device *device);
+
 void
 keyboard_notify_key(struct libinput_device *device,
 		    uint64_t time,
@@ -300,6 +520,29 @@ pointer_notify_axis(struct libinput_device *device,
 		    const struct normalized_coords *delta,
 		    const struct discrete_coords *discrete);
 
+/* Ends the pointer events of one hardware report, no-op if there were none */
+void
+pointer_notify_frame(struct libinput_device *device,
+		     uint64_t time);
+
+/* Seat slots are handed out lowest first, -1 if all 32 are in use */
+static inline int32_t
+seat_slot_alloc(struct libinput_seat *seat)
+{
+	int32_t slot = __builtin_ffs(~seat->slot_map) - 1;
+
+	if (slot >= 0)
+		seat->slot_map |= 1u << slot;
+
+	return slot;
+}
+
+static inline void
+seat_slot_release(struct libinput_seat *seat, int32_t slot)
+{
+	seat->slot_map &= ~(1u << slot);
+}
+
 void
 touch_notify_touch_down(struct libinput_device *device,
 			uint64_t time,
@@ -388,6 +631,12 @@ tablet_notify_button(struct libinput_device *device,
 		     int32_t button,
 		     enum libinput_button_state state);
 
+struct libinput_tablet_tool *
+tablet_tool_get(struct libinput *libinput,
+		enum libinput_tablet_tool_type type,
+		uint32_t tool_id,
+		uint32_t serial);
+
 void
 tablet_pad_notify_button(struct libinput_device *device,
 			 uint64_t time,
@@ -419,6 +668,22 @@ libinput_now(struct libinput *libinput)
 	return s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
 }
 
+static inline bool
+libinput_event_type_wanted(struct libinput *libinput,
+			   enum libinput_event_type type)
+{
+	return !bit_is_set(libinput->events_masked, type);
+}
+
+/* Motion is wanted as events or for the motion batch */
+static inline bool
+libinput_motion_wanted(struct libinput *libinput)
+{
+	return libinput->motion_batch != NULL ||
+	       libinput_event_type_wanted(libinput,
+					  LIBINPUT_EVENT_POINTER_MOTION);
+}
+
 static inline struct device_float_coords
 device_delta(struct device_coords a, struct device_coords b)
 {
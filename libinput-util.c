@@ -28,6 +28,7 @@
  * Wayland project; except that wl_ prefix has been removed.
  */
 
+#include <ctype.h>
 #include <stdlib.h>
 
 #include "libinput-util.h"
@@ -63,6 +64,20 @@ list_empty(const struct list *list)
 	return list->next == list;
 }
 
+/*
+ * Initialize a rate-limit with the given interval in milliseconds and at
+ * most burst actions per interval. An interval or burst of 0 disables the
+ * limit.
+ */
+void
+ratelimit_init(struct ratelimit *r, uint64_t ival_ms, unsigned int burst)
+{
+	r->interval = ms2us(ival_ms);
+	r->begin = 0;
+	r->burst = burst;
+	r->num = 0;
+}
+
 /*
  * Perform rate-limit test. Returns RATELIMIT_PASS if the rate-limited action
  * is still allowed, RATELIMIT_THRESHOLD if the limit has been reached with
@@ -101,3 +116,90 @@ ratelimit_test(struct ratelimit *r)
 
 	return RATELIMIT_EXCEEDED;
 }
+
+/**
+ * Helper function to parse the mouse DPI tag from udev.
+ * The tag is of the form:
+ * MOUSE_DPI=400 *1000 2000
+ * or
+ * MOUSE_DPI=400@125 *1000@125 2000@125
+ * Where the * indicates the default value and @number indicates device poll
+ * rate.
+ * Numbers should be in ascending order, and if rates are present they should
+ * be present for all entries.
+ *
+ * When parsing the mouse DPI property, if we find an error we just return 0
+ * since it's obviously invalid, the caller will treat that as an error and
+ * use a reasonable default instead. If the property contains multiple DPI
+ * settings but none flagged as default, we return the last because we're
+ * lazy and that's a silly way to set the property anyway.
+ *
+ * @param prop The value of the udev property (without the MOUSE_DPI=)
+ * @return The default dpi value on success, 0 on error
+ */
+int
+parse_mouse_dpi_property(const char *prop)
+{
+	bool is_default = false;
+	int nread, dpi = 0, rate;
+
+	if (!prop)
+		return 0;
+
+	while (*prop != 0) {
+		if (*prop == ' ') {
+			prop++;
+			continue;
+		}
+		if (*prop == '*') {
+			prop++;
+			is_default = true;
+			if (!isdigit(prop[0]))
+				return 0;
+		}
+
+		/* While we don't do anything with the rate right now we
+		 * will validate that, if it's present, it is non-zero and
+		 * positive
+		 */
+		rate = 1;
+		nread = 0;
+		sscanf(prop, "%d@%d%n", &dpi, &rate, &nread);
+		if (!nread)
+			sscanf(prop, "%d%n", &dpi, &nread);
+		if (!nread || dpi <= 0 || rate <= 0 || prop[nread] == '@')
+			return 0;
+
+		if (is_default)
+			break;
+		prop += nread;
+	}
+	return dpi;
+}
+
+/**
+ * Helper function to parse the MOUSE_WHEEL_CLICK_ANGLE property from udev.
+ * The property must be a number between -360 and 360, excluding 0.
+ *
+ * @param prop The value of the udev property (without the
+ * MOUSE_WHEEL_CLICK_ANGLE=)
+ * @return The angle of the wheel, or 0 on error.
+ */
+int
+parse_mouse_wheel_click_angle_property(const char *prop)
+{
+	int angle = 0,
+	    nread = 0;
+
+	if (!prop)
+		return 0;
+
+	if (sscanf(prop, "%d%n", &angle, &nread) != 1 || !nread ||
+	    angle == 0 || abs(angle) > 360)
+		return 0;
+
+	if (prop[nread] != '\0')
+		return 0;
+
+	return angle;
+}
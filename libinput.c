@@ -28,14 +28,19 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <unistd.h>
 
 #include "libinput.h"
 #include "libinput-util.h"
 #include "libinput-private.h"
+#include "filter.h"
+#include "quirks.h"
 
 #define require_event_type(li_, type_, retval_, ...)	\
 	if (type_ == LIBINPUT_EVENT_NONE) abort(); \
@@ -76,7 +81,9 @@ check_event_type(struct libinput *libinput,
 struct libinput_source {
 	libinput_source_dispatch_t dispatch;
 	void *user_data;
-	int fd;
+	int fd;			/* -1 once removed */
+	short filter;		/* EVFILT_READ or EVFILT_TIMER */
+	size_t pending;		/* bytes readable, as reported by kqueue */
 	struct list link;
 };
 
@@ -98,6 +105,8 @@ struct libinput_event_pointer {
 	struct normalized_coords delta;
 	struct device_float_coords delta_raw;
 	struct device_coords absolute;
+	/* absolute, calibrated, in [0, 1) of the device's range */
+	struct normalized_coords absolute_unit;
 	struct discrete_coords discrete;
 	uint32_t button;
 	uint32_t seat_button_count;
@@ -112,6 +121,8 @@ struct libinput_event_touch {
 	int32_t slot;
 	int32_t seat_slot;
 	struct device_coords point;
+	/* point, calibrated, in [0, 1) of the device's range */
+	struct normalized_coords point_unit;
 };
 
 struct libinput_event_gesture {
@@ -132,6 +143,7 @@ struct libinput_event_tablet_tool {
 	uint32_t seat_button_count;
 	uint64_t time;
 	struct tablet_axes axes;
+	struct normalized_coords point_unit;	/* calibrated, in [0, 1) */
 	unsigned char changed_axes[NCHARS(LIBINPUT_TABLET_TOOL_AXIS_MAX + 1)];
 	struct libinput_tablet_tool *tool;
 	enum libinput_tablet_tool_proximity_state proximity_state;
@@ -179,8 +191,14 @@ log_msg_va(struct libinput *libinput,
 	   const char *format,
 	   va_list args)
 {
-	if (libinput->log_handler &&
-	    libinput->log_priority <= priority)
+	if (!libinput->log_handler ||
+	    libinput->log_priority > priority)
+		return;
+
+	/* format must outlive the call, see log.c */
+	if (libinput->log_ring)
+		log_ring_push(libinput->log_ring, priority, format, args);
+	else
 		libinput->log_handler(libinput, priority, format, args);
 }
 
@@ -241,6 +259,104 @@ libinput_log_set_handler(struct libinput *libinput,
 	libinput->log_handler = log_handler;
 }
 
+LIBINPUT_EXPORT int
+libinput_log_set_mode(struct libinput *libinput,
+		      enum libinput_log_mode mode)
+{
+	struct log_ring *ring = NULL;
+
+	switch (mode) {
+	case LIBINPUT_LOG_MODE_SYNC:
+		break;
+	case LIBINPUT_LOG_MODE_DEFERRED:
+	case LIBINPUT_LOG_MODE_THREAD:
+		ring = log_ring_create(libinput,
+				       mode == LIBINPUT_LOG_MODE_THREAD);
+		if (ring == NULL)
+			return -1;
+		break;
+	default:
+		return -1;
+	}
+
+	/* Flush the old queue before anything can log to the new one */
+	if (libinput->log_ring)
+		log_ring_destroy(libinput->log_ring);
+
+	libinput->log_ring = ring;
+	libinput->log_mode = mode;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT void
+libinput_log_flush(struct libinput *libinput)
+{
+	if (libinput->log_ring)
+		log_ring_flush(libinput->log_ring);
+}
+
+/*
+ * Motion skips the accelerator while nobody wants it, the velocity it
+ * tracked is stale by the time motion is wanted again.
+ */
+static void
+libinput_restart_filters(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	uint64_t time = libinput_now(libinput);
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		list_for_each(device, &seat->devices_list, link) {
+			if (device->filter)
+				filter_restart(device->filter, device, time);
+		}
+	}
+}
+
+LIBINPUT_EXPORT int
+libinput_event_type_set_enabled(struct libinput *libinput,
+				enum libinput_event_type type,
+				int enabled)
+{
+	bool motion_wanted;
+
+	switch (type) {
+	case LIBINPUT_EVENT_NONE:
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return -1;
+	default:
+		break;
+	}
+
+	if (type > LIBINPUT_EVENT_TYPE_MAX)
+		return -1;
+
+	motion_wanted = libinput_motion_wanted(libinput);
+
+	if (enabled)
+		clear_bit(libinput->events_masked, type);
+	else
+		set_bit(libinput->events_masked, type);
+
+	if (!motion_wanted && libinput_motion_wanted(libinput))
+		libinput_restart_filters(libinput);
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_event_type_get_enabled(struct libinput *libinput,
+				enum libinput_event_type type)
+{
+	if (type == LIBINPUT_EVENT_NONE || type > LIBINPUT_EVENT_TYPE_MAX)
+		return 0;
+
+	return libinput_event_type_wanted(libinput, type);
+}
+
 static void
 libinput_post_event(struct libinput *libinput,
 		    struct libinput_event *event);
@@ -272,7 +388,8 @@ libinput_event_get_pointer_event(struct libinput_event *event)
 			   LIBINPUT_EVENT_POINTER_MOTION,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
 	return (struct libinput_event_pointer *) event;
 }
@@ -422,7 +539,8 @@ libinput_event_pointer_get_time(struct libinput_event_pointer *event)
 			   LIBINPUT_EVENT_POINTER_MOTION,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
 	return us2ms(event->time);
 }
@@ -436,7 +554,8 @@ libinput_event_pointer_get_time_usec(struct libinput_event_pointer *event)
 			   LIBINPUT_EVENT_POINTER_MOTION,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
 	return event->time;
 }
@@ -487,66 +606,53 @@ libinput_event_pointer_get_dy_unaccelerated(
 	return event->delta_raw.y;
 }
 
+/* Device coordinates to mm, in device units if the resolution is unknown */
+static inline double
+device_abs_to_mm(int value, int minimum, int resolution)
+{
+	value -= minimum;
+
+	return resolution ? (double)value / resolution : value;
+}
+
 LIBINPUT_EXPORT double
 libinput_event_pointer_get_absolute_x(struct libinput_event_pointer *event)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
+	struct device_abs *abs = event->base.device->abs;
 
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
 
-#if 0
-	return evdev_convert_to_mm(device->abs.absinfo_x, event->absolute.x);
-#else
-	return event->absolute.x;
-#endif
+	return device_abs_to_mm(event->absolute.x, abs->min_x, abs->res_x);
 }
 
 LIBINPUT_EXPORT double
 libinput_event_pointer_get_absolute_y(struct libinput_event_pointer *event)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
+	struct device_abs *abs = event->base.device->abs;
 
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
 
-#if 0
-	return evdev_convert_to_mm(device->abs.absinfo_y, event->absolute.y);
-#else
-	return event->absolute.y;
-#endif
+	return device_abs_to_mm(event->absolute.y, abs->min_y, abs->res_y);
 }
 
+/* The calibration was applied when the event was posted */
 LIBINPUT_EXPORT double
 libinput_event_pointer_get_absolute_x_transformed(
 	struct libinput_event_pointer *event,
 	uint32_t width)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
-
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
 
-#if 0
-	return evdev_device_transform_x(device, event->absolute.x, width);
-#else
-	return 0;
-#endif
+	return event->absolute_unit.x * width;
 }
 
 LIBINPUT_EXPORT double
@@ -554,21 +660,42 @@ libinput_event_pointer_get_absolute_y_transformed(
 	struct libinput_event_pointer *event,
 	uint32_t height)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
-
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
 
-#if 0
-	return evdev_device_transform_y(device, event->absolute.y, height);
-#else
-	return 0;
-#endif
+	return event->absolute_unit.y * height;
+}
+
+LIBINPUT_EXPORT size_t
+libinput_event_pointer_get_absolute_transformed_batch(
+	struct libinput_event_pointer **events,
+	size_t count,
+	uint32_t width,
+	uint32_t height,
+	double *x,
+	double *y)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (!check_event_type(libinput_event_get_context(&events[i]->base),
+				      __func__,
+				      events[i]->base.type,
+				      LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
+				      -1))
+			break;
+	}
+	count = i;
+
+	/* Split from the check so this loop has no branches */
+	for (i = 0; i < count; i++) {
+		x[i] = events[i]->absolute_unit.x * width;
+		y[i] = events[i]->absolute_unit.y * height;
+	}
+
+	return count;
 }
 
 LIBINPUT_EXPORT uint32_t
@@ -750,10 +877,7 @@ libinput_event_touch_get_seat_slot(struct libinput_event_touch *event)
 LIBINPUT_EXPORT double
 libinput_event_touch_get_x(struct libinput_event_touch *event)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
+	struct device_abs *abs = event->base.device->abs;
 
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
@@ -761,64 +885,39 @@ libinput_event_touch_get_x(struct libinput_event_touch *event)
 			   LIBINPUT_EVENT_TOUCH_DOWN,
 			   LIBINPUT_EVENT_TOUCH_MOTION);
 
-#if 0
-	return evdev_convert_to_mm(device->abs.absinfo_x, event->point.x);
-#else
-	return 0;
-#endif
+	return device_abs_to_mm(event->point.x, abs->min_x, abs->res_x);
 }
 
 LIBINPUT_EXPORT double
 libinput_event_touch_get_x_transformed(struct libinput_event_touch *event,
 				       uint32_t width)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
-
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
 			   LIBINPUT_EVENT_TOUCH_DOWN,
 			   LIBINPUT_EVENT_TOUCH_MOTION);
 
-#if 0
-	return evdev_device_transform_x(device, event->point.x, width);
-#else
-	return 0;
-#endif
+	return event->point_unit.x * width;
 }
 
 LIBINPUT_EXPORT double
 libinput_event_touch_get_y_transformed(struct libinput_event_touch *event,
 				       uint32_t height)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
-
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
 			   0,
 			   LIBINPUT_EVENT_TOUCH_DOWN,
 			   LIBINPUT_EVENT_TOUCH_MOTION);
 
-#if 0
-	return evdev_device_transform_y(device, event->point.y, height);
-#else
-	return 0;
-#endif
+	return event->point_unit.y * height;
 }
 
 LIBINPUT_EXPORT double
 libinput_event_touch_get_y(struct libinput_event_touch *event)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
+	struct device_abs *abs = event->base.device->abs;
 
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
@@ -826,11 +925,7 @@ libinput_event_touch_get_y(struct libinput_event_touch *event)
 			   LIBINPUT_EVENT_TOUCH_DOWN,
 			   LIBINPUT_EVENT_TOUCH_MOTION);
 
-#if 0
-	return evdev_convert_to_mm(device->abs.absinfo_y, event->point.y);
-#else
-	return 0;
-#endif
+	return device_abs_to_mm(event->point.y, abs->min_y, abs->res_y);
 }
 
 LIBINPUT_EXPORT uint32_t
@@ -1132,10 +1227,7 @@ libinput_event_tablet_tool_wheel_has_changed(
 LIBINPUT_EXPORT double
 libinput_event_tablet_tool_get_x(struct libinput_event_tablet_tool *event)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
+	struct device_abs *abs = event->base.device->abs;
 
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
@@ -1145,21 +1237,13 @@ libinput_event_tablet_tool_get_x(struct libinput_event_tablet_tool *event)
 			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
 			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
 
-#if 0
-	return evdev_convert_to_mm(device->abs.absinfo_x,
-				   event->axes.point.x);
-#else
-	return 0;
-#endif
+	return device_abs_to_mm(event->axes.point.x, abs->min_x, abs->res_x);
 }
 
 LIBINPUT_EXPORT double
 libinput_event_tablet_tool_get_y(struct libinput_event_tablet_tool *event)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
+	struct device_abs *abs = event->base.device->abs;
 
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
@@ -1168,12 +1252,7 @@ libinput_event_tablet_tool_get_y(struct libinput_event_tablet_tool *event)
 			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
 			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
 
-#if 0
-	return evdev_convert_to_mm(device->abs.absinfo_y,
-				   event->axes.point.y);
-#else
-	return 0;
-#endif
+	return device_abs_to_mm(event->axes.point.y, abs->min_y, abs->res_y);
 }
 
 LIBINPUT_EXPORT double
@@ -1311,10 +1390,6 @@ LIBINPUT_EXPORT double
 libinput_event_tablet_tool_get_x_transformed(struct libinput_event_tablet_tool *event,
 					uint32_t width)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
 
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
@@ -1324,23 +1399,13 @@ libinput_event_tablet_tool_get_x_transformed(struct libinput_event_tablet_tool *
 			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
 			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
 
-#if 0
-	return evdev_device_transform_x(device,
-					event->axes.point.x,
-					width);
-#else
-	return 0;
-#endif
+	return event->point_unit.x * width;
 }
 
 LIBINPUT_EXPORT double
 libinput_event_tablet_tool_get_y_transformed(struct libinput_event_tablet_tool *event,
 					uint32_t height)
 {
-#if 0
-	struct evdev_device *device =
-		(struct evdev_device *) event->base.device;
-#endif
 
 	require_event_type(libinput_event_get_context(&event->base),
 			   event->base.type,
@@ -1350,13 +1415,7 @@ libinput_event_tablet_tool_get_y_transformed(struct libinput_event_tablet_tool *
 			   LIBINPUT_EVENT_TABLET_TOOL_BUTTON,
 			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
 
-#if 0
-	return evdev_device_transform_y(device,
-					event->axes.point.y,
-					height);
-#else
-	return 0;
-#endif
+	return event->point_unit.y * height;
 }
 
 LIBINPUT_EXPORT struct libinput_tablet_tool *
@@ -1551,6 +1610,53 @@ libinput_tablet_tool_get_user_data(struct libinput_tablet_tool *tool)
 	return tool->user_data;
 }
 
+static inline uint32_t
+tablet_tool_hash(enum libinput_tablet_tool_type type,
+		 uint32_t tool_id,
+		 uint32_t serial)
+{
+	uint32_t h;
+
+	h = serial * 0x9e3779b1u ^ tool_id * 0x85ebca6bu ^ type;
+	h ^= h >> 16;
+
+	return h & (TABLET_TOOL_HASH_SIZE - 1);
+}
+
+/*
+ * Find the tool, creating it the first time it comes into proximity.
+ * The context keeps a reference for as long as it exists, so backends
+ * can hold on to the tool while it is in proximity.
+ */
+struct libinput_tablet_tool *
+tablet_tool_get(struct libinput *libinput,
+		enum libinput_tablet_tool_type type,
+		uint32_t tool_id,
+		uint32_t serial)
+{
+	struct list *bucket;
+	struct libinput_tablet_tool *tool;
+
+	bucket = &libinput->tool_hash[tablet_tool_hash(type, tool_id, serial)];
+	list_for_each(tool, bucket, link) {
+		if (tool->serial == serial && tool->tool_id == tool_id &&
+		    tool->type == type)
+			return tool;
+	}
+
+	tool = zalloc(sizeof(*tool));
+	if (tool == NULL)
+		return NULL;
+
+	tool->type = type;
+	tool->tool_id = tool_id;
+	tool->serial = serial;
+	tool->refcount = 1;
+	list_insert(bucket, &tool->link);
+
+	return tool;
+}
+
 LIBINPUT_EXPORT struct libinput_tablet_tool *
 libinput_tablet_tool_ref(struct libinput_tablet_tool *tool)
 {
@@ -1588,6 +1694,7 @@ libinput_add_fd(struct libinput *libinput,
 	source->dispatch = dispatch;
 	source->user_data = user_data;
 	source->fd = fd;
+	source->filter = EVFILT_READ;
 
 	EV_SET(&kev, fd, EVFILT_READ, EV_ADD | EV_ENABLE, 0, 0, source);
 	if (kevent(libinput->kq, &kev, 1, NULL, 0, NULL)) {
@@ -1598,14 +1705,68 @@ libinput_add_fd(struct libinput *libinput,
 	return source;
 }
 
+struct libinput_source *
+libinput_add_timer(struct libinput *libinput,
+		   libinput_source_dispatch_t dispatch,
+		   void *user_data)
+{
+	struct libinput_source *source;
+
+	source = calloc(1, sizeof *source);
+	if (!source)
+		return NULL;
+
+	source->dispatch = dispatch;
+	source->user_data = user_data;
+	/* Timers have no fd, but must not look removed */
+	source->fd = libinput->kq;
+	source->filter = EVFILT_TIMER;
+
+	return source;
+}
+
+int
+libinput_timer_set(struct libinput *libinput,
+		   struct libinput_source *source,
+		   uint64_t timeout)
+{
+	struct kevent kev;
+
+	assert(source->filter == EVFILT_TIMER);
+
+	if (timeout == 0) {
+		/* Fails with ENOENT if the timer is not armed, that's fine */
+		EV_SET(&kev, (uintptr_t)source, EVFILT_TIMER, EV_DELETE,
+		       0, 0, NULL);
+		kevent(libinput->kq, &kev, 1, NULL, 0, NULL);
+		return 0;
+	}
+
+	/* EVFILT_TIMER counts in milliseconds, never fire early */
+	EV_SET(&kev, (uintptr_t)source, EVFILT_TIMER, EV_ADD | EV_ONESHOT,
+	       0, (timeout + 999) / 1000, source);
+
+	return kevent(libinput->kq, &kev, 1, NULL, 0, NULL) == 0 ? 0 : -1;
+}
+
+size_t
+libinput_source_get_pending(struct libinput_source *source)
+{
+	return source->pending;
+}
+
 void
 libinput_remove_source(struct libinput *libinput,
 		       struct libinput_source *source)
 {
 	struct kevent kev;
 
-	EV_SET(&kev, source->fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
-	kevent(libinput->kq, &kev, 1, NULL, 0, NULL);
+	if (source->filter == EVFILT_TIMER) {
+		libinput_timer_set(libinput, source, 0);
+	} else {
+		EV_SET(&kev, source->fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+		kevent(libinput->kq, &kev, 1, NULL, 0, NULL);
+	}
 	source->fd = -1;
 	list_insert(&libinput->source_destroy_list, &source->link);
 }
@@ -1615,6 +1776,8 @@ libinput_init(struct libinput *libinput,
 	      const struct libinput_interface *interface,
 	      void *user_data)
 {
+	int i;
+
 	if ((libinput->kq = kqueue()) == -1)
 		return -1;
 
@@ -1633,7 +1796,18 @@ libinput_init(struct libinput *libinput,
 	libinput->refcount = 1;
 	list_init(&libinput->source_destroy_list);
 	list_init(&libinput->seat_list);
-	list_init(&libinput->tool_list);
+	for (i = 0; i < TABLET_TOOL_HASH_SIZE; i++)
+		list_init(&libinput->tool_hash[i]);
+
+	/* Opt-in, callers that predate frames don't expect them */
+	set_bit(libinput->events_masked, LIBINPUT_EVENT_POINTER_FRAME);
+
+	ratelimit_init(&libinput->log_ratelimit.device_cap, 5000, 10);
+	ratelimit_init(&libinput->log_ratelimit.kbd_repeat, 5000, 10);
+	ratelimit_init(&libinput->log_ratelimit.event_queue, 5000, 10);
+	ratelimit_init(&libinput->log_ratelimit.motion_batch, 5000, 10);
+
+	libinput->quirks = quirks_db_open(libinput, LIBINPUT_QUIRKS_FILE);
 
 	return 0;
 }
@@ -1644,6 +1818,176 @@ libinput_device_destroy(struct libinput_device *device);
 static void
 libinput_seat_destroy(struct libinput_seat *seat);
 
+/*
+ * Single producer, single consumer ring of a seat or device. The
+ * dispatching thread pushes, the caller's consumer pops, the indices
+ * are free-running and only reduced modulo the size on access.
+ */
+#define EVENT_QUEUE_SIZE 512
+
+struct event_queue {
+	struct libinput *libinput;
+	struct event_epoch epoch;	/* posted is the tail, taken the head */
+	/* Set when the producer wrote to wakeup[1] and the consumer hasn't
+	 * emptied the queue since, so a burst costs one write() */
+	int signalled __attribute__((aligned(64)));
+	int wakeup[2];
+	struct libinput_event *events[EVENT_QUEUE_SIZE];
+};
+
+/*
+ * Backing store of struct libinput_motion_batch, the view's pointers
+ * alias the arrays here. Only the dispatching thread touches it.
+ */
+struct motion_batch {
+	struct libinput_motion_batch view;
+	size_t size;
+	uint64_t *time;
+	double *dx;
+	double *dy;
+	double *dx_unaccelerated;
+	double *dy_unaccelerated;
+	uint32_t *device_id;
+};
+
+static void
+motion_batch_destroy(struct motion_batch *batch)
+{
+	if (!batch)
+		return;
+
+	free(batch->time);
+	free(batch->dx);
+	free(batch->dy);
+	free(batch->dx_unaccelerated);
+	free(batch->dy_unaccelerated);
+	free(batch->device_id);
+	free(batch);
+}
+
+/* Cache line aligned so the caller can use aligned vector loads */
+static bool
+motion_batch_grow_array(void *arrayp, size_t count, size_t size,
+			size_t elsize)
+{
+	void **array = arrayp;
+	void *p;
+
+	if (posix_memalign(&p, 64, size * elsize) != 0)
+		return false;
+
+	if (count)
+		memcpy(p, *array, count * elsize);
+	free(*array);
+	*array = p;
+
+	return true;
+}
+
+static bool
+motion_batch_grow(struct motion_batch *batch)
+{
+	size_t count = batch->view.count;
+	size_t size = batch->size ? batch->size * 2 : 64;
+	bool grown;
+
+	/* An array that grew before a later one failed is just larger
+	 * than needed, size only changes once all of them grew */
+	grown = motion_batch_grow_array(&batch->time, count, size,
+					sizeof *batch->time) &&
+		motion_batch_grow_array(&batch->dx, count, size,
+					sizeof *batch->dx) &&
+		motion_batch_grow_array(&batch->dy, count, size,
+					sizeof *batch->dy) &&
+		motion_batch_grow_array(&batch->dx_unaccelerated, count, size,
+					sizeof *batch->dx_unaccelerated) &&
+		motion_batch_grow_array(&batch->dy_unaccelerated, count, size,
+					sizeof *batch->dy_unaccelerated) &&
+		motion_batch_grow_array(&batch->device_id, count, size,
+					sizeof *batch->device_id);
+
+	batch->view.time = batch->time;
+	batch->view.dx = batch->dx;
+	batch->view.dy = batch->dy;
+	batch->view.dx_unaccelerated = batch->dx_unaccelerated;
+	batch->view.dy_unaccelerated = batch->dy_unaccelerated;
+	batch->view.device_id = batch->device_id;
+
+	if (grown)
+		batch->size = size;
+
+	return grown;
+}
+
+static void
+motion_batch_append(struct libinput_device *device,
+		    uint64_t time,
+		    const struct normalized_coords *delta,
+		    const struct device_float_coords *raw)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct motion_batch *batch = libinput->motion_batch;
+	size_t i = batch->view.count;
+
+	if (i == batch->size && !motion_batch_grow(batch)) {
+		log_error_ratelimit(libinput,
+				    &libinput->log_ratelimit.motion_batch,
+				    "Failed to grow the motion batch\n");
+		return;
+	}
+
+	batch->time[i] = time;
+	batch->dx[i] = delta->x;
+	batch->dy[i] = delta->y;
+	batch->dx_unaccelerated[i] = raw->x;
+	batch->dy_unaccelerated[i] = raw->y;
+	batch->device_id[i] = device->id;
+	batch->view.count = i + 1;
+}
+
+LIBINPUT_EXPORT int
+libinput_motion_batch_set_enabled(struct libinput *libinput, int enabled)
+{
+	struct motion_batch *batch;
+
+	if (!enabled) {
+		motion_batch_destroy(libinput->motion_batch);
+		libinput->motion_batch = NULL;
+		return 0;
+	}
+
+	if (libinput->motion_batch)
+		return 0;
+
+	batch = zalloc(sizeof *batch);
+	if (!batch || !motion_batch_grow(batch)) {
+		motion_batch_destroy(batch);
+		return -1;
+	}
+
+	if (!libinput_motion_wanted(libinput))
+		libinput_restart_filters(libinput);
+
+	libinput->motion_batch = batch;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT const struct libinput_motion_batch *
+libinput_get_motion_batch(struct libinput *libinput)
+{
+	if (!libinput->motion_batch)
+		return NULL;
+
+	return &libinput->motion_batch->view;
+}
+
+static void
+libinput_reap_devices(struct libinput *libinput);
+
+static struct event_queue *
+event_queue_create(struct libinput *libinput);
+
 static void
 libinput_drop_destroyed_sources(struct libinput *libinput)
 {
@@ -1670,6 +2014,7 @@ libinput_unref(struct libinput *libinput)
 	struct libinput_device *device, *next_device;
 	struct libinput_seat *seat, *next_seat;
 	struct libinput_tablet_tool *tool, *next_tool;
+	int i;
 
 	if (libinput == NULL)
 		return NULL;
@@ -1682,6 +2027,16 @@ libinput_unref(struct libinput *libinput)
 	while ((event = libinput_get_event(libinput)))
 	       libinput_event_destroy(event);
 
+	list_for_each(seat, &libinput->seat_list, link) {
+		while ((event = libinput_seat_get_event(seat)))
+			libinput_event_destroy(event);
+		list_for_each(device, &seat->devices_list, link) {
+			while ((event = libinput_device_get_event(device)))
+				libinput_event_destroy(event);
+		}
+	}
+	libinput_reap_devices(libinput);
+
 	free(libinput->events);
 
 	list_for_each_safe(seat, next_seat, &libinput->seat_list, link) {
@@ -1693,12 +2048,22 @@ libinput_unref(struct libinput *libinput)
 		libinput_seat_destroy(seat);
 	}
 
-	list_for_each_safe(tool, next_tool, &libinput->tool_list, link) {
-		libinput_tablet_tool_unref(tool);
+	/* Tools the caller still holds outlive the hash they were in */
+	for (i = 0; i < TABLET_TOOL_HASH_SIZE; i++) {
+		list_for_each_safe(tool, next_tool,
+				   &libinput->tool_hash[i], link) {
+			list_remove(&tool->link);
+			list_init(&tool->link);
+			libinput_tablet_tool_unref(tool);
+		}
 	}
+	dragonfly_libinput_destroy(libinput);
+	quirks_db_close(libinput->quirks);
 	libinput_drop_destroyed_sources(libinput);
 	close(libinput->kq);
-	dragonfly_libinput_destroy(libinput);
+	if (libinput->log_ring)
+		log_ring_destroy(libinput->log_ring);
+	motion_batch_destroy(libinput->motion_batch);
 	free(libinput);
 
 	return NULL;
@@ -1710,8 +2075,12 @@ libinput_event_destroy(struct libinput_event *event)
 	if (event == NULL)
 		return;
 
-	if (event->device)
-		libinput_device_unref(event->device);
+	struct event_epoch *epoch = event->epoch;
+
+	/* Only the queue's consumer writes released */
+	if (epoch)
+		__atomic_store_n(&epoch->released, epoch->released + 1,
+				 __ATOMIC_RELEASE);
 
 	free(event);
 }
@@ -1743,6 +2112,9 @@ libinput_seat_init(struct libinput_seat *seat,
 	seat->logical_name = strdup(logical_name);
 	list_init(&seat->devices_list);
 	list_insert(&libinput->seat_list, &seat->link);
+
+	if (libinput->event_queue_mode == LIBINPUT_EVENT_QUEUE_SEAT)
+		seat->queue = event_queue_create(libinput);
 }
 
 LIBINPUT_EXPORT struct libinput_seat *
@@ -1756,6 +2128,7 @@ static void
 libinput_seat_destroy(struct libinput_seat *seat)
 {
 	list_remove(&seat->link);
+	event_queue_destroy(seat->queue);
 	free(seat->logical_name);
 	free(seat->physical_name);
 	free(seat);
@@ -1808,14 +2181,25 @@ void
 libinput_device_init(struct libinput_device *device,
 		     struct libinput_seat *seat)
 {
+	struct libinput *libinput = seat->libinput;
+
 	device->seat = seat;
 	device->refcount = 1;
+	device->id = ++libinput->next_device_id;
+
+	if (libinput->event_queue_mode == LIBINPUT_EVENT_QUEUE_DEVICE)
+		device->queue = event_queue_create(libinput);
 }
 
+/*
+ * Events don't hold a device reference, see struct event_epoch. The
+ * refcount only counts the backend and the caller, the caller may drop
+ * its reference on a queue's consumer thread so it is atomic.
+ */
 LIBINPUT_EXPORT struct libinput_device *
 libinput_device_ref(struct libinput_device *device)
 {
-	device->refcount++;
+	__atomic_add_fetch(&device->refcount, 1, __ATOMIC_RELAXED);
 	return device;
 }
 
@@ -1823,21 +2207,119 @@ static void
 libinput_device_destroy(struct libinput_device *device)
 {
 	list_remove(&device->link);
+	event_queue_destroy(device->queue);
+	free(device->custom_accel);
+	free(device->abs);
 	libinput_seat_unref(device->seat);
 	free(device);
 }
 
+static struct event_epoch *
+libinput_device_get_epoch(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct event_queue *queue = NULL;
+
+	switch (libinput->event_queue_mode) {
+	case LIBINPUT_EVENT_QUEUE_SEAT:
+		queue = device->seat->queue;
+		break;
+	case LIBINPUT_EVENT_QUEUE_DEVICE:
+		queue = device->queue;
+		break;
+	case LIBINPUT_EVENT_QUEUE_CONTEXT:
+		break;
+	}
+
+	return queue ? &queue->epoch : NULL;
+}
+
+/*
+ * Everything posted before retire was taken and nothing taken is held.
+ * The counters don't say which events are still held, so one held event
+ * of any device keeps every retired device of the queue, see
+ * libinput_set_event_queue_mode().
+ */
+static bool
+event_epoch_passed(struct event_epoch *epoch, uint32_t retire)
+{
+	uint32_t released, taken;
+
+	/* released first: if it equals the later taken, nothing was
+	 * outstanding when it was read */
+	released = __atomic_load_n(&epoch->released, __ATOMIC_ACQUIRE);
+	taken = __atomic_load_n(&epoch->taken, __ATOMIC_ACQUIRE);
+
+	return released == taken && (int32_t)(taken - retire) >= 0;
+}
+
+static void
+libinput_device_retire(struct libinput_device *device)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct event_epoch *epoch = libinput_device_get_epoch(device);
+	struct libinput_device *head;
+
+	/* The backend dropped its reference first, nothing is posted for
+	 * the device anymore and the counters only move past it */
+	device->retire_context = __atomic_load_n(&libinput->events_epoch.posted,
+						 __ATOMIC_ACQUIRE);
+	if (epoch)
+		device->retire_queue = __atomic_load_n(&epoch->posted,
+						       __ATOMIC_ACQUIRE);
+
+	head = __atomic_load_n(&libinput->dead_devices, __ATOMIC_RELAXED);
+	do {
+		device->dead_next = head;
+	} while (!__atomic_compare_exchange_n(&libinput->dead_devices,
+					      &head, device, true,
+					      __ATOMIC_RELEASE,
+					      __ATOMIC_RELAXED));
+}
+
+static void
+libinput_reap_devices(struct libinput *libinput)
+{
+	struct libinput_device *device, *next, **prev;
+	struct event_epoch *epoch;
+
+	device = __atomic_exchange_n(&libinput->dead_devices, NULL,
+				     __ATOMIC_ACQUIRE);
+	while (device) {
+		next = device->dead_next;
+		device->dead_next = libinput->retired_devices;
+		libinput->retired_devices = device;
+		device = next;
+	}
+
+	prev = &libinput->retired_devices;
+	while ((device = *prev)) {
+		epoch = libinput_device_get_epoch(device);
+		if (event_epoch_passed(&libinput->events_epoch,
+				       device->retire_context) &&
+		    (!epoch ||
+		     event_epoch_passed(epoch, device->retire_queue))) {
+			*prev = device->dead_next;
+			libinput_device_destroy(device);
+		} else {
+			prev = &device->dead_next;
+		}
+	}
+}
+
 struct libinput_device *
 libinput_device_unref(struct libinput_device *device)
 {
-	assert(device->refcount > 0);
-	device->refcount--;
-	if (device->refcount == 0) {
-		libinput_device_destroy(device);
-		return NULL;
-	} else {
+	int refcount;
+
+	refcount = __atomic_sub_fetch(&device->refcount, 1, __ATOMIC_ACQ_REL);
+	assert(refcount >= 0);
+	if (refcount > 0)
 		return device;
-	}
+
+	libinput_device_retire(device);
+
+	return NULL;
 }
 
 LIBINPUT_EXPORT int
@@ -1846,32 +2328,118 @@ libinput_get_fd(struct libinput *libinput)
 	return libinput->kq;
 }
 
-LIBINPUT_EXPORT int
-libinput_dispatch(struct libinput *libinput)
+/*
+ * The motion batch covers one libinput_dispatch*() call, however many
+ * kevent rounds that takes.
+ */
+static void
+libinput_dispatch_begin(struct libinput *libinput)
+{
+	if (libinput->motion_batch)
+		libinput->motion_batch->view.count = 0;
+}
+
+static int
+libinput_dispatch_sources(struct libinput *libinput,
+			  const struct timespec *timeout)
 {
 	struct libinput_source *source;
-	struct kevent kev[1];
-	struct timespec ts = { 0, 0 };
+	struct kevent kev[32];
 	int i, count;
 
-	count = kevent(libinput->kq, NULL, 0, kev, ARRAY_LENGTH(kev), &ts);
+	libinput_reap_devices(libinput);
+
+	count = kevent(libinput->kq, NULL, 0, kev, ARRAY_LENGTH(kev), timeout);
 	if (count == -1)
 		return -errno;
 
 	for (i = 0; i < count; i++) {
-		if (kev[i].filter != EVFILT_READ)
+		if (kev[i].filter != EVFILT_READ &&
+		    kev[i].filter != EVFILT_TIMER)
 			continue;
 
 		source = kev[i].udata;
 		if (source->fd == -1)
 			continue;
 
-		source->dispatch(source->user_data);
+		if (kev[i].filter == EVFILT_READ)
+			source->pending = kev[i].data > 0 ? kev[i].data : 0;
+		source->dispatch(source->user_data);
+	}
+
+	libinput_drop_destroyed_sources(libinput);
+
+	if (libinput->log_mode == LIBINPUT_LOG_MODE_DEFERRED)
+		log_ring_flush(libinput->log_ring);
+
+	return count;
+}
+
+LIBINPUT_EXPORT int
+libinput_dispatch(struct libinput *libinput)
+{
+	struct timespec ts = { 0, 0 };
+	int rc;
+
+	libinput_dispatch_begin(libinput);
+	rc = libinput_dispatch_sources(libinput, &ts);
+	if (rc < 0)
+		return rc;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_dispatch_wait(struct libinput *libinput, int64_t timeout_us)
+{
+	struct timespec ts;
+	int rc;
+
+	/* Block in kevent() directly, saving the caller a separate poll() */
+	if (timeout_us >= 0) {
+		ts.tv_sec = timeout_us / 1000000;
+		ts.tv_nsec = (timeout_us % 1000000) * 1000;
+	}
+
+	libinput_dispatch_begin(libinput);
+	rc = libinput_dispatch_sources(libinput,
+				       timeout_us >= 0 ? &ts : NULL);
+	if (rc < 0)
+		return rc;
+
+	return libinput->events_count;
+}
+
+LIBINPUT_EXPORT int
+libinput_dispatch_until(struct libinput *libinput, uint64_t deadline_us)
+{
+	struct timespec ts;
+	uint64_t now, remaining;
+	int rc;
+
+	/*
+	 * Every round dispatches each ready source once. The evdev and
+	 * sysmouse backends read what kevent() reported as pending when
+	 * the round started, which can be a full kernel buffer, data that
+	 * arrives meanwhile waits for the next round. A flooding device
+	 * thus delays the others by at most one buffer per round. Whatever
+	 * is still buffered in the kernel at the deadline is left for the
+	 * next call.
+	 */
+	libinput_dispatch_begin(libinput);
+	while ((now = libinput_now(libinput)) < deadline_us) {
+		remaining = deadline_us - now;
+		ts.tv_sec = remaining / 1000000;
+		ts.tv_nsec = (remaining % 1000000) * 1000;
+
+		rc = libinput_dispatch_sources(libinput, &ts);
+		if (rc < 0)
+			return rc;
+		if (rc == 0)
+			break;
 	}
 
-	libinput_drop_destroyed_sources(libinput);
-
-	return 0;
+	return libinput->events_count;
 }
 
 static uint32_t
@@ -1980,7 +2548,7 @@ device_has_cap(struct libinput_device *device,
 {
 	const char *capability;
 
-	if (libinput_device_has_capability(device, cap))
+	if (device->caps & DEVICE_CAP_BIT(cap))
 		return true;
 
 	switch (cap) {
@@ -2004,7 +2572,8 @@ device_has_cap(struct libinput_device *device,
 		break;
 	}
 
-	log_bug_libinput(device->seat->libinput,
+	log_bug_libinput_ratelimit(device->seat->libinput,
+			 &device->seat->libinput->log_ratelimit.device_cap,
 			 "Event for missing capability %s on device \"%s\"\n",
 			 capability,
 			 libinput_device_get_name(device));
@@ -2024,12 +2593,18 @@ keyboard_notify_key(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_KEYBOARD))
 		return;
 
+	/* The seat key count must be kept up to date even if nobody
+	 * wants the event */
+	seat_key_count = update_seat_key_count(device->seat, key, state);
+
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_KEYBOARD_KEY))
+		return;
+
 	key_event = zalloc(sizeof *key_event);
 	if (!key_event)
 		return;
 
-	seat_key_count = update_seat_key_count(device->seat, key, state);
-
 	*key_event = (struct libinput_event_keyboard) {
 		.time = time,
 		.key = key,
@@ -2053,6 +2628,13 @@ pointer_notify_motion(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
+	if (device->seat->libinput->motion_batch)
+		motion_batch_append(device, time, delta, raw);
+
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_POINTER_MOTION))
+		return;
+
 	motion_event = zalloc(sizeof *motion_event);
 	if (!motion_event)
 		return;
@@ -2066,6 +2648,21 @@ pointer_notify_motion(struct libinput_device *device,
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_MOTION,
 			  &motion_event->base);
+	device->pointer_frame_pending = true;
+}
+
+static inline struct normalized_coords
+device_abs_to_unit(const struct device_abs *abs,
+		   const struct device_coords *point)
+{
+	struct normalized_coords unit;
+
+	unit.x = fma(abs->unit[0][0], point->x,
+		     fma(abs->unit[0][1], point->y, abs->unit[0][2]));
+	unit.y = fma(abs->unit[1][0], point->x,
+		     fma(abs->unit[1][1], point->y, abs->unit[1][2]));
+
+	return unit;
 }
 
 void
@@ -2078,6 +2675,10 @@ pointer_notify_motion_absolute(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE))
+		return;
+
 	motion_absolute_event = zalloc(sizeof *motion_absolute_event);
 	if (!motion_absolute_event)
 		return;
@@ -2085,11 +2686,13 @@ pointer_notify_motion_absolute(struct libinput_device *device,
 	*motion_absolute_event = (struct libinput_event_pointer) {
 		.time = time,
 		.absolute = *point,
+		.absolute_unit = device_abs_to_unit(device->abs, point),
 	};
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			  &motion_absolute_event->base);
+	device->pointer_frame_pending = true;
 }
 
 void
@@ -2104,14 +2707,18 @@ pointer_notify_button(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	button_event = zalloc(sizeof *button_event);
-	if (!button_event)
-		return;
-
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
 						     state);
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_POINTER_BUTTON))
+		return;
+
+	button_event = zalloc(sizeof *button_event);
+	if (!button_event)
+		return;
+
 	*button_event = (struct libinput_event_pointer) {
 		.time = time,
 		.button = button,
@@ -2122,6 +2729,7 @@ pointer_notify_button(struct libinput_device *device,
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_BUTTON,
 			  &button_event->base);
+	device->pointer_frame_pending = true;
 }
 
 void
@@ -2137,6 +2745,10 @@ pointer_notify_axis(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_POINTER_AXIS))
+		return;
+
 	axis_event = zalloc(sizeof *axis_event);
 	if (!axis_event)
 		return;
@@ -2152,6 +2764,34 @@ pointer_notify_axis(struct libinput_device *device,
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_AXIS,
 			  &axis_event->base);
+	device->pointer_frame_pending = true;
+}
+
+void
+pointer_notify_frame(struct libinput_device *device,
+		     uint64_t time)
+{
+	struct libinput_event_pointer *frame_event;
+
+	if (!device->pointer_frame_pending)
+		return;
+	device->pointer_frame_pending = false;
+
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_POINTER_FRAME))
+		return;
+
+	frame_event = zalloc(sizeof *frame_event);
+	if (!frame_event)
+		return;
+
+	*frame_event = (struct libinput_event_pointer) {
+		.time = time,
+	};
+
+	post_device_event(device, time,
+			  LIBINPUT_EVENT_POINTER_FRAME,
+			  &frame_event->base);
 }
 
 void
@@ -2166,6 +2806,10 @@ touch_notify_touch_down(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TOUCH_DOWN))
+		return;
+
 	touch_event = zalloc(sizeof *touch_event);
 	if (!touch_event)
 		return;
@@ -2175,6 +2819,7 @@ touch_notify_touch_down(struct libinput_device *device,
 		.slot = slot,
 		.seat_slot = seat_slot,
 		.point = *point,
+		.point_unit = device_abs_to_unit(device->abs, point),
 	};
 
 	post_device_event(device, time,
@@ -2194,6 +2839,10 @@ touch_notify_touch_motion(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TOUCH_MOTION))
+		return;
+
 	touch_event = zalloc(sizeof *touch_event);
 	if (!touch_event)
 		return;
@@ -2203,6 +2852,7 @@ touch_notify_touch_motion(struct libinput_device *device,
 		.slot = slot,
 		.seat_slot = seat_slot,
 		.point = *point,
+		.point_unit = device_abs_to_unit(device->abs, point),
 	};
 
 	post_device_event(device, time,
@@ -2221,6 +2871,10 @@ touch_notify_touch_up(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TOUCH_UP))
+		return;
+
 	touch_event = zalloc(sizeof *touch_event);
 	if (!touch_event)
 		return;
@@ -2245,6 +2899,10 @@ touch_notify_frame(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TOUCH_FRAME))
+		return;
+
 	touch_event = zalloc(sizeof *touch_event);
 	if (!touch_event)
 		return;
@@ -2268,6 +2926,13 @@ tablet_notify_axis(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *axis_event;
 
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TABLET_TOOL))
+		return;
+
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TABLET_TOOL_AXIS))
+		return;
+
 	axis_event = zalloc(sizeof *axis_event);
 	if (!axis_event)
 		return;
@@ -2278,6 +2943,7 @@ tablet_notify_axis(struct libinput_device *device,
 		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
 		.tip_state = tip_state,
 		.axes = *axes,
+		.point_unit = device_abs_to_unit(device->abs, &axes->point),
 	};
 
 	memcpy(axis_event->changed_axes,
@@ -2300,6 +2966,13 @@ tablet_notify_proximity(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *proximity_event;
 
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TABLET_TOOL))
+		return;
+
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY))
+		return;
+
 	proximity_event = zalloc(sizeof *proximity_event);
 	if (!proximity_event)
 		return;
@@ -2310,6 +2983,7 @@ tablet_notify_proximity(struct libinput_device *device,
 		.tip_state = LIBINPUT_TABLET_TOOL_TIP_UP,
 		.proximity_state = proximity_state,
 		.axes = *axes,
+		.point_unit = device_abs_to_unit(device->abs, &axes->point),
 	};
 	memcpy(proximity_event->changed_axes,
 	       changed_axes,
@@ -2331,6 +3005,13 @@ tablet_notify_tip(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *tip_event;
 
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TABLET_TOOL))
+		return;
+
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TABLET_TOOL_TIP))
+		return;
+
 	tip_event = zalloc(sizeof *tip_event);
 	if (!tip_event)
 		return;
@@ -2341,6 +3022,7 @@ tablet_notify_tip(struct libinput_device *device,
 		.tip_state = tip_state,
 		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
 		.axes = *axes,
+		.point_unit = device_abs_to_unit(device->abs, &axes->point),
 	};
 	memcpy(tip_event->changed_axes,
 	       changed_axes,
@@ -2364,14 +3046,21 @@ tablet_notify_button(struct libinput_device *device,
 	struct libinput_event_tablet_tool *button_event;
 	int32_t seat_button_count;
 
-	button_event = zalloc(sizeof *button_event);
-	if (!button_event)
+	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TABLET_TOOL))
 		return;
 
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
 						     state);
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TABLET_TOOL_BUTTON))
+		return;
+
+	button_event = zalloc(sizeof *button_event);
+	if (!button_event)
+		return;
+
 	*button_event = (struct libinput_event_tablet_tool) {
 		.time = time,
 		.tool = tool,
@@ -2381,6 +3070,7 @@ tablet_notify_button(struct libinput_device *device,
 		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
 		.tip_state = tip_state,
 		.axes = *axes,
+		.point_unit = device_abs_to_unit(device->abs, &axes->point),
 	};
 
 	post_device_event(device,
@@ -2397,6 +3087,10 @@ tablet_pad_notify_button(struct libinput_device *device,
 {
 	struct libinput_event_tablet_pad *button_event;
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TABLET_PAD_BUTTON))
+		return;
+
 	button_event = zalloc(sizeof *button_event);
 	if (!button_event)
 		return;
@@ -2422,6 +3116,10 @@ tablet_pad_notify_ring(struct libinput_device *device,
 {
 	struct libinput_event_tablet_pad *ring_event;
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TABLET_PAD_RING))
+		return;
+
 	ring_event = zalloc(sizeof *ring_event);
 	if (!ring_event)
 		return;
@@ -2448,6 +3146,10 @@ tablet_pad_notify_strip(struct libinput_device *device,
 {
 	struct libinput_event_tablet_pad *strip_event;
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					LIBINPUT_EVENT_TABLET_PAD_STRIP))
+		return;
+
 	strip_event = zalloc(sizeof *strip_event);
 	if (!strip_event)
 		return;
@@ -2481,6 +3183,10 @@ gesture_notify(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_GESTURE))
 		return;
 
+	if (!libinput_event_type_wanted(device->seat->libinput,
+					type))
+		return;
+
 	gesture_event = zalloc(sizeof *gesture_event);
 	if (!gesture_event)
 		return;
@@ -2561,6 +3267,7 @@ event_type_to_str(enum libinput_event_type type)
 	CASE_RETURN_STRING(LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE);
 	CASE_RETURN_STRING(LIBINPUT_EVENT_POINTER_BUTTON);
 	CASE_RETURN_STRING(LIBINPUT_EVENT_POINTER_AXIS);
+	CASE_RETURN_STRING(LIBINPUT_EVENT_POINTER_FRAME);
 	CASE_RETURN_STRING(LIBINPUT_EVENT_TOUCH_DOWN);
 	CASE_RETURN_STRING(LIBINPUT_EVENT_TOUCH_UP);
 	CASE_RETURN_STRING(LIBINPUT_EVENT_TOUCH_MOTION);
@@ -2586,6 +3293,118 @@ event_type_to_str(enum libinput_event_type type)
 	return NULL;
 }
 
+static struct event_queue *
+event_queue_create(struct libinput *libinput)
+{
+	struct event_queue *queue;
+
+	queue = zalloc(sizeof *queue);
+	if (!queue)
+		goto err;
+
+	if (pipe2(queue->wakeup, O_NONBLOCK | O_CLOEXEC) == -1) {
+		free(queue);
+		goto err;
+	}
+
+	queue->libinput = libinput;
+
+	return queue;
+
+err:
+	log_error(libinput,
+		  "Failed to create event queue, "
+		  "events are queued on the context\n");
+	return NULL;
+}
+
+void
+event_queue_destroy(struct event_queue *queue)
+{
+	if (!queue)
+		return;
+
+	/* Events don't pin the queue's owner. A device is reaped once
+	 * the consumer took and released everything posted before it was
+	 * retired (see struct event_epoch), a seat only after its last
+	 * device, and a device that failed to probe never posted. So
+	 * nothing posted can still be waiting to be taken. */
+	assert(queue->epoch.taken == queue->epoch.posted);
+
+	close(queue->wakeup[0]);
+	close(queue->wakeup[1]);
+	free(queue);
+}
+
+static bool
+event_queue_push(struct event_queue *queue, struct libinput_event *event)
+{
+	uint32_t head, tail = queue->epoch.posted;
+	char c = 0;
+
+	head = __atomic_load_n(&queue->epoch.taken, __ATOMIC_ACQUIRE);
+	if (tail - head == EVENT_QUEUE_SIZE)
+		return false;
+
+	event->epoch = &queue->epoch;
+	queue->events[tail % EVENT_QUEUE_SIZE] = event;
+	__atomic_store_n(&queue->epoch.posted, tail + 1, __ATOMIC_RELEASE);
+
+	if (!__atomic_exchange_n(&queue->signalled, 1, __ATOMIC_SEQ_CST))
+		(void)write(queue->wakeup[1], &c, 1);
+
+	return true;
+}
+
+static struct libinput_event *
+event_queue_pop(struct event_queue *queue)
+{
+	struct libinput_event *event;
+	uint32_t head = queue->epoch.taken, tail;
+	char buf[64];
+
+	tail = __atomic_load_n(&queue->epoch.posted, __ATOMIC_ACQUIRE);
+	if (head == tail) {
+		/*
+		 * Re-arm the wakeup, then look again: a push racing with us
+		 * either shows up in the second look or sees signalled
+		 * cleared and writes the fd again.
+		 */
+		__atomic_exchange_n(&queue->signalled, 0, __ATOMIC_SEQ_CST);
+		while (read(queue->wakeup[0], buf, sizeof(buf)) > 0)
+			;
+		tail = __atomic_load_n(&queue->epoch.posted, __ATOMIC_ACQUIRE);
+		if (head == tail)
+			return NULL;
+	}
+
+	event = queue->events[head % EVENT_QUEUE_SIZE];
+	__atomic_store_n(&queue->epoch.taken, head + 1, __ATOMIC_RELEASE);
+
+	return event;
+}
+
+static struct event_queue *
+libinput_event_get_queue(struct libinput *libinput,
+			 struct libinput_event *event)
+{
+	if (!event->device ||
+	    event->type == LIBINPUT_EVENT_DEVICE_ADDED ||
+	    event->type == LIBINPUT_EVENT_DEVICE_REMOVED)
+		return NULL;
+
+	switch (libinput->event_queue_mode) {
+	case LIBINPUT_EVENT_QUEUE_SEAT:
+		return event->device->seat->queue;
+	case LIBINPUT_EVENT_QUEUE_DEVICE:
+		return event->device->queue;
+	case LIBINPUT_EVENT_QUEUE_CONTEXT:
+		break;
+	}
+
+	return NULL;
+}
+
 static void
 libinput_post_event(struct libinput *libinput,
 		    struct libinput_event *event)
@@ -2593,6 +3412,7 @@ libinput_post_event(struct libinput *libinput,
 	struct libinput_event **events = libinput->events;
 	size_t events_len = libinput->events_len;
 	size_t events_count = libinput->events_count;
+	struct event_queue *queue;
 	size_t move_len;
 	size_t new_out;
 
@@ -2600,6 +3420,18 @@ libinput_post_event(struct libinput *libinput,
 	log_debug(libinput, "Queuing %s\n", event_type_to_str(event->type));
 #endif
 
+	queue = libinput_event_get_queue(libinput, event);
+	if (queue) {
+		if (!event_queue_push(queue, event)) {
+			log_error_ratelimit(libinput,
+					    &libinput->log_ratelimit.event_queue,
+					    "Event queue full, dropping %s\n",
+					    event_type_to_str(event->type));
+			libinput_event_destroy(event);
+		}
+		return;
+	}
+
 	events_count++;
 	if (events_count > events_len) {
 		events_len *= 2;
@@ -2627,12 +3459,12 @@ libinput_post_event(struct libinput *libinput,
 		libinput->events_len = events_len;
 	}
 
-	if (event->device)
-		libinput_device_ref(event->device);
-
 	libinput->events_count = events_count;
+	event->epoch = &libinput->events_epoch;
 	events[libinput->events_in] = event;
 	libinput->events_in = (libinput->events_in + 1) % libinput->events_len;
+	__atomic_store_n(&libinput->events_epoch.posted,
+			 libinput->events_epoch.posted + 1, __ATOMIC_RELEASE);
 }
 
 LIBINPUT_EXPORT struct libinput_event *
@@ -2647,6 +3479,8 @@ libinput_get_event(struct libinput *libinput)
 	libinput->events_out =
 		(libinput->events_out + 1) % libinput->events_len;
 	libinput->events_count--;
+	__atomic_store_n(&libinput->events_epoch.taken,
+			 libinput->events_epoch.taken + 1, __ATOMIC_RELEASE);
 
 	return event;
 }
@@ -2663,6 +3497,64 @@ libinput_next_event_type(struct libinput *libinput)
 	return event->type;
 }
 
+LIBINPUT_EXPORT int
+libinput_set_event_queue_mode(struct libinput *libinput,
+			      enum libinput_event_queue_mode mode)
+{
+	switch (mode) {
+	case LIBINPUT_EVENT_QUEUE_CONTEXT:
+	case LIBINPUT_EVENT_QUEUE_SEAT:
+	case LIBINPUT_EVENT_QUEUE_DEVICE:
+		break;
+	default:
+		return -1;
+	}
+
+	/* Existing seats and devices would have no queue */
+	if (!list_empty(&libinput->seat_list))
+		return -1;
+
+	libinput->event_queue_mode = mode;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT enum libinput_event_queue_mode
+libinput_get_event_queue_mode(struct libinput *libinput)
+{
+	return libinput->event_queue_mode;
+}
+
+LIBINPUT_EXPORT struct libinput_event *
+libinput_seat_get_event(struct libinput_seat *seat)
+{
+	if (!seat->queue)
+		return NULL;
+
+	return event_queue_pop(seat->queue);
+}
+
+LIBINPUT_EXPORT int
+libinput_seat_get_fd(struct libinput_seat *seat)
+{
+	return seat->queue ? seat->queue->wakeup[0] : -1;
+}
+
+LIBINPUT_EXPORT struct libinput_event *
+libinput_device_get_event(struct libinput_device *device)
+{
+	if (!device->queue)
+		return NULL;
+
+	return event_queue_pop(device->queue);
+}
+
+LIBINPUT_EXPORT int
+libinput_device_get_fd(struct libinput_device *device)
+{
+	return device->queue ? device->queue->wakeup[0] : -1;
+}
+
 LIBINPUT_EXPORT void
 libinput_set_user_data(struct libinput *libinput,
 		       void *user_data)
@@ -2676,16 +3568,19 @@ libinput_get_user_data(struct libinput *libinput)
 	return libinput->user_data;
 }
 
+extern int dragonfly_libinput_resume(struct libinput *libinput);
+extern void dragonfly_libinput_suspend(struct libinput *libinput);
+
 LIBINPUT_EXPORT int
 libinput_resume(struct libinput *libinput)
 {
-//	return libinput->interface_backend->resume(libinput);
+	return dragonfly_libinput_resume(libinput);
 }
 
 LIBINPUT_EXPORT void
 libinput_suspend(struct libinput *libinput)
 {
-//	libinput->interface_backend->suspend(libinput);
+	dragonfly_libinput_suspend(libinput);
 }
 
 LIBINPUT_EXPORT void
@@ -2713,6 +3608,12 @@ libinput_device_get_device_group(struct libinput_device *device)
 	return NULL;
 }
 
+LIBINPUT_EXPORT uint32_t
+libinput_device_get_id(struct libinput_device *device)
+{
+	return device->id;
+}
+
 LIBINPUT_EXPORT const char *
 libinput_device_get_sysname(struct libinput_device *device)
 {
@@ -2768,24 +3669,7 @@ LIBINPUT_EXPORT int
 libinput_device_has_capability(struct libinput_device *device,
 			       enum libinput_device_capability capability)
 {
-	int rc = 0;
-
-	switch (capability) {
-	case LIBINPUT_DEVICE_CAP_POINTER:
-		if (device->kind == SYSMOUSE)
-			rc = 1;
-		break;
-	case LIBINPUT_DEVICE_CAP_KEYBOARD:
-		if (device->kind == TTYKBD)
-			rc = 1;
-		break;
-	case LIBINPUT_DEVICE_CAP_TOUCH:
-	case LIBINPUT_DEVICE_CAP_GESTURE:
-	default:
-		break;
-	}
-
-	return rc;
+	return !!(device->caps & DEVICE_CAP_BIT(capability));
 }
 
 LIBINPUT_EXPORT int
@@ -2793,8 +3677,38 @@ libinput_device_get_size(struct libinput_device *device,
 			 double *width,
 			 double *height)
 {
-	fprintf(stderr, "%s: stub\n", __func__);
-	return (-1);
+	struct device_abs *abs = device->abs;
+
+	if (!abs || !abs->res_x || !abs->res_y)
+		return -1;
+
+	*width = device_abs_to_mm(abs->max_x, abs->min_x, abs->res_x);
+	*height = device_abs_to_mm(abs->max_y, abs->min_y, abs->res_y);
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_device_pointer_predict_motion(struct libinput_device *device,
+				       uint64_t time,
+				       double damping,
+				       double *dx,
+				       double *dy)
+{
+	struct normalized_coords predicted;
+
+	/* Need the negation in case damping is NaN */
+	if (!(damping >= 0.0 && damping <= 1.0))
+		return -1;
+
+	if (!device->filter ||
+	    !filter_predict(device->filter, device, time, damping, &predicted))
+		return -1;
+
+	*dx = predicted.x;
+	*dy = predicted.y;
+
+	return 0;
 }
 
 LIBINPUT_EXPORT int
@@ -2876,7 +3790,8 @@ libinput_event_pointer_get_base_event(struct libinput_event_pointer *event)
 			   LIBINPUT_EVENT_POINTER_MOTION,
 			   LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 			   LIBINPUT_EVENT_POINTER_BUTTON,
-			   LIBINPUT_EVENT_POINTER_AXIS);
+			   LIBINPUT_EVENT_POINTER_AXIS,
+			   LIBINPUT_EVENT_POINTER_FRAME);
 
 	return &event->base;
 }
@@ -3135,53 +4050,90 @@ libinput_device_config_tap_get_default_drag_lock_enabled(struct libinput_device
 LIBINPUT_EXPORT int
 libinput_device_config_calibration_has_matrix(struct libinput_device *device)
 {
-	return 0;
+	return device->config.calibration ?
+		device->config.calibration->has_matrix(device) : 0;
 }
 
 LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_calibration_set_matrix(struct libinput_device *device,
 					      const float matrix[6])
 {
-	return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+	if (!libinput_device_config_calibration_has_matrix(device))
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
+	return device->config.calibration->set_matrix(device, matrix);
 }
 
 LIBINPUT_EXPORT int
 libinput_device_config_calibration_get_matrix(struct libinput_device *device,
 					      float matrix[6])
 {
-	return 0;
+	struct matrix m;
+
+	if (!libinput_device_config_calibration_has_matrix(device)) {
+		matrix_init_identity(&m);
+		matrix_to_farray6(&m, matrix);
+		return 0;
+	}
+
+	return device->config.calibration->get_matrix(device, matrix);
 }
 
 LIBINPUT_EXPORT int
 libinput_device_config_calibration_get_default_matrix(struct libinput_device *device,
 						      float matrix[6])
 {
-	return 0;
+	struct matrix m;
+
+	if (!libinput_device_config_calibration_has_matrix(device)) {
+		matrix_init_identity(&m);
+		matrix_to_farray6(&m, matrix);
+		return 0;
+	}
+
+	return device->config.calibration->get_default_matrix(device, matrix);
 }
 
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_send_events_get_modes(struct libinput_device *device)
 {
-	return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+	uint32_t modes = LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+
+	if (device->config.sendevents)
+		modes |= device->config.sendevents->get_modes(device);
+
+	return modes;
 }
 
 LIBINPUT_EXPORT enum libinput_config_status
 libinput_device_config_send_events_set_mode(struct libinput_device *device,
 					    uint32_t mode)
 {
-	return LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+	if ((libinput_device_config_send_events_get_modes(device) & mode) != mode)
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
+	if (device->config.sendevents)
+		return device->config.sendevents->set_mode(device, mode);
+	else /* mode must be _ENABLED to get here */
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
 
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_send_events_get_mode(struct libinput_device *device)
 {
-	return LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+	if (device->config.sendevents)
+		return device->config.sendevents->get_mode(device);
+	else
+		return LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
 }
 
 LIBINPUT_EXPORT uint32_t
 libinput_device_config_send_events_get_default_mode(struct libinput_device *device)
 {
-	return LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+	if (device->config.sendevents)
+		return device->config.sendevents->get_default_mode(device);
+	else
+		return LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
 }
 
 LIBINPUT_EXPORT int
@@ -3256,6 +4208,7 @@ libinput_device_config_accel_set_profile(struct libinput_device *device,
 	switch (profile) {
 	case LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT:
 	case LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE:
+	case LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM:
 		break;
 	default:
 		return LIBINPUT_CONFIG_STATUS_INVALID;
@@ -3268,6 +4221,24 @@ libinput_device_config_accel_set_profile(struct libinput_device *device,
 	return device->config.accel->set_profile(device, profile);
 }
 
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_config_accel_set_custom_points(struct libinput_device *device,
+					       const double *speeds,
+					       const double *factors,
+					       size_t npoints)
+{
+	if (!libinput_device_config_accel_is_available(device) ||
+	    !device->config.accel->set_custom_points)
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
+	if (libinput_device_config_accel_get_profile(device) !=
+	    LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	return device->config.accel->set_custom_points(device, speeds,
+						       factors, npoints);
+}
+
 LIBINPUT_EXPORT int
 libinput_device_config_scroll_has_natural_scroll(struct libinput_device *device)
 {
@@ -3321,6 +4292,41 @@ libinput_device_config_scroll_get_default_natural_scroll_enabled(struct libinput
 #endif
 }
 
+LIBINPUT_EXPORT int
+libinput_device_config_scroll_has_coalesce(struct libinput_device *device)
+{
+	return device->config.scroll_coalesce != NULL;
+}
+
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_config_scroll_set_coalesce_window(struct libinput_device *device,
+						  uint32_t ms)
+{
+	if (!libinput_device_config_scroll_has_coalesce(device))
+		return ms ? LIBINPUT_CONFIG_STATUS_UNSUPPORTED :
+			    LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	return device->config.scroll_coalesce->set_window(device, ms);
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_device_config_scroll_get_coalesce_window(struct libinput_device *device)
+{
+	if (!libinput_device_config_scroll_has_coalesce(device))
+		return 0;
+
+	return device->config.scroll_coalesce->get_window(device);
+}
+
+LIBINPUT_EXPORT uint32_t
+libinput_device_config_scroll_get_default_coalesce_window(struct libinput_device *device)
+{
+	if (!libinput_device_config_scroll_has_coalesce(device))
+		return 0;
+
+	return device->config.scroll_coalesce->get_default_window(device);
+}
+
 LIBINPUT_EXPORT int
 libinput_device_config_left_handed_is_available(struct libinput_device *device)
 {
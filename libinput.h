@@ -281,6 +281,15 @@ enum libinput_event_type {
 	LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE,
 	LIBINPUT_EVENT_POINTER_BUTTON,
 	LIBINPUT_EVENT_POINTER_AXIS,
+	/**
+	 * Signals the end of the pointer events of one hardware report, a
+	 * caller can apply the preceding events at once. This event has no
+	 * information attached other than the time.
+	 *
+	 * Not delivered unless enabled with
+	 * libinput_event_type_set_enabled().
+	 */
+	LIBINPUT_EVENT_POINTER_FRAME,
 
 	LIBINPUT_EVENT_TOUCH_DOWN = 500,
 	LIBINPUT_EVENT_TOUCH_UP,
@@ -473,7 +482,7 @@ struct libinput_event_keyboard;
  * @struct libinput_event_pointer
  *
  * A pointer event representing relative or absolute pointer movement,
- * a button press/release or scroll axis events.
+ * a button press/release, scroll axis events or the end of a frame.
  */
 struct libinput_event_pointer;
 
@@ -920,6 +929,36 @@ libinput_event_pointer_get_absolute_y_transformed(
 	struct libinput_event_pointer *event,
 	uint32_t height);
 
+/**
+ * @ingroup event_pointer
+ *
+ * Transform the absolute coordinates of several events to screen
+ * coordinates at once, x[i] and y[i] are what
+ * libinput_event_pointer_get_absolute_x_transformed() and
+ * libinput_event_pointer_get_absolute_y_transformed() return for
+ * events[i].
+ *
+ * @note It is an application bug to pass events other than @ref
+ * LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, the transform stops at the
+ * first such event.
+ *
+ * @param events The libinput pointer events
+ * @param count The number of events
+ * @param width The current output screen width
+ * @param height The current output screen height
+ * @param x Set to count transformed x coordinates
+ * @param y Set to count transformed y coordinates
+ * @return The number of events transformed
+ */
+size_t
+libinput_event_pointer_get_absolute_transformed_batch(
+	struct libinput_event_pointer **events,
+	size_t count,
+	uint32_t width,
+	uint32_t height,
+	double *x,
+	double *y);
+
 /**
  * @ingroup event_pointer
  *
@@ -999,6 +1038,12 @@ libinput_event_pointer_has_axis(struct libinput_event_pointer *event,
  * respectively. For the interpretation of the value, see
  * libinput_event_pointer_get_axis_source().
  *
+ * For @ref LIBINPUT_POINTER_AXIS_SOURCE_WHEEL the value is in degrees, the
+ * number of wheel clicks times the click angle of the device. The angle
+ * comes from the device quirks and is 15 degrees by default. Earlier
+ * versions of this library returned the number of clicks instead, use
+ * libinput_event_pointer_get_axis_value_discrete() for that.
+ *
  * If libinput_event_pointer_has_axis() returns 0 for an axis, this function
  * returns 0 for that axis.
  *
@@ -2503,6 +2548,34 @@ struct libinput_device *
 libinput_path_add_device(struct libinput *libinput,
 			 const char *path);
 
+/**
+ * @ingroup base
+ *
+ * Add several devices to a libinput context initialized with
+ * libinput_path_create_context(). This is equivalent to calling
+ * libinput_path_add_device() for each path in order, but the device
+ * lookups and libinput_interface::open_restricted calls are issued
+ * concurrently from a small number of threads. The open_restricted
+ * callback must thus be safe to call from several threads at once.
+ *
+ * Devices are added to their seat in the order of the paths array, the
+ * time each device took to come up is logged at debug priority.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param paths Array of ndevices paths to input devices
+ * @param devices Array of ndevices, filled with the newly initiated
+ * device or NULL for each path. May be NULL.
+ * @param ndevices Number of paths
+ * @return The number of devices added, or -1 on failure.
+ *
+ * @see libinput_path_add_device
+ */
+int
+libinput_path_add_devices(struct libinput *libinput,
+			  const char * const *paths,
+			  struct libinput_device **devices,
+			  int ndevices);
+
 /**
  * @ingroup base
  *
@@ -2555,6 +2628,107 @@ libinput_get_fd(struct libinput *libinput);
 int
 libinput_dispatch(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Wait for input on any device and dispatch it. This is equivalent to
+ * calling poll() on the file descriptor returned by libinput_get_fd()
+ * followed by libinput_dispatch(), but needs only a single system call
+ * per wakeup. All sources that are ready when the wait returns are
+ * dispatched.
+ *
+ * Dispatching does not necessarily queue libinput events, a return value
+ * of 0 does not indicate that the timeout expired.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param timeout_us The maximum time to wait in microseconds. A timeout
+ * of 0 returns immediately, a negative timeout waits indefinitely.
+ *
+ * @return The number of events in the context queue after dispatching,
+ * or a negative errno on failure. In @ref LIBINPUT_EVENT_QUEUE_SEAT and
+ * @ref LIBINPUT_EVENT_QUEUE_DEVICE mode device events go to their own
+ * queues and are not counted, only device added and removed events are.
+ *
+ * @see libinput_dispatch
+ */
+int
+libinput_dispatch_wait(struct libinput *libinput, int64_t timeout_us);
+
+/**
+ * @ingroup base
+ *
+ * Keep reading devices and queuing events until the given deadline, e.g.
+ * the next vblank. The function waits for input while time remains and
+ * returns once the deadline has passed. Input still buffered by the
+ * kernel at that point is left for the next dispatch.
+ *
+ * In each round every device with pending data is read once, up to what
+ * was buffered when the round started, so a device that produces a lot
+ * of data delays the other devices by at most one kernel buffer.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param deadline_us The deadline in microseconds, on the same clock as
+ * the event timestamps (CLOCK_MONOTONIC). A deadline in the past returns
+ * immediately without dispatching.
+ *
+ * @return The number of events in the context queue after dispatching,
+ * or a negative errno on failure. In @ref LIBINPUT_EVENT_QUEUE_SEAT and
+ * @ref LIBINPUT_EVENT_QUEUE_DEVICE mode device events go to their own
+ * queues and are not counted, only device added and removed events are.
+ *
+ * @see libinput_dispatch
+ * @see libinput_dispatch_wait
+ */
+int
+libinput_dispatch_until(struct libinput *libinput, uint64_t deadline_us);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable the delivery of events of the given type for all
+ * devices in this context. Events of a disabled type are discarded before
+ * they are allocated and, where possible, the processing to generate them
+ * is skipped, e.g. pointer acceleration is not calculated if @ref
+ * LIBINPUT_EVENT_POINTER_MOTION is disabled. Re-enabling it starts the
+ * acceleration from rest, as after a pause in motion.
+ *
+ * State tracking is not affected, the seat-wide key and button counts
+ * reflect all keys and buttons even if their events are disabled.
+ *
+ * By default all event types are enabled. @ref
+ * LIBINPUT_EVENT_DEVICE_ADDED and @ref LIBINPUT_EVENT_DEVICE_REMOVED cannot
+ * be disabled.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type The event type to enable or disable
+ * @param enabled Non-zero to enable delivery of the event type, zero to
+ * disable it
+ *
+ * @return 0 on success or -1 if the event type cannot be disabled
+ *
+ * @see libinput_event_type_get_enabled
+ */
+int
+libinput_event_type_set_enabled(struct libinput *libinput,
+				enum libinput_event_type type,
+				int enabled);
+
+/**
+ * @ingroup base
+ *
+ * Check if events of the given type are delivered.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type The event type to check
+ *
+ * @return 1 if events of this type are delivered, 0 otherwise
+ *
+ * @see libinput_event_type_set_enabled
+ */
+int
+libinput_event_type_get_enabled(struct libinput *libinput,
+				enum libinput_event_type type);
+
 /**
  * @ingroup base
  *
@@ -2583,6 +2757,136 @@ libinput_get_event(struct libinput *libinput);
 enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Pointer motion of one libinput_dispatch() as parallel arrays, see
+ * libinput_get_motion_batch(). Entry i of every array belongs to the same
+ * motion, in the order the motion was reported. Each array starts on a 64
+ * byte boundary.
+ */
+struct libinput_motion_batch {
+	size_t count;
+	/** Timestamps in microseconds */
+	const uint64_t *time;
+	/** Accelerated deltas, see libinput_event_pointer_get_dx() */
+	const double *dx;
+	const double *dy;
+	/** See libinput_event_pointer_get_dx_unaccelerated() */
+	const double *dx_unaccelerated;
+	const double *dy_unaccelerated;
+	/** See libinput_device_get_id() */
+	const uint32_t *device_id;
+};
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable collecting relative pointer motion into a batch, see
+ * libinput_get_motion_batch(). Disabled by default.
+ *
+ * Motion is collected whether or not @ref LIBINPUT_EVENT_POINTER_MOTION
+ * events are delivered, a caller that only uses the batch can disable
+ * those with libinput_event_type_set_enabled().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enabled Non-zero to enable collecting motion
+ * @return 0 on success or -1 if the batch could not be allocated
+ */
+int
+libinput_motion_batch_set_enabled(struct libinput *libinput, int enabled);
+
+/**
+ * @ingroup base
+ *
+ * Return the pointer motion of the last libinput_dispatch(),
+ * libinput_dispatch_wait() or libinput_dispatch_until() call, all rounds
+ * of the latter included. The batch points into libinput's own buffers,
+ * it is valid until the next dispatch call or until the batch is disabled
+ * and must only be used on the thread calling libinput_dispatch().
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The motion batch, or NULL if collecting motion is disabled
+ *
+ * @see libinput_motion_batch_set_enabled
+ */
+const struct libinput_motion_batch *
+libinput_get_motion_batch(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Where events are queued for the caller.
+ */
+enum libinput_event_queue_mode {
+	/**
+	 * All events are queued on the context, see libinput_get_event().
+	 * This is the default.
+	 */
+	LIBINPUT_EVENT_QUEUE_CONTEXT = 0,
+	/**
+	 * Each seat has its own queue, see libinput_seat_get_event().
+	 */
+	LIBINPUT_EVENT_QUEUE_SEAT,
+	/**
+	 * Each device has its own queue, see libinput_device_get_event().
+	 */
+	LIBINPUT_EVENT_QUEUE_DEVICE,
+};
+
+/**
+ * @ingroup base
+ *
+ * Set where events are queued. In @ref LIBINPUT_EVENT_QUEUE_SEAT and @ref
+ * LIBINPUT_EVENT_QUEUE_DEVICE, @ref LIBINPUT_EVENT_DEVICE_ADDED and @ref
+ * LIBINPUT_EVENT_DEVICE_REMOVED are still queued on the context, all other
+ * events go to the queue of the seat or device they belong to.
+ *
+ * Each seat or device queue has a single consumer that may run on a
+ * different thread than the one calling libinput_dispatch(). Events taken
+ * off such a queue must be destroyed on that thread, no lock is shared
+ * with the dispatching thread or with other queues. A queue holds a
+ * bounded number of events, events posted while it is full are dropped
+ * and logged.
+ *
+ * Event accessors log client bugs, e.g. for an event of the wrong type, on
+ * the thread they are called on. In @ref LIBINPUT_LOG_MODE_SYNC the log
+ * handler is called on that consumer thread and must be safe to call from
+ * it. The queued log modes take messages from any thread, set the log mode
+ * before starting the consumers.
+ *
+ * A removed device is freed during a libinput_dispatch() after every event
+ * queued for it was destroyed and its last reference was dropped. Events
+ * are counted per queue, not per device, so this is only seen at a point
+ * where the caller holds no event taken off the queues the device posted
+ * to, of any device. A caller that keeps an event around for good keeps
+ * the removed devices of that queue allocated until it destroys it.
+ *
+ * The mode can only be changed before the first device is added.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param mode The new queue mode
+ * @return 0 on success or -1 if devices were already added or the mode is
+ * invalid
+ *
+ * @see libinput_seat_get_event
+ * @see libinput_device_get_event
+ */
+int
+libinput_set_event_queue_mode(struct libinput *libinput,
+			      enum libinput_event_queue_mode mode);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The context's event queue mode
+ *
+ * @see libinput_set_event_queue_mode
+ */
+enum libinput_event_queue_mode
+libinput_get_event_queue_mode(struct libinput *libinput);
+
 /**
  * @ingroup base
  *
@@ -2616,6 +2920,16 @@ libinput_get_user_data(struct libinput *libinput);
  * Resume a suspended libinput context. This re-enables device
  * monitoring and adds existing devices.
  *
+ * All devices are reopened at the same time, so
+ * libinput_interface::open_restricted may be called concurrently from
+ * several threads during this call. Input queued by the kernel while the
+ * context was suspended is discarded, and keys and buttons start out
+ * released: a key held down across the suspend does not generate a
+ * release event.
+ *
+ * A device that can't be reopened is removed, with a @ref
+ * LIBINPUT_EVENT_DEVICE_REMOVED event.
+ *
  * @param libinput A previously initialized libinput context
  * @see libinput_suspend
  *
@@ -2631,6 +2945,10 @@ libinput_resume(struct libinput *libinput);
  * This all but terminates libinput but does keep the context
  * valid to be resumed with libinput_resume().
  *
+ * Release events are queued for all keys and buttons that are still
+ * logically down, and keyboards are switched back out of raw scancode
+ * mode before their fd is closed.
+ *
  * @param libinput A previously initialized libinput context
  */
 void
@@ -2755,6 +3073,64 @@ void
 libinput_log_set_handler(struct libinput *libinput,
 			 libinput_log_handler log_handler);
 
+/**
+ * @ingroup base
+ *
+ * When log messages are passed to the log handler.
+ */
+enum libinput_log_mode {
+	/**
+	 * The handler is called from within the libinput call that logs
+	 * the message. This is the default.
+	 */
+	LIBINPUT_LOG_MODE_SYNC = 0,
+	/**
+	 * Messages are queued with their arguments, formatting and the
+	 * handler call happen at the end of libinput_dispatch() or in
+	 * libinput_log_flush().
+	 */
+	LIBINPUT_LOG_MODE_DEFERRED,
+	/**
+	 * Messages are queued and passed to the handler on a thread owned
+	 * by libinput. The handler must be safe to call from that thread.
+	 */
+	LIBINPUT_LOG_MODE_THREAD,
+};
+
+/**
+ * @ingroup base
+ *
+ * Set the context's log mode. In the queued modes, logging a message
+ * never waits for the log handler, messages logged while the queue is full
+ * are dropped and counted, the count is reported with the next flush.
+ *
+ * Queued messages are flushed when switching back to @ref
+ * LIBINPUT_LOG_MODE_SYNC and when the context is destroyed.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param mode The new log mode
+ * @return 0 on success or -1 if the mode could not be set, the previous
+ * mode stays in effect
+ *
+ * @see libinput_log_flush
+ */
+int
+libinput_log_set_mode(struct libinput *libinput,
+		      enum libinput_log_mode mode);
+
+/**
+ * @ingroup base
+ *
+ * Pass all queued log messages to the log handler now. Does nothing in
+ * @ref LIBINPUT_LOG_MODE_SYNC.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @see libinput_log_set_mode
+ */
+void
+libinput_log_flush(struct libinput *libinput);
+
 /**
  * @defgroup seat Initialization and manipulation of seats
  *
@@ -2860,6 +3236,41 @@ libinput_seat_get_physical_name(struct libinput_seat *seat);
 const char *
 libinput_seat_get_logical_name(struct libinput_seat *seat);
 
+/**
+ * @ingroup seat
+ *
+ * Retrieve the next event from the seat's queue in @ref
+ * LIBINPUT_EVENT_QUEUE_SEAT. Only one thread at a time may take events off
+ * a seat's queue.
+ *
+ * After handling the retrieved event, the caller must destroy it using
+ * libinput_event_destroy().
+ *
+ * @param seat A previously obtained seat
+ * @return The next available event, or NULL if no event is available or
+ * the seat has no queue.
+ *
+ * @see libinput_set_event_queue_mode
+ */
+struct libinput_event *
+libinput_seat_get_event(struct libinput_seat *seat);
+
+/**
+ * @ingroup seat
+ *
+ * Return a file descriptor that becomes readable when events are queued
+ * for the seat. The caller must not read from it, it is reset by the
+ * libinput_seat_get_event() call that returns NULL. The file descriptor
+ * is owned by the seat and closed when the seat is destroyed.
+ *
+ * @param seat A previously obtained seat
+ * @return The file descriptor, or -1 if the seat has no queue
+ *
+ * @see libinput_seat_get_event
+ */
+int
+libinput_seat_get_fd(struct libinput_seat *seat);
+
 /**
  * @defgroup device Initialization and manipulation of input devices
  */
@@ -2992,6 +3403,18 @@ libinput_device_get_context(struct libinput_device *device);
 struct libinput_device_group *
 libinput_device_get_device_group(struct libinput_device *device);
 
+/**
+ * @ingroup device
+ *
+ * Get a numeric identifier of the device, unique within the context for
+ * its lifetime and never 0. Used in struct libinput_motion_batch.
+ *
+ * @param device A previously obtained device
+ * @return The device's identifier
+ */
+uint32_t
+libinput_device_get_id(struct libinput_device *device);
+
 /**
  * @ingroup device
  *
@@ -3080,6 +3503,42 @@ libinput_device_get_output_name(struct libinput_device *device);
 struct libinput_seat *
 libinput_device_get_seat(struct libinput_device *device);
 
+/**
+ * @ingroup device
+ *
+ * Retrieve the next event from the device's queue in @ref
+ * LIBINPUT_EVENT_QUEUE_DEVICE. Only one thread at a time may take events
+ * off a device's queue. That thread should hold a reference to the device,
+ * see libinput_device_ref(), until it is done with the queue.
+ *
+ * After handling the retrieved event, the caller must destroy it using
+ * libinput_event_destroy().
+ *
+ * @param device A previously obtained device
+ * @return The next available event, or NULL if no event is available or
+ * the device has no queue.
+ *
+ * @see libinput_set_event_queue_mode
+ */
+struct libinput_event *
+libinput_device_get_event(struct libinput_device *device);
+
+/**
+ * @ingroup device
+ *
+ * Return a file descriptor that becomes readable when events are queued
+ * for the device. The caller must not read from it, it is reset by the
+ * libinput_device_get_event() call that returns NULL. The file descriptor
+ * is owned by the device and closed when the device is destroyed.
+ *
+ * @param device A previously obtained device
+ * @return The file descriptor, or -1 if the device has no queue
+ *
+ * @see libinput_device_get_event
+ */
+int
+libinput_device_get_fd(struct libinput_device *device);
+
 /**
  * @ingroup device
  *
@@ -3160,8 +3619,9 @@ libinput_device_has_capability(struct libinput_device *device,
  * @ingroup device
  *
  * Get the physical size of a device in mm, where meaningful. This function
- * only succeeds on devices with the required data, i.e. tablets, touchpads
- * and touchscreens.
+ * only succeeds on devices with the required data, i.e. absolute pointer
+ * devices that report their resolution, tablets, touchpads and
+ * touchscreens.
  *
  * If this function returns nonzero, width and height are unmodified.
  *
@@ -3175,6 +3635,42 @@ libinput_device_get_size(struct libinput_device *device,
 			 double *width,
 			 double *height);
 
+/**
+ * @ingroup device
+ *
+ * Predict the accelerated motion of a @ref LIBINPUT_DEVICE_CAP_POINTER
+ * device up to the given time, e.g. the presentation time of the next
+ * frame. The prediction extrapolates the velocity of the most recent
+ * motion events with the device's current acceleration, the result is the
+ * delta expected between the last @ref LIBINPUT_EVENT_POINTER_MOTION event
+ * and the given time.
+ *
+ * A caller may draw the cursor at the predicted position to hide some of
+ * the input latency. The prediction is not accumulated, the next motion
+ * event contains the actual delta.
+ *
+ * If the pointer has stopped or the time is not after the most recent
+ * event, the predicted delta is 0.
+ *
+ * @param device A current input device
+ * @param time The time to predict for in microseconds, on the same clock
+ * as the event timestamps
+ * @param damping A factor in the range [0, 1] applied to the predicted
+ * delta. Lower values trade accuracy on straight motion for less
+ * overshoot when the pointer stops or changes direction.
+ * @param dx Set to the predicted delta on the x axis
+ * @param dy Set to the predicted delta on the y axis
+ *
+ * @return 0 on success or -1 if the device does not keep a motion history
+ * for acceleration or the damping is out of range.
+ */
+int
+libinput_device_pointer_predict_motion(struct libinput_device *device,
+				       uint64_t time,
+				       double damping,
+				       double *dx,
+				       double *dy);
+
 /**
  * @ingroup device
  *
@@ -3929,6 +4425,14 @@ enum libinput_config_accel_profile {
 	 * on the input speed. This is the default profile for most devices.
 	 */
 	LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE = (1 << 1),
+
+	/**
+	 * A client-defined acceleration profile. The acceleration factor
+	 * is interpolated from the points set with
+	 * libinput_device_config_accel_set_custom_points(), until then
+	 * pointer motion is not accelerated.
+	 */
+	LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM = (1 << 2),
 };
 
 /**
@@ -3983,6 +4487,42 @@ libinput_device_config_accel_get_profile(struct libinput_device *device);
 enum libinput_config_accel_profile
 libinput_device_config_accel_get_default_profile(struct libinput_device *device);
 
+/**
+ * @ingroup config
+ *
+ * Set the acceleration curve of a device using the @ref
+ * LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM profile. The curve passes through
+ * every (speed, factor) point and is interpolated between them with a
+ * monotone cubic, so increasing factors give a curve that never
+ * decreases. Below the first and above the last point the factor stays
+ * constant.
+ *
+ * Speeds are in units/ms, where a unit is one device unit of a 1000dpi
+ * device, and must be strictly increasing. Factors are unitless and must
+ * not be negative. The curve is evaluated from a precomputed table, the
+ * cost of acceleration doesn't depend on the number of points.
+ *
+ * The points are kept when the device switches to a different profile
+ * and apply again once it is back on the custom profile. The speed set
+ * with libinput_device_config_accel_set_speed() has no effect on the
+ * custom curve.
+ *
+ * @param device The device to configure
+ * @param speeds Array of npoints input speeds
+ * @param factors Array of npoints acceleration factors
+ * @param npoints The number of points, between 2 and 64
+ *
+ * @return A config status code. @ref LIBINPUT_CONFIG_STATUS_INVALID if
+ * the device isn't using the custom profile or the points are invalid.
+ *
+ * @see libinput_device_config_accel_set_profile
+ */
+enum libinput_config_status
+libinput_device_config_accel_set_custom_points(struct libinput_device *device,
+					       const double *speeds,
+					       const double *factors,
+					       size_t npoints);
+
 /**
  * @ingroup config
  *
@@ -4064,6 +4604,72 @@ libinput_device_config_scroll_get_natural_scroll_enabled(struct libinput_device
 int
 libinput_device_config_scroll_get_default_natural_scroll_enabled(struct libinput_device *device);
 
+/**
+ * @ingroup config
+ *
+ * Check if the device can merge wheel clicks into fewer axis events.
+ *
+ * @param device The device to configure
+ *
+ * @return Non-zero if wheel coalescing is available
+ *
+ * @see libinput_device_config_scroll_set_coalesce_window
+ */
+int
+libinput_device_config_scroll_has_coalesce(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Set the time window in which wheel clicks are merged. All clicks in the
+ * same direction within ms milliseconds of the first one are sent as a
+ * single @ref LIBINPUT_EVENT_POINTER_AXIS event whose discrete value is
+ * the total number of clicks. A window of 0 sends every click as it
+ * arrives.
+ *
+ * Merging delays the first click of a burst by up to the window, so this
+ * trades latency for fewer events during fast scrolling.
+ *
+ * @param device The device to configure
+ * @param ms The window in milliseconds, at most 1000
+ *
+ * @return A config status code
+ *
+ * @see libinput_device_config_scroll_get_coalesce_window
+ * @see libinput_device_config_scroll_get_default_coalesce_window
+ */
+enum libinput_config_status
+libinput_device_config_scroll_set_coalesce_window(struct libinput_device *device,
+						  uint32_t ms);
+
+/**
+ * @ingroup config
+ *
+ * Get the current wheel coalescing window of this device.
+ *
+ * @param device The device to configure
+ *
+ * @return The window in milliseconds, 0 if clicks are not merged
+ *
+ * @see libinput_device_config_scroll_set_coalesce_window
+ */
+uint32_t
+libinput_device_config_scroll_get_coalesce_window(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Get the default wheel coalescing window of this device.
+ *
+ * @param device The device to configure
+ *
+ * @return The default window in milliseconds
+ *
+ * @see libinput_device_config_scroll_set_coalesce_window
+ */
+uint32_t
+libinput_device_config_scroll_get_default_coalesce_window(struct libinput_device *device);
+
 /**
  * @ingroup config
  *
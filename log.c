@@ -0,0 +1,609 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Queued logging for LIBINPUT_LOG_MODE_DEFERRED and _THREAD.
+ *
+ * A log call only stores the format pointer and copies of the arguments
+ * into a ring, the format string itself must stay valid, which holds for
+ * the string literals all log sites use. Formatting and the handler call
+ * happen when the ring is flushed.
+ *
+ * Any thread may log: the one calling into libinput, and the consumers of
+ * seat and device queues, whose event accessors log client bugs. The
+ * probe threads don't log. A producer reserves a record by advancing head
+ * with a compare-and-swap and publishes it through the record's seq, so
+ * it never takes a lock. Flushes are serialized between themselves with
+ * flush_lock and stop at the first record that isn't published yet.
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <sys/types.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+#define LOG_RING_SIZE		256	/* records, power of two */
+#define LOG_RECORD_ARGS		8
+#define LOG_RECORD_STRINGS	192	/* bytes for copied %s arguments */
+#define LOG_LINE_MAX		1024
+#define LOG_THREAD_WAKEUP_MS	100
+
+enum log_arg_type {
+	LOG_ARG_INT,
+	LOG_ARG_UINT,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_LDOUBLE,
+	LOG_ARG_PTR,
+	LOG_ARG_STR,
+};
+
+struct log_arg {
+	enum log_arg_type type;
+	union {
+		intmax_t i;
+		uintmax_t u;
+		double d;
+		long double ld;
+		const void *p;
+		size_t str;	/* offset into strings */
+	};
+};
+
+struct log_record {
+	unsigned int seq;	/* position + 1 once filled */
+	enum libinput_log_priority priority;
+	const char *format;	/* NULL if already formatted into strings */
+	int nargs;
+	struct log_arg args[LOG_RECORD_ARGS];
+	size_t strings_len;
+	char strings[LOG_RECORD_STRINGS];
+};
+
+struct log_ring {
+	struct libinput *libinput;
+
+	unsigned int head;	/* next record to reserve */
+	unsigned int tail;	/* next record to flush */
+	unsigned int dropped;
+	pthread_mutex_t flush_lock;
+
+	/* LIBINPUT_LOG_MODE_THREAD only */
+	bool threaded;
+	bool quit;
+	pthread_t thread;
+	pthread_mutex_t wakeup_lock;
+	pthread_cond_t wakeup;
+
+	struct log_record records[LOG_RING_SIZE];
+};
+
+enum log_length {
+	LOG_LEN_NONE,
+	LOG_LEN_HH,
+	LOG_LEN_H,
+	LOG_LEN_L,
+	LOG_LEN_LL,
+	LOG_LEN_J,
+	LOG_LEN_Z,
+	LOG_LEN_T,
+	LOG_LEN_BIG_L,
+};
+
+/* Conversion specification, shared between capture and rendering */
+struct log_spec {
+	const char *start;	/* the '%' */
+	const char *flags;
+	size_t nflags;
+	bool width_star, prec_star, has_prec;
+	const char *width, *prec;
+	size_t nwidth, nprec;
+	enum log_length length;
+	char conv;
+	const char *end;	/* one past the conversion character */
+};
+
+static const char *
+log_parse_spec(const char *p, struct log_spec *spec)
+{
+	spec->start = p++;
+
+	spec->flags = p;
+	spec->nflags = strspn(p, "-+ #0");
+	p += spec->nflags;
+
+	spec->width_star = (*p == '*');
+	spec->width = p;
+	spec->nwidth = spec->width_star ? 1 : strspn(p, "0123456789");
+	p += spec->nwidth;
+
+	spec->has_prec = (*p == '.');
+	spec->prec_star = false;
+	spec->prec = p;
+	spec->nprec = 0;
+	if (spec->has_prec) {
+		p++;
+		spec->prec = p;
+		spec->prec_star = (*p == '*');
+		spec->nprec = spec->prec_star ? 1 : strspn(p, "0123456789");
+		p += spec->nprec;
+	}
+
+	switch (*p) {
+	case 'h':
+		p++;
+		spec->length = LOG_LEN_H;
+		if (*p == 'h') {
+			p++;
+			spec->length = LOG_LEN_HH;
+		}
+		break;
+	case 'l':
+		p++;
+		spec->length = LOG_LEN_L;
+		if (*p == 'l') {
+			p++;
+			spec->length = LOG_LEN_LL;
+		}
+		break;
+	case 'j': p++; spec->length = LOG_LEN_J; break;
+	case 'z': p++; spec->length = LOG_LEN_Z; break;
+	case 't': p++; spec->length = LOG_LEN_T; break;
+	case 'L': p++; spec->length = LOG_LEN_BIG_L; break;
+	default: spec->length = LOG_LEN_NONE; break;
+	}
+
+	spec->conv = *p;
+	if (*p != '\0')
+		p++;
+	spec->end = p;
+
+	return p;
+}
+
+static bool
+log_capture_signed(struct log_arg *arg, enum log_length length, va_list *args)
+{
+	arg->type = LOG_ARG_INT;
+
+	switch (length) {
+	case LOG_LEN_L: arg->i = va_arg(*args, long); break;
+	case LOG_LEN_LL: arg->i = va_arg(*args, long long); break;
+	case LOG_LEN_J: arg->i = va_arg(*args, intmax_t); break;
+	case LOG_LEN_Z: arg->i = va_arg(*args, ssize_t); break;
+	case LOG_LEN_T: arg->i = va_arg(*args, ptrdiff_t); break;
+	case LOG_LEN_BIG_L: return false;
+	default: arg->i = va_arg(*args, int); break;
+	}
+
+	return true;
+}
+
+static bool
+log_capture_unsigned(struct log_arg *arg, enum log_length length,
+		     va_list *args)
+{
+	arg->type = LOG_ARG_UINT;
+
+	switch (length) {
+	case LOG_LEN_L: arg->u = va_arg(*args, unsigned long); break;
+	case LOG_LEN_LL: arg->u = va_arg(*args, unsigned long long); break;
+	case LOG_LEN_J: arg->u = va_arg(*args, uintmax_t); break;
+	case LOG_LEN_Z: arg->u = va_arg(*args, size_t); break;
+	case LOG_LEN_T: arg->u = va_arg(*args, ptrdiff_t); break;
+	case LOG_LEN_BIG_L: return false;
+	default: arg->u = va_arg(*args, unsigned int); break;
+	}
+
+	return true;
+}
+
+static bool
+log_capture_string(struct log_record *rec, struct log_arg *arg,
+		   const char *str)
+{
+	size_t avail = LOG_RECORD_STRINGS - rec->strings_len;
+	size_t len;
+
+	if (avail == 0)
+		return false;
+
+	if (str == NULL)
+		str = "(null)";
+
+	/* Truncated to what is left */
+	len = strnlen(str, avail - 1);
+	memcpy(rec->strings + rec->strings_len, str, len);
+	rec->strings[rec->strings_len + len] = '\0';
+
+	arg->type = LOG_ARG_STR;
+	arg->str = rec->strings_len;
+	rec->strings_len += len + 1;
+
+	return true;
+}
+
+/* false if the format needs more than the record holds or something we
+ * don't know how to keep, the caller formats right away then */
+static bool
+log_capture(struct log_record *rec, const char *format, va_list *args)
+{
+	struct log_spec spec;
+	struct log_arg *arg;
+	const char *p = format;
+	int n = 0;
+
+	rec->strings_len = 0;
+
+	while ((p = strchr(p, '%')) != NULL) {
+		if (p[1] == '%') {
+			p += 2;
+			continue;
+		}
+
+		p = log_parse_spec(p, &spec);
+
+		/* Up to two '*' arguments plus the value */
+		if (n + spec.width_star + spec.prec_star + 1 > LOG_RECORD_ARGS)
+			return false;
+
+		if (spec.width_star) {
+			rec->args[n].type = LOG_ARG_INT;
+			rec->args[n++].i = va_arg(*args, int);
+		}
+		if (spec.prec_star) {
+			rec->args[n].type = LOG_ARG_INT;
+			rec->args[n++].i = va_arg(*args, int);
+		}
+
+		arg = &rec->args[n++];
+
+		switch (spec.conv) {
+		case 'd':
+		case 'i':
+			if (!log_capture_signed(arg, spec.length, args))
+				return false;
+			break;
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			if (!log_capture_unsigned(arg, spec.length, args))
+				return false;
+			break;
+		case 'c':
+			if (spec.length != LOG_LEN_NONE)
+				return false;
+			arg->type = LOG_ARG_INT;
+			arg->i = va_arg(*args, int);
+			break;
+		case 'e': case 'E':
+		case 'f': case 'F':
+		case 'g': case 'G':
+		case 'a': case 'A':
+			if (spec.length == LOG_LEN_BIG_L) {
+				arg->type = LOG_ARG_LDOUBLE;
+				arg->ld = va_arg(*args, long double);
+			} else {
+				arg->type = LOG_ARG_DOUBLE;
+				arg->d = va_arg(*args, double);
+			}
+			break;
+		case 's':
+			if (spec.length != LOG_LEN_NONE)
+				return false;
+			if (!log_capture_string(rec, arg,
+						va_arg(*args, const char *)))
+				return false;
+			break;
+		case 'p':
+			arg->type = LOG_ARG_PTR;
+			arg->p = va_arg(*args, void *);
+			break;
+		default:
+			/* %n, %m, wide characters, malformed specs */
+			return false;
+		}
+	}
+
+	rec->nargs = n;
+
+	return true;
+}
+
+static void
+log_append(char *out, size_t size, size_t *pos, const char *s, size_t len)
+{
+	if (*pos + 1 >= size)
+		return;
+
+	len = min(len, size - 1 - *pos);
+	memcpy(out + *pos, s, len);
+	*pos += len;
+	out[*pos] = '\0';
+}
+
+/* Format one captured record, each conversion goes through snprintf()
+ * with the length modifier matching how the argument was stored */
+static void
+log_render(const struct log_record *rec, char *out, size_t size)
+{
+	struct log_spec spec;
+	const struct log_arg *arg;
+	const char *p = rec->format, *pct;
+	char fmt[64], piece[LOG_LINE_MAX];
+	size_t pos = 0, flen;
+	int n = 0, len;
+
+	out[0] = '\0';
+
+	while ((pct = strchr(p, '%')) != NULL) {
+		log_append(out, size, &pos, p, pct - p);
+
+		if (pct[1] == '%') {
+			log_append(out, size, &pos, "%", 1);
+			p = pct + 2;
+			continue;
+		}
+
+		p = log_parse_spec(pct, &spec);
+
+		flen = snprintf(fmt, sizeof(fmt), "%%%.*s", (int)spec.nflags,
+				spec.flags);
+		if (spec.width_star)
+			flen += snprintf(fmt + flen, sizeof(fmt) - flen, "%d",
+					 (int)rec->args[n++].i);
+		else
+			flen += snprintf(fmt + flen, sizeof(fmt) - flen, "%.*s",
+					 (int)spec.nwidth, spec.width);
+		if (spec.has_prec && spec.prec_star)
+			flen += snprintf(fmt + flen, sizeof(fmt) - flen, ".%d",
+					 (int)rec->args[n++].i);
+		else if (spec.has_prec)
+			flen += snprintf(fmt + flen, sizeof(fmt) - flen, ".%.*s",
+					 (int)spec.nprec, spec.prec);
+
+		arg = &rec->args[n++];
+
+		switch (arg->type) {
+		case LOG_ARG_INT:
+			if (spec.conv == 'c') {
+				snprintf(fmt + flen, sizeof(fmt) - flen, "c");
+				len = snprintf(piece, sizeof(piece), fmt,
+					       (int)arg->i);
+			} else {
+				snprintf(fmt + flen, sizeof(fmt) - flen, "j%c",
+					 spec.conv);
+				len = snprintf(piece, sizeof(piece), fmt,
+					       arg->i);
+			}
+			break;
+		case LOG_ARG_UINT:
+			snprintf(fmt + flen, sizeof(fmt) - flen, "j%c",
+				 spec.conv);
+			len = snprintf(piece, sizeof(piece), fmt, arg->u);
+			break;
+		case LOG_ARG_DOUBLE:
+			snprintf(fmt + flen, sizeof(fmt) - flen, "%c",
+				 spec.conv);
+			len = snprintf(piece, sizeof(piece), fmt, arg->d);
+			break;
+		case LOG_ARG_LDOUBLE:
+			snprintf(fmt + flen, sizeof(fmt) - flen, "L%c",
+				 spec.conv);
+			len = snprintf(piece, sizeof(piece), fmt, arg->ld);
+			break;
+		case LOG_ARG_PTR:
+			snprintf(fmt + flen, sizeof(fmt) - flen, "p");
+			len = snprintf(piece, sizeof(piece), fmt, arg->p);
+			break;
+		case LOG_ARG_STR:
+			snprintf(fmt + flen, sizeof(fmt) - flen, "s");
+			len = snprintf(piece, sizeof(piece), fmt,
+				       rec->strings + arg->str);
+			break;
+		default:
+			len = 0;
+			break;
+		}
+
+		if (len > 0)
+			log_append(out, size, &pos, piece,
+				   min((size_t)len, sizeof(piece) - 1));
+	}
+
+	log_append(out, size, &pos, p, strlen(p));
+}
+
+static void
+log_call_handler(struct libinput *libinput,
+		 enum libinput_log_priority priority,
+		 const char *format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	libinput->log_handler(libinput, priority, format, args);
+	va_end(args);
+}
+
+void
+log_ring_push(struct log_ring *ring,
+	      enum libinput_log_priority priority,
+	      const char *format,
+	      va_list args)
+{
+	struct log_record *rec;
+	unsigned int head, tail;
+	va_list copy;
+
+	head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	do {
+		tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		if (head - tail == LOG_RING_SIZE) {
+			__atomic_fetch_add(&ring->dropped, 1,
+					   __ATOMIC_RELAXED);
+			return;
+		}
+	} while (!__atomic_compare_exchange_n(&ring->head, &head, head + 1,
+					      true, __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+
+	rec = &ring->records[head & (LOG_RING_SIZE - 1)];
+	rec->priority = priority;
+	rec->format = format;
+
+	va_copy(copy, args);
+	if (!log_capture(rec, format, &copy)) {
+		rec->format = NULL;
+		vsnprintf(rec->strings, sizeof(rec->strings), format, args);
+	}
+	va_end(copy);
+
+	__atomic_store_n(&rec->seq, head + 1, __ATOMIC_RELEASE);
+
+	/* Doesn't need the mutex, a missed wakeup only delays the
+	 * output until the thread's timeout */
+	if (ring->threaded)
+		pthread_cond_signal(&ring->wakeup);
+}
+
+void
+log_ring_flush(struct log_ring *ring)
+{
+	struct libinput *libinput = ring->libinput;
+	struct log_record *rec;
+	unsigned int tail, dropped;
+	char line[LOG_LINE_MAX];
+
+	pthread_mutex_lock(&ring->flush_lock);
+
+	/* A reserved record still being filled holds up the ones after
+	 * it until the next flush */
+	for (tail = ring->tail; ; tail++) {
+		rec = &ring->records[tail & (LOG_RING_SIZE - 1)];
+		if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != tail + 1)
+			break;
+
+		if (libinput->log_handler) {
+			if (rec->format)
+				log_render(rec, line, sizeof(line));
+			log_call_handler(libinput, rec->priority, "%s",
+					 rec->format ? line : rec->strings);
+		}
+
+		__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	}
+
+	dropped = __atomic_exchange_n(&ring->dropped, 0, __ATOMIC_RELAXED);
+	if (dropped > 0 && libinput->log_handler)
+		log_call_handler(libinput, LIBINPUT_LOG_PRIORITY_ERROR,
+				 "log queue full, %u messages dropped\n",
+				 dropped);
+
+	pthread_mutex_unlock(&ring->flush_lock);
+}
+
+static void *
+log_ring_thread(void *data)
+{
+	struct log_ring *ring = data;
+	struct timespec ts;
+	bool quit;
+
+	for (;;) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += LOG_THREAD_WAKEUP_MS * 1000000L;
+		if (ts.tv_nsec >= 1000000000L) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+
+		pthread_mutex_lock(&ring->wakeup_lock);
+		if (!ring->quit)
+			pthread_cond_timedwait(&ring->wakeup,
+					       &ring->wakeup_lock, &ts);
+		quit = ring->quit;
+		pthread_mutex_unlock(&ring->wakeup_lock);
+
+		log_ring_flush(ring);
+
+		if (quit)
+			break;
+	}
+
+	return NULL;
+}
+
+struct log_ring *
+log_ring_create(struct libinput *libinput, bool threaded)
+{
+	struct log_ring *ring;
+
+	ring = zalloc(sizeof(*ring));
+	if (ring == NULL)
+		return NULL;
+
+	ring->libinput = libinput;
+	pthread_mutex_init(&ring->flush_lock, NULL);
+	pthread_mutex_init(&ring->wakeup_lock, NULL);
+	pthread_cond_init(&ring->wakeup, NULL);
+
+	if (threaded) {
+		ring->threaded = true;
+		if (pthread_create(&ring->thread, NULL, log_ring_thread,
+				   ring) != 0) {
+			ring->threaded = false;
+			log_ring_destroy(ring);
+			return NULL;
+		}
+	}
+
+	return ring;
+}
+
+/* Flushes whatever is still queued */
+void
+log_ring_destroy(struct log_ring *ring)
+{
+	if (ring->threaded) {
+		pthread_mutex_lock(&ring->wakeup_lock);
+		ring->quit = true;
+		pthread_cond_signal(&ring->wakeup);
+		pthread_mutex_unlock(&ring->wakeup_lock);
+		pthread_join(ring->thread, NULL);
+	}
+
+	log_ring_flush(ring);
+
+	pthread_cond_destroy(&ring->wakeup);
+	pthread_mutex_destroy(&ring->wakeup_lock);
+	pthread_mutex_destroy(&ring->flush_lock);
+	free(ring);
+}
@@ -0,0 +1,329 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Build-time compiler for the quirks database, turns quirks.txt into the
+ * sorted index described in quirks-index.h.
+ *
+ * usage: quirks-compile quirks.txt quirks.idx
+ *
+ * The text file is a list of sections:
+ *
+ *	[Some description]
+ *	MatchDriver=sysmouse
+ *	MatchProperty=name=value	optional, a devattr property
+ *	MouseDpi=800@125		same syntax as udev's MOUSE_DPI
+ *	MouseWheelClickAngle=15		degrees
+ *	AccelProfile=adaptive		adaptive, flat or custom
+ *
+ * Empty lines and lines starting with '#' are ignored.
+ */
+
+#include <err.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "quirks-index.h"
+
+struct quirk {
+	char *section;
+	int line;
+	char *driver;
+	char *prop_name;
+	char *prop_value;
+	int32_t dpi;
+	int32_t wheel_click_angle;
+	uint32_t accel_profile;
+};
+
+static struct quirk *quirks;
+static size_t nquirks;
+
+static char *strtab;
+static size_t strtab_len;
+
+static char *
+xstrdup(const char *s)
+{
+	char *p = strdup(s);
+
+	if (p == NULL)
+		err(1, "strdup");
+	return p;
+}
+
+static uint32_t
+strtab_add(const char *s)
+{
+	size_t off, len = strlen(s) + 1;
+
+	if (*s == '\0')
+		return 0;
+
+	/* Few distinct strings, a linear search is fine */
+	for (off = 1; off < strtab_len; off += strlen(strtab + off) + 1) {
+		if (streq(strtab + off, s))
+			return off;
+	}
+
+	strtab = realloc(strtab, strtab_len + len);
+	if (strtab == NULL)
+		err(1, "realloc");
+	memcpy(strtab + strtab_len, s, len);
+	off = strtab_len;
+	strtab_len += len;
+
+	return off;
+}
+
+/* devattr numbers are matched against their decimal form at runtime */
+static char *
+normalize_match_value(const char *value)
+{
+	char *end, buf[24];
+	uintmax_t v;
+
+	if (*value == '\0' || *value == '-')
+		return xstrdup(value);
+
+	errno = 0;
+	v = strtoumax(value, &end, 0);
+	if (errno != 0 || *end != '\0')
+		return xstrdup(value);
+
+	snprintf(buf, sizeof(buf), "%ju", v);
+	return xstrdup(buf);
+}
+
+static uint32_t
+parse_accel_profile(const char *value)
+{
+	if (streq(value, "adaptive"))
+		return LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE;
+	if (streq(value, "flat"))
+		return LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT;
+	if (streq(value, "custom"))
+		return LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM;
+	return 0;
+}
+
+static char *
+trim(char *s)
+{
+	char *end;
+
+	while (*s == ' ' || *s == '\t')
+		s++;
+	end = s + strlen(s);
+	while (end > s && (end[-1] == ' ' || end[-1] == '\t' ||
+			   end[-1] == '\n' || end[-1] == '\r'))
+		end--;
+	*end = '\0';
+
+	return s;
+}
+
+static void
+parse_file(const char *path)
+{
+	FILE *fp;
+	char buf[512], *line, *key, *value, *eq;
+	struct quirk *q = NULL;
+	int lineno = 0;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		err(1, "%s", path);
+
+	while (fgets(buf, sizeof(buf), fp) != NULL) {
+		lineno++;
+		line = trim(buf);
+		if (*line == '\0' || *line == '#')
+			continue;
+
+		if (*line == '[') {
+			if (line[strlen(line) - 1] != ']')
+				errx(1, "%s:%d: unterminated section name",
+				     path, lineno);
+			line[strlen(line) - 1] = '\0';
+
+			quirks = realloc(quirks, (nquirks + 1) * sizeof(*q));
+			if (quirks == NULL)
+				err(1, "realloc");
+			q = &quirks[nquirks++];
+			memset(q, 0, sizeof(*q));
+			q->section = xstrdup(line + 1);
+			q->line = lineno;
+			continue;
+		}
+
+		if (q == NULL)
+			errx(1, "%s:%d: key outside of a section", path, lineno);
+
+		eq = strchr(line, '=');
+		if (eq == NULL)
+			errx(1, "%s:%d: expected key=value", path, lineno);
+		*eq = '\0';
+		key = trim(line);
+		value = trim(eq + 1);
+
+		if (streq(key, "MatchDriver")) {
+			q->driver = xstrdup(value);
+		} else if (streq(key, "MatchProperty")) {
+			eq = strchr(value, '=');
+			if (eq == NULL || eq == value || q->prop_name)
+				errx(1, "%s:%d: expected one name=value",
+				     path, lineno);
+			*eq = '\0';
+			q->prop_name = xstrdup(trim(value));
+			q->prop_value = normalize_match_value(trim(eq + 1));
+		} else if (streq(key, "MouseDpi")) {
+			q->dpi = parse_mouse_dpi_property(value);
+			if (q->dpi == 0)
+				errx(1, "%s:%d: invalid MouseDpi '%s'",
+				     path, lineno, value);
+		} else if (streq(key, "MouseWheelClickAngle")) {
+			q->wheel_click_angle =
+				parse_mouse_wheel_click_angle_property(value);
+			if (q->wheel_click_angle == 0)
+				errx(1, "%s:%d: invalid MouseWheelClickAngle '%s'",
+				     path, lineno, value);
+		} else if (streq(key, "AccelProfile")) {
+			q->accel_profile = parse_accel_profile(value);
+			if (q->accel_profile == 0)
+				errx(1, "%s:%d: invalid AccelProfile '%s'",
+				     path, lineno, value);
+		} else {
+			errx(1, "%s:%d: unknown key '%s'", path, lineno, key);
+		}
+	}
+
+	if (ferror(fp))
+		err(1, "%s", path);
+	fclose(fp);
+}
+
+static int
+quirk_cmp(const void *a, const void *b)
+{
+	const struct quirk *qa = a, *qb = b;
+	int r;
+
+	r = strcmp(qa->driver, qb->driver);
+	if (r == 0)
+		r = strcmp(qa->prop_name ? qa->prop_name : "",
+			   qb->prop_name ? qb->prop_name : "");
+	if (r == 0)
+		r = strcmp(qa->prop_value ? qa->prop_value : "",
+			   qb->prop_value ? qb->prop_value : "");
+	return r;
+}
+
+static void
+write_index(const char *path)
+{
+	struct quirks_index_header hdr;
+	struct quirks_index_entry *entries;
+	char tmp[PATH_MAX];
+	FILE *fp;
+	size_t i;
+
+	/* The empty string lives at offset 0 */
+	strtab = calloc(1, 1);
+	if (strtab == NULL)
+		err(1, "calloc");
+	strtab_len = 1;
+
+	entries = calloc(nquirks ? nquirks : 1, sizeof(*entries));
+	if (entries == NULL)
+		err(1, "calloc");
+
+	for (i = 0; i < nquirks; i++) {
+		entries[i].driver = strtab_add(quirks[i].driver);
+		entries[i].prop_name = strtab_add(quirks[i].prop_name ?
+						  quirks[i].prop_name : "");
+		entries[i].prop_value = strtab_add(quirks[i].prop_value ?
+						   quirks[i].prop_value : "");
+		entries[i].dpi = quirks[i].dpi;
+		entries[i].wheel_click_angle = quirks[i].wheel_click_angle;
+		entries[i].accel_profile = quirks[i].accel_profile;
+	}
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = QUIRKS_INDEX_MAGIC;
+	hdr.version = QUIRKS_INDEX_VERSION;
+	hdr.nentries = nquirks;
+	hdr.strings = sizeof(hdr) + nquirks * sizeof(*entries);
+	hdr.size = hdr.strings + strtab_len;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	fp = fopen(tmp, "w");
+	if (fp == NULL)
+		err(1, "%s", tmp);
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    (nquirks &&
+	     fwrite(entries, sizeof(*entries), nquirks, fp) != nquirks) ||
+	    fwrite(strtab, 1, strtab_len, fp) != strtab_len ||
+	    fclose(fp) != 0)
+		err(1, "%s", tmp);
+	if (rename(tmp, path) != 0)
+		err(1, "%s", path);
+
+	free(entries);
+}
+
+int
+main(int argc, char **argv)
+{
+	size_t i;
+
+	if (argc != 3) {
+		fprintf(stderr, "usage: quirks-compile quirks.txt quirks.idx\n");
+		return 1;
+	}
+
+	parse_file(argv[1]);
+
+	for (i = 0; i < nquirks; i++) {
+		if (quirks[i].driver == NULL)
+			errx(1, "%s:%d: [%s] has no MatchDriver",
+			     argv[1], quirks[i].line, quirks[i].section);
+	}
+
+	qsort(quirks, nquirks, sizeof(*quirks), quirk_cmp);
+
+	for (i = 1; i < nquirks; i++) {
+		if (quirk_cmp(&quirks[i - 1], &quirks[i]) == 0)
+			errx(1, "%s:%d: [%s] matches the same devices as [%s]",
+			     argv[1], quirks[i].line, quirks[i].section,
+			     quirks[i - 1].section);
+	}
+
+	write_index(argv[2]);
+
+	return 0;
+}
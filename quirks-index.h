@@ -0,0 +1,64 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef QUIRKS_INDEX_H
+#define QUIRKS_INDEX_H
+
+#include <stdint.h>
+
+/*
+ * On-disk layout of the compiled quirks database, written by
+ * quirks-compile and mmap'd by quirks.c. Native byte order, the index is
+ * built on the machine it is installed on.
+ *
+ *	struct quirks_index_header
+ *	struct quirks_index_entry[nentries]	sorted, see below
+ *	string table				NUL-terminated strings
+ *
+ * Entries are sorted by driver, then property name, then property value,
+ * all compared with strcmp(). The driver-wide entry of a driver has an
+ * empty property name and so comes first in its group.
+ */
+
+#define QUIRKS_INDEX_MAGIC	0x4c51524b	/* "KRQL" read little-endian */
+#define QUIRKS_INDEX_VERSION	1
+
+struct quirks_index_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nentries;
+	uint32_t strings;	/* offset of the string table */
+	uint32_t size;		/* size of the whole file */
+};
+
+struct quirks_index_entry {
+	/* String table offsets, offset 0 is the empty string */
+	uint32_t driver;
+	uint32_t prop_name;
+	uint32_t prop_value;
+
+	/* Already parsed, 0 if the entry doesn't set it */
+	int32_t dpi;
+	int32_t wheel_click_angle;	/* degrees */
+	uint32_t accel_profile;		/* enum libinput_config_accel_profile */
+};
+
+#endif /* QUIRKS_INDEX_H */
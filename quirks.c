@@ -0,0 +1,252 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+#include "quirks-index.h"
+#include "quirks.h"
+
+struct quirks_db {
+	void *map;
+	size_t size;
+	const struct quirks_index_entry *entries;
+	uint32_t nentries;
+	const char *strings;
+	uint32_t strings_size;
+};
+
+static inline const char *
+quirks_string(const struct quirks_db *db, uint32_t offset)
+{
+	return db->strings + offset;
+}
+
+/* Entries in the order quirks-index.h describes */
+static int
+quirks_entry_cmp(const struct quirks_db *db,
+		 const struct quirks_index_entry *a,
+		 const struct quirks_index_entry *b)
+{
+	int r;
+
+	r = strcmp(quirks_string(db, a->driver), quirks_string(db, b->driver));
+	if (r == 0)
+		r = strcmp(quirks_string(db, a->prop_name),
+			   quirks_string(db, b->prop_name));
+	if (r == 0)
+		r = strcmp(quirks_string(db, a->prop_value),
+			   quirks_string(db, b->prop_value));
+	return r;
+}
+
+/*
+ * Check all offsets and the order once so lookups can trust the index,
+ * the binary search would silently miss entries that are out of order.
+ */
+static bool
+quirks_db_validate(struct quirks_db *db)
+{
+	const struct quirks_index_header *hdr = db->map;
+	const struct quirks_index_entry *e;
+	uint32_t i;
+
+	if (db->size < sizeof(*hdr) ||
+	    hdr->magic != QUIRKS_INDEX_MAGIC ||
+	    hdr->version != QUIRKS_INDEX_VERSION ||
+	    hdr->size != db->size ||
+	    hdr->strings < sizeof(*hdr) ||
+	    hdr->strings >= db->size)
+		return false;
+
+	/* The entries sit between the header and the string table, i.e.
+	 * sizeof(*hdr) + nentries * sizeof(*e) <= strings without
+	 * overflowing the multiplication */
+	if (hdr->nentries > (hdr->strings - sizeof(*hdr)) / sizeof(*e))
+		return false;
+
+	db->entries = (const struct quirks_index_entry *)(hdr + 1);
+	db->nentries = hdr->nentries;
+	db->strings = (const char *)db->map + hdr->strings;
+	db->strings_size = db->size - hdr->strings;
+
+	if (db->strings[0] != '\0' ||
+	    db->strings[db->strings_size - 1] != '\0')
+		return false;
+
+	for (i = 0; i < db->nentries; i++) {
+		e = &db->entries[i];
+		if (e->driver >= db->strings_size ||
+		    e->prop_name >= db->strings_size ||
+		    e->prop_value >= db->strings_size)
+			return false;
+		if (i > 0 && quirks_entry_cmp(db, e - 1, e) > 0)
+			return false;
+	}
+
+	return true;
+}
+
+struct quirks_db *
+quirks_db_open(struct libinput *libinput, const char *path)
+{
+	struct quirks_db *db;
+	struct stat sb;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1) {
+		log_debug(libinput, "no quirks database at %s (%s)\n",
+			  path, strerror(errno));
+		return NULL;
+	}
+
+	db = zalloc(sizeof(*db));
+	if (db == NULL)
+		goto err;
+
+	if (fstat(fd, &sb) != 0 || sb.st_size <= 0 ||
+	    (uintmax_t)sb.st_size > UINT32_MAX)
+		goto invalid;
+
+	db->size = sb.st_size;
+	db->map = mmap(NULL, db->size, PROT_READ, MAP_SHARED, fd, 0);
+	if (db->map == MAP_FAILED) {
+		db->map = NULL;
+		goto invalid;
+	}
+
+	if (!quirks_db_validate(db))
+		goto invalid;
+
+	close(fd);
+
+	log_debug(libinput, "quirks database %s, %u entries\n",
+		  path, db->nentries);
+
+	return db;
+
+invalid:
+	log_error(libinput, "ignoring invalid quirks database %s\n", path);
+err:
+	quirks_db_close(db);
+	close(fd);
+	return NULL;
+}
+
+void
+quirks_db_close(struct quirks_db *db)
+{
+	if (db == NULL)
+		return;
+
+	if (db->map != NULL)
+		munmap(db->map, db->size);
+	free(db);
+}
+
+/*
+ * devattr properties are strings or numbers, quirks-compile stored
+ * numeric match values in decimal so a number is compared the same way.
+ */
+static bool
+quirks_prop_matches(prop_dictionary_t props, const char *name,
+		    const char *value)
+{
+	prop_object_t obj;
+	char buf[24];
+
+	obj = prop_dictionary_get(props, name);
+	if (obj == NULL)
+		return false;
+
+	switch (prop_object_type(obj)) {
+	case PROP_TYPE_STRING:
+		return prop_string_equals_cstring(obj, value);
+	case PROP_TYPE_NUMBER:
+		if (prop_number_unsigned(obj))
+			snprintf(buf, sizeof(buf), "%" PRIu64,
+				 prop_number_unsigned_integer_value(obj));
+		else
+			snprintf(buf, sizeof(buf), "%" PRId64,
+				 prop_number_integer_value(obj));
+		return streq(buf, value);
+	default:
+		return false;
+	}
+}
+
+void
+quirks_db_lookup(const struct quirks_db *db,
+		 const char *driver,
+		 prop_dictionary_t props,
+		 struct device_quirks *quirks)
+{
+	const struct quirks_index_entry *e;
+	uint32_t lo, hi, mid;
+
+	memset(quirks, 0, sizeof(*quirks));
+
+	if (db == NULL || driver == NULL)
+		return;
+
+	/* First entry of the driver's group */
+	lo = 0;
+	hi = db->nentries;
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (strcmp(quirks_string(db, db->entries[mid].driver),
+			   driver) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* The driver-wide entry sorts first, property matches override it */
+	for (e = &db->entries[lo]; e < db->entries + db->nentries; e++) {
+		if (!streq(quirks_string(db, e->driver), driver))
+			break;
+
+		if (e->prop_name != 0 &&
+		    (props == NULL ||
+		     !quirks_prop_matches(props,
+					  quirks_string(db, e->prop_name),
+					  quirks_string(db, e->prop_value))))
+			continue;
+
+		if (e->dpi)
+			quirks->dpi = e->dpi;
+		if (e->wheel_click_angle)
+			quirks->wheel_click_angle = e->wheel_click_angle;
+		if (e->accel_profile)
+			quirks->accel_profile = e->accel_profile;
+	}
+}
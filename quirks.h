@@ -0,0 +1,53 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef QUIRKS_H
+#define QUIRKS_H
+
+#include <devattr.h>
+
+#include "libinput-private.h"
+
+#ifndef LIBINPUT_QUIRKS_FILE
+#define LIBINPUT_QUIRKS_FILE "/usr/local/share/libinput/quirks.idx"
+#endif
+
+struct quirks_db;
+
+/* NULL if the index is missing or unusable, devices get no quirks then */
+struct quirks_db *
+quirks_db_open(struct libinput *libinput, const char *path);
+
+void
+quirks_db_close(struct quirks_db *db);
+
+/*
+ * Fill in the quirks for a device of the given driver. props is the
+ * devattr dictionary of the device, or NULL to only use the driver-wide
+ * entry. Doesn't log or allocate, safe to call from the probe threads.
+ */
+void
+quirks_db_lookup(const struct quirks_db *db,
+		 const char *driver,
+		 prop_dictionary_t props,
+		 struct device_quirks *quirks);
+
+#endif /* QUIRKS_H */
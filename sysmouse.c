@@ -22,10 +22,13 @@
  */
 
 #include <assert.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <stdarg.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include <sys/ioctl.h>
 #include <sys/mouse.h>
 
 #include "libinput.h"
@@ -33,8 +36,7 @@
 #include "filter.h"
 #include "libinput-private.h"
 
-int sysmouse_init_accel(struct libinput_device *device,
-			enum libinput_config_accel_profile which);
+extern void dragonfly_device_lost(struct libinput_device *device);
 
 static int
 sysmouse_accel_config_available(struct libinput_device *device)
@@ -70,7 +72,8 @@ sysmouse_accel_config_get_profiles(struct libinput_device *device)
 		return LIBINPUT_CONFIG_ACCEL_PROFILE_NONE;
 
 	return LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE |
-		LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT;
+		LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT |
+		LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM;
 }
 
 static enum libinput_config_status
@@ -87,8 +90,14 @@ sysmouse_accel_config_set_profile(struct libinput_device *device,
 	speed = filter_get_speed(filter);
 	device->filter = NULL;
 
-	if (sysmouse_init_accel(device, profile) == 0) {
+	if (device->interface->init_accel(device, profile) == 0 &&
+	    device->filter != NULL) {
 		sysmouse_accel_config_set_speed(device, speed);
+		if (device->custom_accel)
+			filter_set_custom_points(device->filter,
+			    device->custom_accel,
+			    device->custom_accel + device->ncustom_accel,
+			    device->ncustom_accel);
 		filter_destroy(filter);
 	} else {
 		device->filter = filter;
@@ -109,10 +118,37 @@ sysmouse_accel_config_get_default_profile(struct libinput_device *device)
 	if (!device->filter)
 		return LIBINPUT_CONFIG_ACCEL_PROFILE_NONE;
 
-	/* No device has a flat profile as default */
+	if (device->quirks.accel_profile)
+		return device->quirks.accel_profile;
+
 	return LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE;
 }
 
+static enum libinput_config_status
+sysmouse_accel_config_set_custom_points(struct libinput_device *device,
+					const double *speeds,
+					const double *factors,
+					size_t npoints)
+{
+	double *points;
+
+	if (!filter_set_custom_points(device->filter, speeds, factors,
+				      npoints))
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	/* Kept for switching back from another profile */
+	points = realloc(device->custom_accel,
+			 2 * npoints * sizeof(*points));
+	if (points) {
+		memcpy(points, speeds, npoints * sizeof(*points));
+		memcpy(points + npoints, factors, npoints * sizeof(*points));
+		device->custom_accel = points;
+		device->ncustom_accel = npoints;
+	}
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
 static struct libinput_device_config_accel sysmouse_accel = {
 	&sysmouse_accel_config_available,
 	&sysmouse_accel_config_set_speed,
@@ -121,11 +157,13 @@ static struct libinput_device_config_accel sysmouse_accel = {
 	&sysmouse_accel_config_get_profiles,
 	&sysmouse_accel_config_set_profile,
 	&sysmouse_accel_config_get_profile,
-	&sysmouse_accel_config_get_default_profile
+	&sysmouse_accel_config_get_default_profile,
+	&sysmouse_accel_config_set_custom_points
 };
 
-static int
-sysmouse_device_init_pointer_acceleration(struct libinput_device *device,
+/* Takes the filter and exposes the accel config, shared with evdev.c */
+int
+device_init_pointer_acceleration(struct libinput_device *device,
 	struct motion_filter *filter)
 {
 	device->filter = filter;
@@ -139,36 +177,210 @@ sysmouse_device_init_pointer_acceleration(struct libinput_device *device,
 	return 0;
 }
 
-int
-sysmouse_init_accel(struct libinput_device *device,
-	enum libinput_config_accel_profile which)
+/* The mouse filter for a profile, shared with evdev.c */
+struct motion_filter *
+pointer_create_accel_filter(enum libinput_config_accel_profile which,
+	int dpi)
 {
 	struct motion_filter *filter;
 
-	/* Just use some constant dpi value for sysmouse */
+#ifdef LIBINPUT_FIXED_ACCEL
+	if (which == LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT)
+		filter = create_pointer_accelerator_filter_flat_fixed(dpi);
+	else if (which == LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM)
+		filter = create_pointer_accelerator_filter_custom(dpi);
+	else
+		filter = create_pointer_accelerator_filter_linear_fixed(dpi);
+#else
 	if (which == LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT)
-		filter = create_pointer_accelerator_filter_flat(100);
+		filter = create_pointer_accelerator_filter_flat(dpi);
+	else if (which == LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM)
+		filter = create_pointer_accelerator_filter_custom(dpi);
 	else
-		filter = create_pointer_accelerator_filter_linear(100);
+		filter = create_pointer_accelerator_filter_linear(dpi);
+#endif
+
+	return filter;
+}
+
+static int
+sysmouse_init_accel(struct libinput_device *device,
+	enum libinput_config_accel_profile which)
+{
+	struct motion_filter *filter;
+	int dpi;
+
+	/* sysmouse doesn't know the sensor resolution, without a quirk
+	 * use a constant low value */
+	dpi = device->quirks.dpi ? device->quirks.dpi : 100;
 
+	filter = pointer_create_accel_filter(which, dpi);
 	if (!filter)
 		return -1;
 
-	return sysmouse_device_init_pointer_acceleration(device, filter);
+	return device_init_pointer_acceleration(device, filter);
+}
+
+#define SYSMOUSE_SCROLL_WINDOW_MAX	1000	/* ms */
+
+/* Tilt wheel, buttons 6 and 7 in the level 1 extension byte */
+#define SYSMOUSE_EXT_TILT_LEFT		(1 << 2)
+#define SYSMOUSE_EXT_TILT_RIGHT		(1 << 3)
+
+static void
+sysmouse_scroll_flush(struct libinput_device *device)
+{
+	struct scroll_coalesce *sc = &device->sysmouse_scroll;
+	struct normalized_coords accel;
+	struct discrete_coords disc;
+	uint32_t axes = 0;
+
+	if (sc->vclicks == 0 && sc->hclicks == 0)
+		return;
+
+	memset(&disc, 0, sizeof(disc));
+	memset(&accel, 0, sizeof(accel));
+
+	if (sc->vclicks != 0) {
+		axes |= AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL);
+		accel.y = device_wheel_degrees(device, sc->vclicks);
+		disc.y = sc->vclicks;
+	}
+	if (sc->hclicks != 0) {
+		axes |= AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL);
+		accel.x = device_wheel_degrees(device, sc->hclicks);
+		disc.x = sc->hclicks;
+	}
+
+	sc->vclicks = 0;
+	sc->hclicks = 0;
+
+	if (sc->timer)
+		libinput_timer_set(device->seat->libinput, sc->timer, 0);
+
+	pointer_notify_axis(device, sc->last, axes,
+	    LIBINPUT_POINTER_AXIS_SOURCE_WHEEL, &accel, &disc);
+}
+
+static void
+sysmouse_scroll_timeout(void *data)
+{
+	struct libinput_device *device = data;
+
+	sysmouse_scroll_flush(device);
+	pointer_notify_frame(device, device->sysmouse_scroll.last);
+}
+
+/*
+ * Merge wheel clicks until the window since the first one has passed or
+ * the direction changes, the totals are sent as one axis event.
+ */
+static void
+sysmouse_scroll(struct libinput_device *device, uint64_t time,
+		int vclicks, int hclicks)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct scroll_coalesce *sc = &device->sysmouse_scroll;
+	bool pending = sc->vclicks != 0 || sc->hclicks != 0;
+
+	if (pending &&
+	    (time - sc->first >= ms2us(sc->window) ||
+	     sc->vclicks * vclicks < 0 || sc->hclicks * hclicks < 0)) {
+		sysmouse_scroll_flush(device);
+		pending = false;
+	}
+
+	sc->vclicks += vclicks;
+	sc->hclicks += hclicks;
+	sc->last = time;
+
+	if (sc->window == 0) {
+		sysmouse_scroll_flush(device);
+		return;
+	}
+
+	if (!pending) {
+		sc->first = time;
+		if (sc->timer == NULL)
+			sc->timer = libinput_add_timer(libinput,
+			    sysmouse_scroll_timeout, device);
+		if (sc->timer == NULL ||
+		    libinput_timer_set(libinput, sc->timer,
+				       ms2us(sc->window)) != 0)
+			sysmouse_scroll_flush(device);
+	}
+}
+
+static enum libinput_config_status
+sysmouse_scroll_config_set_window(struct libinput_device *device,
+				  uint32_t ms)
+{
+	if (ms > SYSMOUSE_SCROLL_WINDOW_MAX)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	sysmouse_scroll_flush(device);
+	device->sysmouse_scroll.window = ms;
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+static uint32_t
+sysmouse_scroll_config_get_window(struct libinput_device *device)
+{
+	return device->sysmouse_scroll.window;
+}
+
+static uint32_t
+sysmouse_scroll_config_get_default_window(struct libinput_device *device)
+{
+	return 0;
+}
+
+static struct libinput_device_config_scroll_coalesce sysmouse_scroll_coalesce = {
+	&sysmouse_scroll_config_set_window,
+	&sysmouse_scroll_config_get_window,
+	&sysmouse_scroll_config_get_default_window
+};
+
+/* Called whenever the device fd is (re)opened, keeps the configuration */
+static int
+sysmouse_device_init(struct libinput_device *device)
+{
+	int level = 1;
+
+	ioctl(device->fd, MOUSE_SETLEVEL, &level);
+
+	/* Button bits are inverted, start with all released */
+	device->sysmouse_oldmask = 7;
+	device->sysmouse_oldextmask = 0x7f;
+	device->config.scroll_coalesce = &sysmouse_scroll_coalesce;
+	device->caps = DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_POINTER);
+
+	return 0;
+}
+
+static void
+sysmouse_device_destroy(struct libinput_device *device)
+{
+	struct scroll_coalesce *sc = &device->sysmouse_scroll;
+
+	if (sc->timer) {
+		libinput_remove_source(device->seat->libinput, sc->timer);
+		sc->timer = NULL;
+	}
+	sc->vclicks = 0;
+	sc->hclicks = 0;
 }
 
 static void
 sysmouse_process(struct libinput_device *device, char *pkt)
 {
-	enum libinput_button_state state;
 	struct normalized_coords unaccel, accel;
-	struct discrete_coords disc;
 	struct device_float_coords raw;
 	struct timespec ts;
 	uint64_t time;
-	int button;
-	int xdelta, ydelta, zdelta;
-	int nm;
+	int xdelta, ydelta, zdelta, tilt;
+	int nm, ext;
 
 	if ((pkt[0] & 0x80) == 0 || (pkt[7] & 0x80) != 0)
 		return;
@@ -181,23 +393,31 @@ sysmouse_process(struct libinput_device *device, char *pkt)
 	clock_gettime(CLOCK_MONOTONIC, &ts);
 	time = ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 
-	if (zdelta != 0) {
-		memset(&disc, 0, sizeof(disc));
-		memset(&accel, 0, sizeof(accel));
-
-		accel.y = zdelta;
-		disc.y = zdelta;
-
-		pointer_notify_axis(device, time,
-		    AS_MASK(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL),
-		    LIBINPUT_POINTER_AXIS_SOURCE_WHEEL, &accel, &disc);
+	/* A tilt click is a press of button 6 or 7, bits are inverted */
+	tilt = 0;
+	ext = pkt[7] & 0x7f;
+	if (ext != device->sysmouse_oldextmask) {
+		if ((ext & SYSMOUSE_EXT_TILT_LEFT) == 0 &&
+		    (device->sysmouse_oldextmask & SYSMOUSE_EXT_TILT_LEFT))
+			tilt--;
+		if ((ext & SYSMOUSE_EXT_TILT_RIGHT) == 0 &&
+		    (device->sysmouse_oldextmask & SYSMOUSE_EXT_TILT_RIGHT))
+			tilt++;
+		device->sysmouse_oldextmask = ext;
 	}
 
-	if (xdelta != 0 || ydelta != 0) {
+	if (zdelta != 0 || tilt != 0)
+		sysmouse_scroll(device, time, zdelta, tilt);
+
+	/* Skip the accelerator if nobody consumes motion events */
+	if ((xdelta != 0 || ydelta != 0) &&
+	    libinput_motion_wanted(device->seat->libinput)) {
 		memset(&raw, 0, sizeof(raw));
 		memset(&unaccel, 0, sizeof(unaccel));
 		memset(&accel, 0, sizeof(accel));
 
+		raw.x = xdelta;
+		raw.y = ydelta;
 		unaccel.x = xdelta;
 		unaccel.y = ydelta;
 
@@ -222,6 +442,9 @@ sysmouse_process(struct libinput_device *device, char *pkt)
 
 	nm = pkt[0] & 7;
 	if (nm != device->sysmouse_oldmask) {
+		/* Scrolling that happened before the click goes first */
+		sysmouse_scroll_flush(device);
+
 		if ((nm & 4) != (device->sysmouse_oldmask & 4)) {
 			pointer_notify_button(device, time, BTN_LEFT,
 			    (nm & 4) ? LIBINPUT_BUTTON_STATE_RELEASED
@@ -239,21 +462,69 @@ sysmouse_process(struct libinput_device *device, char *pkt)
 		}
 		device->sysmouse_oldmask = nm;
 	}
+
+	pointer_notify_frame(device, time);
+}
+
+static void
+sysmouse_release_buttons(struct libinput_device *device, uint64_t time)
+{
+	int nm = device->sysmouse_oldmask;
+
+	sysmouse_scroll_flush(device);
+
+	/* Button bits are inverted, a cleared bit is a pressed button */
+	if ((nm & 4) == 0)
+		pointer_notify_button(device, time, BTN_LEFT,
+		    LIBINPUT_BUTTON_STATE_RELEASED);
+	if ((nm & 2) == 0)
+		pointer_notify_button(device, time, BTN_MIDDLE,
+		    LIBINPUT_BUTTON_STATE_RELEASED);
+	if ((nm & 1) == 0)
+		pointer_notify_button(device, time, BTN_RIGHT,
+		    LIBINPUT_BUTTON_STATE_RELEASED);
+	pointer_notify_frame(device, time);
+
+	device->sysmouse_oldmask = 7;
 }
 
-void
+static void
 sysmouse_device_dispatch(void *data)
 {
 	struct libinput_device *device = data;
 	uint8_t pkts[128];
+	size_t pending;
 	ssize_t len;
 	int count, i;
 
-	len = read(device->fd, pkts, sizeof(pkts));
-	if (len <= 0 || (len % 8) != 0)
-		return;
+	pending = libinput_source_get_pending(device->source);
+
+	/* Drain everything kqueue reported in as few reads as possible */
+	do {
+		len = read(device->fd, pkts, sizeof(pkts));
+		if (len == 0 ||
+		    (len < 0 && errno != EAGAIN && errno != EINTR)) {
+			/* Unplugged, the source would stay readable */
+			dragonfly_device_lost(device);
+			return;
+		}
+		if (len < 0 || (len % 8) != 0)
+			return;
 
-	count = len / 8;
-        for (i = 0; i < count; i++)
-		sysmouse_process(device, &pkts[i*8]);
+		count = len / 8;
+		for (i = 0; i < count; i++)
+			sysmouse_process(device, &pkts[i*8]);
+
+		pending = pending > (size_t)len ? pending - len : 0;
+	} while (len == sizeof(pkts) && pending > 0);
 }
+
+const struct libinput_device_interface sysmouse_interface = {
+	.dispatch = sysmouse_device_dispatch,
+	.init = sysmouse_device_init,
+	.destroy = sysmouse_device_destroy,
+	.suspend = sysmouse_release_buttons,
+	.reset = NULL,
+	.led_update = NULL,
+	.init_accel = sysmouse_init_accel,
+};
@@ -0,0 +1,380 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Stand-in for libdevattr and the bits of proplib the library uses, so
+ * the real backend can be tested without devd. Devices are registered
+ * with a driver, lookups by major/minor use the stat() of the node, so
+ * tests register existing character devices (/dev/null, /dev/zero). The
+ * monitor is a socketpair, fake_devattr_notify() writes to it what devd
+ * would have sent.
+ */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <assert.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <devattr.h>
+
+#define FAKE_MAX_DEVICES	8
+
+struct _prop_string {
+	const char *value;
+};
+
+struct _prop_dictionary {
+	struct _prop_string driver;
+};
+
+struct udev {
+	int refcount;
+};
+
+struct udev_device {
+	char devnode[PATH_MAX];
+	char action[8];
+	dev_t rdev;
+	struct _prop_dictionary dict;
+	bool received;		/* from the monitor, freed on unref */
+};
+
+struct udev_list_entry {
+	struct udev_device *device;
+	struct udev_list_entry *next;
+};
+
+struct udev_enumerate {
+	const char *driver;
+	int major, minor;	/* -1 if not matched on */
+	struct udev_list_entry entries[FAKE_MAX_DEVICES];
+	struct udev_list_entry *first;
+};
+
+struct udev_monitor {
+	int fds[2];
+};
+
+/* A notification as it goes through the monitor socket */
+struct fake_notify {
+	char action[8];
+	char devnode[PATH_MAX];
+};
+
+static struct udev_device devices[FAKE_MAX_DEVICES];
+static int ndevices;
+static struct udev_monitor *monitor;
+
+/* devnode is relative to /dev as devattr reports it, or absolute */
+void
+fake_devattr_add(const char *devnode, const char *driver)
+{
+	struct udev_device *dev;
+	char path[PATH_MAX];
+	struct stat sb;
+	int rc;
+
+	assert(ndevices < FAKE_MAX_DEVICES);
+	dev = &devices[ndevices++];
+
+	snprintf(path, sizeof(path), "%s%s",
+		 devnode[0] == '/' ? "" : "/dev/", devnode);
+	rc = stat(path, &sb);
+	assert(rc == 0);
+
+	snprintf(dev->devnode, sizeof(dev->devnode), "%s", devnode);
+	dev->rdev = sb.st_rdev;
+	dev->dict.driver.value = driver;
+}
+
+/* Send action ("attach" or "detach") for devnode through the monitor */
+void
+fake_devattr_notify(const char *action, const char *devnode)
+{
+	struct fake_notify n;
+	ssize_t len;
+
+	assert(monitor != NULL);
+	memset(&n, 0, sizeof(n));
+	snprintf(n.action, sizeof(n.action), "%s", action);
+	snprintf(n.devnode, sizeof(n.devnode), "%s", devnode);
+	len = write(monitor->fds[1], &n, sizeof(n));
+	assert(len == sizeof(n));
+}
+
+struct udev *
+udev_new(void)
+{
+	struct udev *udev;
+
+	udev = calloc(1, sizeof(*udev));
+	if (udev != NULL)
+		udev->refcount = 1;
+
+	return udev;
+}
+
+struct udev *
+udev_ref(struct udev *udev)
+{
+	udev->refcount++;
+	return udev;
+}
+
+void
+udev_unref(struct udev *udev)
+{
+	if (udev != NULL && --udev->refcount == 0)
+		free(udev);
+}
+
+struct udev_enumerate *
+udev_enumerate_new(struct udev *udev)
+{
+	struct udev_enumerate *enumerate;
+
+	enumerate = calloc(1, sizeof(*enumerate));
+	if (enumerate == NULL)
+		return NULL;
+	enumerate->major = -1;
+	enumerate->minor = -1;
+
+	return enumerate;
+}
+
+void
+udev_enumerate_unref(struct udev_enumerate *enumerate)
+{
+	free(enumerate);
+}
+
+int
+udev_enumerate_add_match_expr(struct udev_enumerate *enumerate,
+			      const char *key, char *expr)
+{
+	if (strcmp(key, "driver") == 0)
+		enumerate->driver = expr;
+	else if (strcmp(key, "major") == 0)
+		enumerate->major = atoi(expr);
+	else if (strcmp(key, "minor") == 0)
+		enumerate->minor = atoi(expr);
+	else
+		return -1;
+
+	return 0;
+}
+
+int
+udev_enumerate_scan_devices(struct udev_enumerate *enumerate)
+{
+	struct udev_list_entry **prev = &enumerate->first;
+	struct udev_device *dev;
+	int i;
+
+	for (i = 0; i < ndevices; i++) {
+		dev = &devices[i];
+		if (enumerate->driver != NULL &&
+		    strcmp(enumerate->driver, dev->dict.driver.value) != 0)
+			continue;
+		if (enumerate->major != -1 &&
+		    enumerate->major != (int)major(dev->rdev))
+			continue;
+		if (enumerate->minor != -1 &&
+		    enumerate->minor != (int)minor(dev->rdev))
+			continue;
+		enumerate->entries[i].device = dev;
+		*prev = &enumerate->entries[i];
+		prev = &enumerate->entries[i].next;
+	}
+
+	return 0;
+}
+
+struct udev_list_entry *
+udev_enumerate_get_list_entry(struct udev_enumerate *enumerate)
+{
+	return enumerate->first;
+}
+
+struct udev_list_entry *
+udev_list_entry_get_next(struct udev_list_entry *entry)
+{
+	return entry->next;
+}
+
+struct udev_device *
+udev_list_entry_get_device(struct udev_list_entry *entry)
+{
+	return entry->device;
+}
+
+prop_dictionary_t
+udev_device_get_dictionary(struct udev_device *dev)
+{
+	return &dev->dict;
+}
+
+const char *
+udev_device_get_action(struct udev_device *dev)
+{
+	return dev->action[0] != '\0' ? dev->action : NULL;
+}
+
+const char *
+udev_device_get_devnode(struct udev_device *dev)
+{
+	return dev->devnode;
+}
+
+void
+udev_device_unref(struct udev_device *dev)
+{
+	if (dev->received)
+		free(dev);
+}
+
+struct udev_monitor *
+udev_monitor_new(struct udev *udev)
+{
+	assert(monitor == NULL);
+	monitor = calloc(1, sizeof(*monitor));
+	if (monitor == NULL)
+		return NULL;
+	if (socketpair(AF_UNIX, SOCK_DGRAM, 0, monitor->fds) != 0) {
+		free(monitor);
+		monitor = NULL;
+	}
+
+	return monitor;
+}
+
+void
+udev_monitor_unref(struct udev_monitor *mon)
+{
+	close(mon->fds[0]);
+	close(mon->fds[1]);
+	free(mon);
+	monitor = NULL;
+}
+
+int
+udev_monitor_filter_add_match_expr(struct udev_monitor *mon,
+				   const char *key, char *expr)
+{
+	return 0;
+}
+
+int
+udev_monitor_enable_receiving(struct udev_monitor *mon)
+{
+	return 0;
+}
+
+int
+udev_monitor_get_fd(struct udev_monitor *mon)
+{
+	return mon->fds[0];
+}
+
+struct udev_device *
+udev_monitor_receive_device(struct udev_monitor *mon)
+{
+	struct udev_device *dev;
+	struct fake_notify n;
+	int i;
+
+	if (read(mon->fds[0], &n, sizeof(n)) != sizeof(n))
+		return NULL;
+
+	dev = calloc(1, sizeof(*dev));
+	if (dev == NULL)
+		return NULL;
+	dev->received = true;
+	memcpy(dev->action, n.action, sizeof(dev->action));
+	memcpy(dev->devnode, n.devnode, sizeof(dev->devnode));
+	for (i = 0; i < ndevices; i++) {
+		if (strcmp(devices[i].devnode, n.devnode) == 0)
+			dev->dict = devices[i].dict;
+	}
+
+	return dev;
+}
+
+prop_object_t
+prop_dictionary_get(prop_dictionary_t dict, const char *key)
+{
+	if (dict == NULL || strcmp(key, "driver") != 0 ||
+	    dict->driver.value == NULL)
+		return NULL;
+
+	return &dict->driver;
+}
+
+prop_type_t
+prop_object_type(prop_object_t obj)
+{
+	return PROP_TYPE_STRING;
+}
+
+void
+prop_object_retain(prop_object_t obj)
+{
+}
+
+void
+prop_object_release(prop_object_t obj)
+{
+}
+
+char *
+prop_string_cstring(prop_string_t str)
+{
+	return str != NULL ? strdup(str->value) : NULL;
+}
+
+bool
+prop_string_equals_cstring(prop_string_t str, const char *value)
+{
+	return strcmp(str->value, value) == 0;
+}
+
+bool
+prop_number_unsigned(prop_number_t num)
+{
+	return true;
+}
+
+uint64_t
+prop_number_unsigned_integer_value(prop_number_t num)
+{
+	return 0;
+}
+
+int64_t
+prop_number_integer_value(prop_number_t num)
+{
+	return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Minimal backend for the tests: a context without udev, one seat and
+ * devices that only exist in memory. Tests post events through the
+ * notify functions and read them back through the public API.
+ */
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+extern void	libinput_seat_init(struct libinput_seat *seat,
+		    struct libinput *libinput, const char *physical_name,
+		    const char *logical_name);
+
+/* The dragonfly backend is not linked in */
+void
+dragonfly_libinput_destroy(struct libinput *libinput)
+{
+}
+
+int
+dragonfly_libinput_resume(struct libinput *libinput)
+{
+	return 0;
+}
+
+void
+dragonfly_libinput_suspend(struct libinput *libinput)
+{
+}
+
+static int
+test_open_restricted(const char *path, int flags, void *user_data)
+{
+	return -1;
+}
+
+static void
+test_close_restricted(int fd, void *user_data)
+{
+}
+
+static const struct libinput_interface test_interface = {
+	.open_restricted = test_open_restricted,
+	.close_restricted = test_close_restricted,
+};
+
+struct libinput *
+test_create_context(enum libinput_event_queue_mode mode)
+{
+	struct libinput *libinput;
+	int rc;
+
+	libinput = zalloc(sizeof(*libinput));
+	assert(libinput != NULL);
+	rc = libinput_init(libinput, &test_interface, NULL);
+	assert(rc == 0);
+	rc = libinput_set_event_queue_mode(libinput, mode);
+	assert(rc == 0);
+
+	return libinput;
+}
+
+/* Caps are DEVICE_CAP_BIT()s, the device is on the context's only seat */
+struct libinput_device *
+test_add_device(struct libinput *libinput, uint32_t caps)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+
+	if (list_empty(&libinput->seat_list)) {
+		seat = zalloc(sizeof(*seat));
+		assert(seat != NULL);
+		libinput_seat_init(seat, libinput, "seat0", "default");
+	} else {
+		seat = container_of(libinput->seat_list.next, seat, link);
+		libinput_seat_ref(seat);
+	}
+
+	device = zalloc(sizeof(*device));
+	assert(device != NULL);
+	libinput_device_init(device, seat);
+	device->devname = "test";
+	device->caps = caps;
+	device->fd = -1;
+	list_insert(&seat->devices_list, &device->link);
+
+	return device;
+}
+
+/* Drop the backend's reference, the device goes once its events did */
+void
+test_remove_device(struct libinput_device *device)
+{
+	device->removed = true;
+	libinput_device_unref(device);
+}
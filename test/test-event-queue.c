@@ -0,0 +1,165 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The per-seat event queue is a single producer, single consumer ring.
+ * One thread posts key events as the dispatching thread would, another
+ * takes them off the seat queue, sleeping on the seat fd when it runs
+ * dry. Every event has to arrive once and in order.
+ *
+ * Both threads also log into the deferred log queue, the consumer through
+ * the client bug of asking a key event for its pointer event. No message
+ * may get lost or mixed up.
+ */
+
+#include <assert.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+#define NEVENTS		1000000
+/* Below the queue size, so the producer never has an event dropped */
+#define MAX_IN_FLIGHT	256
+/* Each thread logs once per this many events, the main thread flushes */
+#define LOG_INTERVAL	1000
+
+extern struct libinput *test_create_context(enum libinput_event_queue_mode mode);
+extern struct libinput_device *test_add_device(struct libinput *libinput,
+					       uint32_t caps);
+extern void test_remove_device(struct libinput_device *device);
+
+static uint32_t consumed;
+static int nbugs, nposted;
+
+static void
+count_handler(struct libinput *libinput, enum libinput_log_priority priority,
+	      const char *format, va_list args)
+{
+	char line[128];
+
+	vsnprintf(line, sizeof(line), format, args);
+	if (strstr(line, "client bug: ") == line)
+		nbugs++;
+	else if (strncmp(line, "posted ", 7) == 0)
+		nposted++;
+	else
+		assert(!"unexpected log message");
+}
+
+static void *
+consumer(void *data)
+{
+	struct libinput_seat *seat = data;
+	struct libinput_event *event;
+	struct libinput_event_keyboard *kev;
+	struct pollfd fds;
+	uint64_t expected = 1;
+	int n;
+
+	fds.fd = libinput_seat_get_fd(seat);
+	fds.events = POLLIN;
+	assert(fds.fd != -1);
+
+	while (expected <= NEVENTS) {
+		event = libinput_seat_get_event(seat);
+		if (event == NULL) {
+			n = poll(&fds, 1, -1);
+			assert(n == 1);
+			continue;
+		}
+
+		assert(libinput_event_get_type(event) ==
+		       LIBINPUT_EVENT_KEYBOARD_KEY);
+		kev = libinput_event_get_keyboard_event(event);
+		assert(libinput_event_keyboard_get_time_usec(kev) == expected);
+		if (expected % LOG_INTERVAL == 0)
+			assert(libinput_event_get_pointer_event(event) == NULL);
+		expected++;
+
+		libinput_event_destroy(event);
+		__atomic_add_fetch(&consumed, 1, __ATOMIC_RELEASE);
+	}
+
+	/* Nothing beyond what was posted */
+	event = libinput_seat_get_event(seat);
+	assert(event == NULL);
+
+	return NULL;
+}
+
+int
+main(void)
+{
+	struct libinput *libinput;
+	struct libinput_device *device;
+	struct libinput_event *event;
+	pthread_t thread;
+	uint64_t t;
+	int rc;
+
+	libinput = test_create_context(LIBINPUT_EVENT_QUEUE_SEAT);
+	device = test_add_device(libinput,
+				 DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_KEYBOARD));
+	libinput_log_set_handler(libinput, count_handler);
+	rc = libinput_log_set_mode(libinput, LIBINPUT_LOG_MODE_DEFERRED);
+	assert(rc == 0);
+
+	/* Nothing goes to the context queue in this mode */
+	event = libinput_get_event(libinput);
+	assert(event == NULL);
+
+	rc = pthread_create(&thread, NULL, consumer, device->seat);
+	assert(rc == 0);
+
+	for (t = 1; t <= NEVENTS; t++) {
+		while (t - 1 - __atomic_load_n(&consumed, __ATOMIC_ACQUIRE) >=
+		       MAX_IN_FLIGHT)
+			sched_yield();
+		keyboard_notify_key(device, t, 30, t & 1 ?
+				    LIBINPUT_KEY_STATE_PRESSED :
+				    LIBINPUT_KEY_STATE_RELEASED);
+		if (t % LOG_INTERVAL == 0) {
+			log_error(libinput, "posted %u\n", (unsigned int)t);
+			libinput_log_flush(libinput);
+		}
+	}
+
+	rc = pthread_join(thread, NULL);
+	assert(rc == 0);
+
+	libinput_log_flush(libinput);
+	assert(nbugs == NEVENTS / LOG_INTERVAL);
+	assert(nposted == NEVENTS / LOG_INTERVAL);
+
+	test_remove_device(device);
+	libinput_unref(libinput);
+
+	printf("event queue: %d events in order, %d messages logged\n",
+	       NEVENTS, nbugs + nposted);
+
+	return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The Q16.16 filters in filter-fixed.c have to follow their floating
+ * point counterparts. Feed both the same random motion, with pauses
+ * that reset the velocity, and compare the output.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libinput-util.h"
+#include "filter.h"
+
+#define NEVENTS		100000
+/* Relative error of the accelerated motion */
+#define MAX_ERROR	1e-3
+
+typedef struct motion_filter *(*create_filter_t)(int dpi);
+
+static double
+compare(create_filter_t create, create_filter_t create_fixed,
+	int dpi, double speed)
+{
+	struct motion_filter *filter, *fixed;
+	struct normalized_coords in, out, out_fixed;
+	uint64_t time = 1000000;
+	double err, len, max_err = 0.0;
+	bool set, set_fixed;
+	int i;
+
+	filter = create(dpi);
+	fixed = create_fixed(dpi);
+	assert(filter != NULL && fixed != NULL);
+	assert(filter_get_type(filter) == filter_get_type(fixed));
+
+	set = filter_set_speed(filter, speed);
+	set_fixed = filter_set_speed(fixed, speed);
+	assert(set && set_fixed);
+	assert(filter_get_speed(fixed) == speed);
+
+	srand(dpi);
+	for (i = 0; i < NEVENTS; i++) {
+		/* 125Hz, with a pause now and then */
+		time += i % 500 < 10 ? 2000000 : 8000;
+		in.x = (rand() % 200 - 100) / 10.0;
+		in.y = (rand() % 200 - 100) / 10.0;
+
+		out = filter_dispatch(filter, &in, NULL, time);
+		out_fixed = filter_dispatch(fixed, &in, NULL, time);
+
+		/* Sub-unit motion is lost to rounding either way */
+		len = hypot(out.x, out.y);
+		if (len < 0.5)
+			continue;
+		err = hypot(out.x - out_fixed.x, out.y - out_fixed.y) / len;
+		max_err = max(max_err, err);
+	}
+
+	filter_destroy(filter);
+	filter_destroy(fixed);
+
+	return max_err;
+}
+
+int
+main(void)
+{
+	static const int dpis[] = { 400, 1000, 1600 };
+	static const double speeds[] = { -1.0, -0.5, 0.0, 0.3, 1.0 };
+	double err, max_linear = 0.0, max_flat = 0.0;
+	size_t d, s;
+
+	for (d = 0; d < ARRAY_LENGTH(dpis); d++) {
+		for (s = 0; s < ARRAY_LENGTH(speeds); s++) {
+			err = compare(create_pointer_accelerator_filter_linear,
+				create_pointer_accelerator_filter_linear_fixed,
+				dpis[d], speeds[s]);
+			max_linear = max(max_linear, err);
+
+			err = compare(create_pointer_accelerator_filter_flat,
+				create_pointer_accelerator_filter_flat_fixed,
+				dpis[d], speeds[s]);
+			max_flat = max(max_flat, err);
+		}
+	}
+
+	printf("fixed filters: max error linear %g, flat %g\n",
+	       max_linear, max_flat);
+	assert(max_linear < MAX_ERROR);
+	assert(max_flat < MAX_ERROR);
+
+	return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * The gesture recognizer keeps running sums over the fingers instead of
+ * walking them every frame. Check the sums against a recount after
+ * random contact changes, then run a swipe and a pinch through to the
+ * events they post.
+ */
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+#include "gesture.h"
+
+extern struct libinput *test_create_context(enum libinput_event_queue_mode mode);
+extern struct libinput_device *test_add_device(struct libinput *libinput,
+					       uint32_t caps);
+extern void test_remove_device(struct libinput_device *device);
+
+/* 40 units/mm, the gesture threshold is 3mm or 120 units */
+static const struct device_abs pad = {
+	.max_x = 4000, .res_x = 40,
+	.max_y = 3000, .res_y = 40,
+};
+
+static void
+check_sums(const struct gesture *g)
+{
+	int64_t sum_x = 0, sum_y = 0, sum_sq = 0;
+	int i, n = 0;
+
+	for (i = 0; i < GESTURE_MAX_CONTACTS; i++) {
+		if (!g->contacts[i].down)
+			continue;
+		sum_x += g->contacts[i].x;
+		sum_y += g->contacts[i].y;
+		sum_sq += (int64_t)g->contacts[i].x * g->contacts[i].x +
+			  (int64_t)g->contacts[i].y * g->contacts[i].y;
+		n++;
+	}
+
+	assert(g->ncontacts == n);
+	assert(g->sum_x == sum_x);
+	assert(g->sum_y == sum_y);
+	assert(g->sum_sq == sum_sq);
+}
+
+static void
+test_sums(void)
+{
+	struct gesture g;
+	struct device_coords p;
+	int i, contact;
+
+	gesture_init(&g, &pad);
+	srand(1);
+
+	/* Full 16 bit positions, as pipe devices report them */
+	for (i = 0; i < 100000; i++) {
+		contact = rand() % GESTURE_MAX_CONTACTS;
+		p.x = rand() % 0x10000;
+		p.y = rand() % 0x10000;
+
+		switch (rand() % 3) {
+		case 0:
+			gesture_contact_down(&g, contact, &p);
+			break;
+		case 1:
+			gesture_contact_move(&g, contact, &p);
+			break;
+		case 2:
+			gesture_contact_up(&g, contact);
+			break;
+		}
+		check_sums(&g);
+	}
+}
+
+static struct libinput_event_gesture *
+next_gesture(struct libinput *libinput, enum libinput_event_type type)
+{
+	struct libinput_event *event;
+
+	event = libinput_get_event(libinput);
+	assert(event != NULL);
+	assert(libinput_event_get_type(event) == type);
+
+	return libinput_event_get_gesture_event(event);
+}
+
+static void
+test_swipe(struct libinput *libinput, struct libinput_device *device)
+{
+	struct libinput_event *event;
+	struct libinput_event_gesture *gev;
+	struct gesture g;
+	struct device_coords p;
+	double dy = 0.0, norm = 1000.0 / 25.4 / pad.res_y;
+	int i, f;
+
+	gesture_init(&g, &pad);
+	for (i = 0; i < 3; i++) {
+		p.x = 1000 + i * 300;
+		p.y = 1000;
+		gesture_contact_down(&g, i, &p);
+	}
+	gesture_frame(device, &g, 0);
+
+	/* 50 units a frame, past the threshold on the third */
+	for (f = 1; f <= 8; f++) {
+		for (i = 0; i < 3; i++) {
+			p.x = 1000 + i * 300;
+			p.y = 1000 + f * 50;
+			gesture_contact_move(&g, i, &p);
+		}
+		gesture_frame(device, &g, f);
+	}
+
+	gev = next_gesture(libinput, LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN);
+	assert(libinput_event_gesture_get_finger_count(gev) == 3);
+	libinput_event_destroy(libinput_event_gesture_get_base_event(gev));
+
+	for (f = 4; f <= 8; f++) {
+		gev = next_gesture(libinput,
+				   LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE);
+		assert(libinput_event_gesture_get_finger_count(gev) == 3);
+		assert(libinput_event_gesture_get_dx_unaccelerated(gev) == 0.0);
+		dy += libinput_event_gesture_get_dy_unaccelerated(gev);
+		libinput_event_destroy(libinput_event_gesture_get_base_event(gev));
+	}
+	assert(fabs(dy - 5 * 50 * norm) < 1e-9);
+
+	/* A fourth finger cancels it */
+	p.x = 500;
+	p.y = 500;
+	gesture_contact_down(&g, 3, &p);
+	gesture_frame(device, &g, 9);
+	gev = next_gesture(libinput, LIBINPUT_EVENT_GESTURE_SWIPE_END);
+	assert(libinput_event_gesture_get_cancelled(gev));
+	libinput_event_destroy(libinput_event_gesture_get_base_event(gev));
+
+	for (i = 0; i < 4; i++)
+		gesture_contact_up(&g, i);
+	gesture_frame(device, &g, 10);
+	event = libinput_get_event(libinput);
+	assert(event == NULL);
+}
+
+static void
+test_pinch(struct libinput *libinput, struct libinput_device *device)
+{
+	struct libinput_event *event;
+	struct libinput_event_gesture *gev;
+	struct gesture g;
+	struct device_coords p;
+	double scale = 0.0;
+	int f;
+
+	gesture_init(&g, &pad);
+	p.y = 1500;
+	p.x = 1500;
+	gesture_contact_down(&g, 0, &p);
+	p.x = 2500;
+	gesture_contact_down(&g, 1, &p);
+	gesture_frame(device, &g, 0);
+
+	/* Spread 500, 60 more a frame, past the threshold on the third */
+	for (f = 1; f <= 6; f++) {
+		p.x = 1500 - f * 60;
+		gesture_contact_move(&g, 0, &p);
+		p.x = 2500 + f * 60;
+		gesture_contact_move(&g, 1, &p);
+		gesture_frame(device, &g, f);
+	}
+
+	gev = next_gesture(libinput, LIBINPUT_EVENT_GESTURE_PINCH_BEGIN);
+	assert(libinput_event_gesture_get_finger_count(gev) == 2);
+	assert(libinput_event_gesture_get_scale(gev) == 1.0);
+	libinput_event_destroy(libinput_event_gesture_get_base_event(gev));
+
+	for (f = 4; f <= 6; f++) {
+		gev = next_gesture(libinput,
+				   LIBINPUT_EVENT_GESTURE_PINCH_UPDATE);
+		/* Symmetric, the centroid and the angle stay put */
+		assert(libinput_event_gesture_get_dx_unaccelerated(gev) == 0.0);
+		assert(libinput_event_gesture_get_angle_delta(gev) == 0.0);
+		assert(libinput_event_gesture_get_scale(gev) > scale);
+		scale = libinput_event_gesture_get_scale(gev);
+		libinput_event_destroy(libinput_event_gesture_get_base_event(gev));
+	}
+	/* Relative to the spread when it became a pinch */
+	assert(fabs(scale - (500.0 + 6 * 60) / (500.0 + 3 * 60)) < 1e-9);
+
+	/* Down to one finger ends it normally */
+	gesture_contact_up(&g, 1);
+	gesture_frame(device, &g, 7);
+	gev = next_gesture(libinput, LIBINPUT_EVENT_GESTURE_PINCH_END);
+	assert(!libinput_event_gesture_get_cancelled(gev));
+	assert(libinput_event_gesture_get_scale(gev) == scale);
+	libinput_event_destroy(libinput_event_gesture_get_base_event(gev));
+
+	gesture_contact_up(&g, 0);
+	gesture_frame(device, &g, 8);
+	event = libinput_get_event(libinput);
+	assert(event == NULL);
+}
+
+/* As on suspend, the swipe is cancelled before the fingers are lifted */
+static void
+test_cancel(struct libinput *libinput, struct libinput_device *device)
+{
+	struct libinput_event *event;
+	struct libinput_event_gesture *gev;
+	struct gesture g;
+	struct device_coords p;
+	int i, f;
+
+	gesture_init(&g, &pad);
+	for (i = 0; i < 2; i++) {
+		p.x = 1000 + i * 300;
+		p.y = 1000;
+		gesture_contact_down(&g, i, &p);
+	}
+	gesture_frame(device, &g, 0);
+
+	for (f = 1; f <= 4; f++) {
+		for (i = 0; i < 2; i++) {
+			p.x = 1000 + i * 300;
+			p.y = 1000 + f * 50;
+			gesture_contact_move(&g, i, &p);
+		}
+		gesture_frame(device, &g, f);
+	}
+
+	gev = next_gesture(libinput, LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN);
+	libinput_event_destroy(libinput_event_gesture_get_base_event(gev));
+	gev = next_gesture(libinput, LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE);
+	libinput_event_destroy(libinput_event_gesture_get_base_event(gev));
+
+	gesture_cancel(device, &g, 5);
+	for (i = 0; i < 2; i++)
+		gesture_contact_up(&g, i);
+	gesture_frame(device, &g, 5);
+
+	gev = next_gesture(libinput, LIBINPUT_EVENT_GESTURE_SWIPE_END);
+	assert(libinput_event_gesture_get_finger_count(gev) == 2);
+	assert(libinput_event_gesture_get_cancelled(gev));
+	libinput_event_destroy(libinput_event_gesture_get_base_event(gev));
+	event = libinput_get_event(libinput);
+	assert(event == NULL);
+}
+
+int
+main(void)
+{
+	struct libinput *libinput;
+	struct libinput_device *device;
+
+	test_sums();
+
+	libinput = test_create_context(LIBINPUT_EVENT_QUEUE_CONTEXT);
+	device = test_add_device(libinput,
+				 DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_POINTER) |
+				 DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_GESTURE));
+
+	test_swipe(libinput, device);
+	test_pinch(libinput, device);
+	test_cancel(libinput, device);
+
+	test_remove_device(device);
+	libinput_unref(libinput);
+
+	printf("gesture: sums, swipe, pinch and cancel\n");
+
+	return 0;
+}
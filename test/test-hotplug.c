@@ -0,0 +1,187 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Hotplug through the devattr monitor. test/fake-devattr.c plays devd:
+ * the nodes it knows are found by the scan on libinput_udev_assign_seat(),
+ * later ones come and go through notifications on its monitor socket.
+ * Every node opens as a pipe, read as a sysmouse. A node that fails to
+ * reopen on resume is removed as if it was detached.
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+extern void	fake_devattr_add(const char *devnode, const char *driver);
+extern void	fake_devattr_notify(const char *action, const char *devnode);
+
+/* Path that open_restricted fails on */
+static const char *unopenable;
+
+static int
+test_open_restricted(const char *path, int flags, void *user_data)
+{
+	int fds[2], rc;
+
+	if (unopenable != NULL && streq(path, unopenable))
+		return -ENODEV;
+
+	rc = pipe(fds);
+	assert(rc == 0);
+	rc = fcntl(fds[0], F_SETFL, O_NONBLOCK);
+	assert(rc == 0);
+	/* Never written, but kept open: at EOF the device would be lost */
+	return fds[0];
+}
+
+static void
+test_close_restricted(int fd, void *user_data)
+{
+	close(fd);
+}
+
+static const struct libinput_interface test_interface = {
+	.open_restricted = test_open_restricted,
+	.close_restricted = test_close_restricted,
+};
+
+/* Returns the device of the next event, which must be of the given type */
+static struct libinput_device *
+expect_device(struct libinput *libinput, enum libinput_event_type type,
+	      const char *path)
+{
+	struct libinput_event *event;
+	struct libinput_device *device;
+
+	event = libinput_get_event(libinput);
+	assert(event != NULL);
+	assert(libinput_event_get_type(event) == type);
+	device = libinput_event_get_device(event);
+	assert(streq(device->devname, path));
+	libinput_event_destroy(event);
+
+	return device;
+}
+
+/* The monitor is read one notification per libinput_dispatch() */
+static void
+notify(struct libinput *libinput, const char *action, const char *devnode)
+{
+	int rc;
+
+	fake_devattr_notify(action, devnode);
+	rc = libinput_dispatch(libinput);
+	assert(rc == 0);
+}
+
+static void
+expect_none(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
+	event = libinput_get_event(libinput);
+	assert(event == NULL);
+}
+
+int
+main(void)
+{
+	struct libinput *libinput;
+	struct libinput_device *null, *zero;
+	struct udev *udev;
+	int fd, rc;
+
+	/* Keep the controlling tty, and its keyboard, out of the seat */
+	fd = open("/dev/null", O_RDONLY);
+	assert(fd != -1);
+	rc = dup2(fd, STDIN_FILENO);
+	assert(rc == STDIN_FILENO);
+	close(fd);
+
+	/* devattr reports nodes relative to /dev */
+	fake_devattr_add("null", "sysmouse");
+
+	udev = udev_new();
+	assert(udev != NULL);
+	libinput = libinput_udev_create_context(&test_interface, NULL, udev);
+	assert(libinput != NULL);
+	udev_unref(udev);
+
+	/* Found by the scan */
+	rc = libinput_udev_assign_seat(libinput, "seat0");
+	assert(rc == 0);
+	null = expect_device(libinput, LIBINPUT_EVENT_DEVICE_ADDED,
+			     "/dev/null");
+	assert(libinput_device_has_capability(null,
+					      LIBINPUT_DEVICE_CAP_POINTER));
+	expect_none(libinput);
+
+	/* Attached later */
+	fake_devattr_add("zero", "sysmouse");
+	notify(libinput, "attach", "zero");
+	zero = expect_device(libinput, LIBINPUT_EVENT_DEVICE_ADDED,
+			     "/dev/zero");
+	assert(zero != null);
+	expect_none(libinput);
+
+	/* Known nodes and unknown ones are ignored */
+	notify(libinput, "attach", "null");
+	notify(libinput, "detach", "random");
+	expect_none(libinput);
+
+	notify(libinput, "detach", "null");
+	expect_device(libinput, LIBINPUT_EVENT_DEVICE_REMOVED, "/dev/null");
+	expect_none(libinput);
+
+	/* Gone, so attaching it again adds it again */
+	notify(libinput, "attach", "null");
+	null = expect_device(libinput, LIBINPUT_EVENT_DEVICE_ADDED,
+			     "/dev/null");
+	expect_none(libinput);
+
+	/* Gone while suspended */
+	libinput_suspend(libinput);
+	unopenable = "/dev/zero";
+	rc = libinput_resume(libinput);
+	assert(rc == 0);
+	expect_device(libinput, LIBINPUT_EVENT_DEVICE_REMOVED, "/dev/zero");
+	expect_none(libinput);
+	unopenable = NULL;
+
+	notify(libinput, "detach", "zero");
+	notify(libinput, "detach", "null");
+	expect_device(libinput, LIBINPUT_EVENT_DEVICE_REMOVED, "/dev/null");
+	expect_none(libinput);
+
+	libinput_unref(libinput);
+
+	printf("hotplug: scan, attach, detach and resume\n");
+
+	return 0;
+}
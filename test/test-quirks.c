@@ -0,0 +1,254 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Lookups in a compiled quirks index, and that quirks_db_open() refuses
+ * an index whose header or offsets don't add up.
+ *
+ * usage: test-quirks test-quirks.idx
+ *
+ * The index is test/quirks-test.txt compiled with quirks-compile.
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+#include "quirks.h"
+#include "quirks-index.h"
+
+extern struct libinput *test_create_context(enum libinput_event_queue_mode mode);
+
+static void
+lookup(const struct quirks_db *db, const char *driver,
+       prop_dictionary_t props, int dpi, int angle,
+       enum libinput_config_accel_profile profile)
+{
+	struct device_quirks q;
+
+	quirks_db_lookup(db, driver, props, &q);
+	assert(q.dpi == dpi);
+	assert(q.wheel_click_angle == angle);
+	assert(q.accel_profile == profile);
+}
+
+static void
+test_lookup(struct libinput *libinput, const char *path)
+{
+	struct quirks_db *db;
+	prop_dictionary_t props;
+	bool set;
+
+	db = quirks_db_open(libinput, path);
+	assert(db != NULL);
+
+	/* Driver-wide */
+	lookup(db, "sysmouse", NULL, 400, 15, 0);
+	lookup(db, "kbdmux", NULL, 0, 20, 0);
+	/* Unknown drivers, before and after every entry */
+	lookup(db, "atkbd", NULL, 0, 0, 0);
+	lookup(db, "zz", NULL, 0, 0, 0);
+	lookup(db, "evdev", NULL, 0, 0, 0);
+
+	props = prop_dictionary_create();
+	assert(props != NULL);
+
+	/* A property match overrides what it sets, the rest stays */
+	set = prop_dictionary_set_cstring(props, "model", "G502");
+	assert(set);
+	lookup(db, "sysmouse", props, 1600, 15,
+	       LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT);
+	set = prop_dictionary_set_cstring(props, "model", "G503");
+	assert(set);
+	lookup(db, "sysmouse", props, 400, 15, 0);
+
+	/* Numbers compare by value, the index has it in decimal */
+	set = prop_dictionary_set_uint32(props, "vendor", 0x046d);
+	assert(set);
+	lookup(db, "evdev", props, 800, 0, 0);
+	set = prop_dictionary_set_uint32(props, "vendor", 0x046e);
+	assert(set);
+	lookup(db, "evdev", props, 0, 0, 0);
+	set = prop_dictionary_set_cstring(props, "vendor", "1133");
+	assert(set);
+	lookup(db, "evdev", props, 800, 0, 0);
+
+	prop_object_release(props);
+	quirks_db_close(db);
+}
+
+static size_t
+read_file(const char *path, char *buf, size_t size)
+{
+	ssize_t len;
+	int fd;
+
+	fd = open(path, O_RDONLY);
+	assert(fd != -1);
+	len = read(fd, buf, size);
+	assert(len > 0 && (size_t)len < size);
+	close(fd);
+
+	return len;
+}
+
+/* Write a damaged copy of the index and try to open it */
+static void
+open_damaged(struct libinput *libinput, const char *data, size_t size,
+	     void (*damage)(char *data, size_t *size))
+{
+	char path[] = "/tmp/test-quirks.XXXXXX";
+	struct quirks_db *db;
+	char *copy;
+	ssize_t len;
+	int fd;
+
+	copy = malloc(size);
+	assert(copy != NULL);
+	memcpy(copy, data, size);
+	damage(copy, &size);
+
+	fd = mkstemp(path);
+	assert(fd != -1);
+	len = write(fd, copy, size);
+	assert(len == (ssize_t)size);
+	close(fd);
+
+	db = quirks_db_open(libinput, path);
+	assert(db == NULL);
+
+	unlink(path);
+	free(copy);
+}
+
+static void
+damage_truncate(char *data, size_t *size)
+{
+	*size -= 1;
+}
+
+static void
+damage_magic(char *data, size_t *size)
+{
+	((struct quirks_index_header *)data)->magic ^= 1;
+}
+
+/*
+ * Inside the header, the entry check used to underflow on this. Byte 5
+ * is the high part of the version, so the table even starts with the
+ * empty string.
+ */
+static void
+damage_strings_in_header(char *data, size_t *size)
+{
+	((struct quirks_index_header *)data)->strings = 5;
+}
+
+static void
+damage_strings_past_end(char *data, size_t *size)
+{
+	((struct quirks_index_header *)data)->strings = *size;
+}
+
+static void
+damage_nentries(char *data, size_t *size)
+{
+	((struct quirks_index_header *)data)->nentries += 1;
+}
+
+static void
+damage_huge_nentries(char *data, size_t *size)
+{
+	((struct quirks_index_header *)data)->nentries = UINT32_MAX;
+}
+
+static void
+damage_entry_offset(char *data, size_t *size)
+{
+	struct quirks_index_header *hdr = (struct quirks_index_header *)data;
+	struct quirks_index_entry *e = (struct quirks_index_entry *)(hdr + 1);
+
+	e->prop_value = *size - hdr->strings;
+}
+
+/* The binary search would miss entries in the wrong order */
+static void
+damage_order(char *data, size_t *size)
+{
+	struct quirks_index_header *hdr = (struct quirks_index_header *)data;
+	struct quirks_index_entry *e = (struct quirks_index_entry *)(hdr + 1);
+	struct quirks_index_entry tmp;
+
+	tmp = e[0];
+	e[0] = e[hdr->nentries - 1];
+	e[hdr->nentries - 1] = tmp;
+}
+
+static void
+log_handler(struct libinput *libinput, enum libinput_log_priority priority,
+	    const char *format, va_list args)
+{
+}
+
+static void
+test_validate(struct libinput *libinput, const char *path)
+{
+	static char data[65536];
+	size_t size;
+
+	size = read_file(path, data, sizeof(data));
+
+	/* Keep the errors about the refused databases quiet */
+	libinput_log_set_handler(libinput, log_handler);
+
+	open_damaged(libinput, data, size, damage_truncate);
+	open_damaged(libinput, data, size, damage_magic);
+	open_damaged(libinput, data, size, damage_strings_in_header);
+	open_damaged(libinput, data, size, damage_strings_past_end);
+	open_damaged(libinput, data, size, damage_nentries);
+	open_damaged(libinput, data, size, damage_huge_nentries);
+	open_damaged(libinput, data, size, damage_entry_offset);
+	open_damaged(libinput, data, size, damage_order);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct libinput *libinput;
+	const char *path = argc > 1 ? argv[1] : "test-quirks.idx";
+
+	libinput = test_create_context(LIBINPUT_EVENT_QUEUE_CONTEXT);
+
+	test_lookup(libinput, path);
+	test_validate(libinput, path);
+
+	libinput_unref(libinput);
+
+	printf("quirks: lookups and damaged indexes\n");
+
+	return 0;
+}
@@ -0,0 +1,118 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Tablet tools are looked up by (type, tool id, serial) on every
+ * proximity in. The lookup has to return the same tool for the same
+ * triple and a separate one for every other triple, including tools
+ * without a serial, and the hash has to spread a realistic set of
+ * tools over the buckets.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+#define NTYPES		7	/* LIBINPUT_TABLET_TOOL_TYPE_PEN to _LENS */
+#define NIDS		4
+#define NSERIALS	6	/* the last one is 0, no serial */
+#define NTOOLS		(NTYPES * NIDS * NSERIALS)
+
+extern struct libinput *test_create_context(enum libinput_event_queue_mode mode);
+
+static const uint32_t tool_ids[NIDS] = { 0x802, 0x80a, 0x902, 0x1806 };
+
+static uint32_t
+serial_of(int i)
+{
+	return i == NSERIALS - 1 ? 0 : 0x1a2b3c00 + i * 0x11;
+}
+
+int
+main(void)
+{
+	struct libinput *libinput;
+	struct libinput_tablet_tool *tools[NTYPES][NIDS][NSERIALS];
+	struct libinput_tablet_tool *tool, *held;
+	enum libinput_tablet_tool_type type;
+	int t, i, s, b, n, longest = 0;
+
+	libinput = test_create_context(LIBINPUT_EVENT_QUEUE_CONTEXT);
+
+	for (t = 0; t < NTYPES; t++) {
+		type = LIBINPUT_TABLET_TOOL_TYPE_PEN + t;
+		for (i = 0; i < NIDS; i++) {
+			for (s = 0; s < NSERIALS; s++) {
+				tool = tablet_tool_get(libinput, type,
+						       tool_ids[i],
+						       serial_of(s));
+				assert(tool != NULL);
+				assert(libinput_tablet_tool_get_type(tool) ==
+				       type);
+				assert(libinput_tablet_tool_get_tool_id(tool) ==
+				       tool_ids[i]);
+				assert(libinput_tablet_tool_get_serial(tool) ==
+				       serial_of(s));
+				tools[t][i][s] = tool;
+			}
+		}
+	}
+
+	/* Known tools come back, nothing new is created */
+	for (t = 0; t < NTYPES; t++) {
+		type = LIBINPUT_TABLET_TOOL_TYPE_PEN + t;
+		for (i = 0; i < NIDS; i++) {
+			for (s = 0; s < NSERIALS; s++) {
+				tool = tablet_tool_get(libinput, type,
+						       tool_ids[i],
+						       serial_of(s));
+				assert(tool == tools[t][i][s]);
+			}
+		}
+	}
+
+	n = 0;
+	for (b = 0; b < TABLET_TOOL_HASH_SIZE; b++) {
+		i = 0;
+		list_for_each(tool, &libinput->tool_hash[b], link)
+			i++;
+		n += i;
+		longest = max(longest, i);
+	}
+	/* Every triple got its own tool */
+	assert(n == NTOOLS);
+	/* An even spread is NTOOLS / TABLET_TOOL_HASH_SIZE, about 3 */
+	assert(longest <= 8);
+
+	/* A caller's reference outlives the context */
+	held = libinput_tablet_tool_ref(tools[0][0][0]);
+	libinput_unref(libinput);
+	assert(libinput_tablet_tool_get_serial(held) == serial_of(0));
+	held = libinput_tablet_tool_unref(held);
+	assert(held == NULL);
+
+	printf("tablet tools: %d tools, longest chain %d\n", NTOOLS, longest);
+
+	return 0;
+}
@@ -0,0 +1,398 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * A multitouch stream replayed through a pipe into the evdev backend. The
+ * device goes through the real probe, with test/fake-devattr.c reporting
+ * /dev/null as an evdev node and the pipe opened in its place. A pipe
+ * doesn't answer the evdev ioctls, so it is a touchscreen with 16 slots.
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "evdev.h"
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+
+extern void	fake_devattr_add(const char *devnode, const char *driver);
+
+#define NODE	"/dev/null"
+
+/* Write end of the pipe opened for the node last */
+static int wfd = -1;
+
+static int
+test_open_restricted(const char *path, int flags, void *user_data)
+{
+	int fds[2], rc;
+
+	rc = pipe(fds);
+	assert(rc == 0);
+	rc = fcntl(fds[0], F_SETFL, O_NONBLOCK);
+	assert(rc == 0);
+	wfd = fds[1];
+
+	return fds[0];
+}
+
+static void
+test_close_restricted(int fd, void *user_data)
+{
+	close(fd);
+}
+
+static const struct libinput_interface test_interface = {
+	.open_restricted = test_open_restricted,
+	.close_restricted = test_close_restricted,
+};
+
+static struct libinput_device *
+add_device(struct libinput *libinput)
+{
+	struct libinput_device *device;
+
+	device = libinput_path_add_device(libinput, NODE);
+	assert(device != NULL);
+	assert(libinput_device_has_capability(device,
+					      LIBINPUT_DEVICE_CAP_TOUCH));
+
+	return device;
+}
+
+/* Events of one report, terminated by a type of -1 */
+struct report {
+	uint16_t type, code;
+	int32_t value;
+};
+
+static void
+send_report(const struct report *r)
+{
+	struct input_event evs[16];
+	ssize_t len;
+	int n = 0;
+
+	for (; r->type != (uint16_t)-1; r++) {
+		assert(n < 16);
+		memset(&evs[n], 0, sizeof(evs[n]));
+		evs[n].type = r->type;
+		evs[n].code = r->code;
+		evs[n].value = r->value;
+		n++;
+	}
+	len = write(wfd, evs, n * sizeof(evs[0]));
+	assert(len == (ssize_t)(n * sizeof(evs[0])));
+}
+
+#define DOWN(slot, id, x, y) \
+	{ EV_ABS, ABS_MT_SLOT, slot }, \
+	{ EV_ABS, ABS_MT_TRACKING_ID, id }, \
+	{ EV_ABS, ABS_MT_POSITION_X, x }, \
+	{ EV_ABS, ABS_MT_POSITION_Y, y }
+#define MOVE(slot, x, y) \
+	{ EV_ABS, ABS_MT_SLOT, slot }, \
+	{ EV_ABS, ABS_MT_POSITION_X, x }, \
+	{ EV_ABS, ABS_MT_POSITION_Y, y }
+#define UP(slot) \
+	{ EV_ABS, ABS_MT_SLOT, slot }, \
+	{ EV_ABS, ABS_MT_TRACKING_ID, -1 }
+#define SYN	{ EV_SYN, SYN_REPORT, 0 }, { (uint16_t)-1, 0, 0 }
+
+/* Returns the seat slot, or -1 for a frame */
+static int
+expect_touch(struct libinput *libinput, enum libinput_event_type type,
+	     int slot)
+{
+	struct libinput_event *event;
+	struct libinput_event_touch *tev;
+	int seat_slot = -1;
+
+	event = libinput_get_event(libinput);
+	assert(event != NULL);
+	assert(libinput_event_get_type(event) == type);
+	if (type != LIBINPUT_EVENT_TOUCH_FRAME) {
+		tev = libinput_event_get_touch_event(event);
+		assert(libinput_event_touch_get_slot(tev) == slot);
+		seat_slot = libinput_event_touch_get_seat_slot(tev);
+	}
+	libinput_event_destroy(event);
+
+	return seat_slot;
+}
+
+static void
+expect_none(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
+	event = libinput_get_event(libinput);
+	assert(event == NULL);
+}
+
+static void
+test_order(struct libinput *libinput)
+{
+	const struct report down[] = { DOWN(0, 10, 100, 200), SYN };
+	const struct report move[] = { MOVE(0, 110, 220), SYN };
+	const struct report up[] = { UP(0), SYN };
+	struct libinput_device *device;
+	struct libinput_event *event;
+	struct libinput_event_touch *tev;
+	int seat_slot;
+
+	device = add_device(libinput);
+
+	send_report(down);
+	libinput_dispatch(libinput);
+	event = libinput_get_event(libinput);
+	assert(libinput_event_get_type(event) == LIBINPUT_EVENT_TOUCH_DOWN);
+	tev = libinput_event_get_touch_event(event);
+	assert(libinput_event_touch_get_slot(tev) == 0);
+	seat_slot = libinput_event_touch_get_seat_slot(tev);
+	assert(seat_slot == 0);
+	assert(fabs(libinput_event_touch_get_x_transformed(tev, 0x10000) -
+		    100) < 0.5);
+	assert(fabs(libinput_event_touch_get_y_transformed(tev, 0x10000) -
+		    200) < 0.5);
+	libinput_event_destroy(event);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+	expect_none(libinput);
+
+	send_report(move);
+	libinput_dispatch(libinput);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_MOTION, 0);
+	assert(seat_slot == 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+	expect_none(libinput);
+
+	send_report(up);
+	libinput_dispatch(libinput);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_UP, 0);
+	assert(seat_slot == 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+	expect_none(libinput);
+
+	libinput_path_remove_device(device);
+	close(wfd);
+	libinput_dispatch(libinput);
+	expect_none(libinput);
+}
+
+/* The seat slot of a lifted contact goes to the next one down */
+static void
+test_slot_reuse(struct libinput *libinput)
+{
+	const struct report two[] = {
+		DOWN(0, 20, 100, 100), DOWN(1, 21, 200, 200), SYN
+	};
+	const struct report swap[] = { UP(0), DOWN(2, 22, 300, 300), SYN };
+	const struct report up[] = { UP(1), UP(2), SYN };
+	struct libinput_device *device;
+	int seat_slot;
+
+	device = add_device(libinput);
+
+	send_report(two);
+	libinput_dispatch(libinput);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_DOWN, 0);
+	assert(seat_slot == 0);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_DOWN, 1);
+	assert(seat_slot == 1);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+
+	/* Up and down in one report, the up comes first */
+	send_report(swap);
+	libinput_dispatch(libinput);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_UP, 0);
+	assert(seat_slot == 0);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_DOWN, 2);
+	assert(seat_slot == 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+
+	send_report(up);
+	libinput_dispatch(libinput);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_UP, 1);
+	assert(seat_slot == 1);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_UP, 2);
+	assert(seat_slot == 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+	expect_none(libinput);
+
+	libinput_path_remove_device(device);
+	close(wfd);
+	libinput_dispatch(libinput);
+	expect_none(libinput);
+}
+
+/*
+ * After SYN_DROPPED the rest of the report is discarded and the contacts
+ * are resynced. A pipe can't be asked for its slots, so they all end.
+ */
+static void
+test_resync(struct libinput *libinput)
+{
+	const struct report down[] = { DOWN(0, 30, 100, 100), SYN };
+	const struct report dropped[] = {
+		{ EV_SYN, SYN_DROPPED, 0 },
+		MOVE(0, 150, 150),
+		UP(0),
+		SYN
+	};
+	const struct report again[] = { DOWN(0, 31, 120, 120), SYN };
+	const struct report up[] = { UP(0), SYN };
+	struct libinput_device *device;
+	int seat_slot;
+
+	device = add_device(libinput);
+
+	send_report(down);
+	libinput_dispatch(libinput);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_DOWN, 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+
+	send_report(dropped);
+	libinput_dispatch(libinput);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_UP, 0);
+	assert(seat_slot == 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+	expect_none(libinput);
+
+	/* Back in step with the next report */
+	send_report(again);
+	libinput_dispatch(libinput);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_DOWN, 0);
+	assert(seat_slot == 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+
+	send_report(up);
+	libinput_dispatch(libinput);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_UP, 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+	expect_none(libinput);
+
+	libinput_path_remove_device(device);
+	close(wfd);
+	libinput_dispatch(libinput);
+	expect_none(libinput);
+}
+
+/*
+ * A device removed or unplugged with a contact down lifts it, so the seat
+ * slot is free for the next device.
+ */
+static void
+test_remove_down(struct libinput *libinput)
+{
+	const struct report down[] = { DOWN(0, 40, 100, 100), SYN };
+	const struct report up[] = { UP(0), SYN };
+	struct libinput_device *device;
+	struct libinput_event *event;
+	int seat_slot;
+
+	device = add_device(libinput);
+	send_report(down);
+	libinput_dispatch(libinput);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_DOWN, 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+
+	libinput_path_remove_device(device);
+	close(wfd);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_UP, 0);
+	assert(seat_slot == 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+	libinput_dispatch(libinput);
+	expect_none(libinput);
+
+	/* Unplugged: the pipe's writer goes away with the contact down */
+	device = add_device(libinput);
+	send_report(down);
+	libinput_dispatch(libinput);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_DOWN, 0);
+	assert(seat_slot == 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+
+	close(wfd);
+	libinput_dispatch(libinput);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_UP, 0);
+	assert(seat_slot == 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+	event = libinput_get_event(libinput);
+	assert(event != NULL);
+	assert(libinput_event_get_type(event) ==
+	       LIBINPUT_EVENT_DEVICE_REMOVED);
+	libinput_event_destroy(event);
+	expect_none(libinput);
+
+	/* Both times the seat slot was given back */
+	device = add_device(libinput);
+	send_report(down);
+	libinput_dispatch(libinput);
+	seat_slot = expect_touch(libinput, LIBINPUT_EVENT_TOUCH_DOWN, 0);
+	assert(seat_slot == 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+	send_report(up);
+	libinput_dispatch(libinput);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_UP, 0);
+	expect_touch(libinput, LIBINPUT_EVENT_TOUCH_FRAME, 0);
+
+	libinput_path_remove_device(device);
+	close(wfd);
+	libinput_dispatch(libinput);
+	expect_none(libinput);
+}
+
+int
+main(void)
+{
+	struct libinput *libinput;
+	struct libinput_device *device;
+	struct libinput_seat *seat;
+
+	fake_devattr_add(NODE, "evdev");
+
+	libinput = libinput_path_create_context(&test_interface, NULL);
+	assert(libinput != NULL);
+
+	/* Keep the seat, and its slots, across the devices */
+	device = add_device(libinput);
+	seat = libinput_seat_ref(libinput_device_get_seat(device));
+	libinput_path_remove_device(device);
+	close(wfd);
+	libinput_dispatch(libinput);
+
+	test_order(libinput);
+	test_slot_reuse(libinput);
+	test_resync(libinput);
+	test_remove_down(libinput);
+
+	libinput_seat_unref(seat);
+	libinput_unref(libinput);
+
+	printf("touch: order, slot reuse, resync and removal\n");
+
+	return 0;
+}
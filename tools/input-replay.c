@@ -0,0 +1,813 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Feeds synthetic input through the backends and reports what it costs
+ * or how well it does, without the hardware.
+ *
+ * usage: input-replay [-n count] [-q context|seat|device] mode
+ *
+ *	evdev		relative motion frames through a pipe into evdev.c
+ *	sysmouse	level 1 packets through a pipe into sysmouse.c
+ *	predict		evdev motion at 125Hz, the error of
+ *			libinput_device_pointer_predict_motion() against
+ *			the motion that follows
+ *	gesture		2 to 5 finger swipes and pinches through gesture.c
+ *	filter		filter_dispatch() of the acceleration filters
+ *	kbdev		scancode parsing in kbdev.c, from a buffer filled
+ *			with kbdev_push_scancodes() instead of a tty
+ *	epoch		motion events through a device queue to a consumer
+ *			thread, with the device lifetime kept by the queue
+ *			epochs and with a device reference taken and
+ *			dropped per event as before them. Always uses
+ *			device queues.
+ *
+ * Pipes have no devattr entry, so the devices are set up the way
+ * dragonfly.c commits them, without the probe. kbdev needs KDSKBMODE on
+ * its fd, so it is measured without one.
+ */
+
+#include <err.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "evdev.h"
+#include "libinput.h"
+#include "libinput-util.h"
+#include "libinput-private.h"
+#include "filter.h"
+#include "gesture.h"
+#include "kbdev.h"
+
+extern const struct libinput_device_interface sysmouse_interface;
+extern const struct libinput_device_interface evdev_interface;
+extern void	libinput_seat_init(struct libinput_seat *seat,
+		    struct libinput *libinput, const char *physical_name,
+		    const char *logical_name);
+
+/* Frames or packets written before each libinput_dispatch() */
+#define BATCH		64
+/* 125Hz, a common mouse report rate */
+#define INTERVAL	8000
+
+static enum libinput_event_queue_mode queue_mode = LIBINPUT_EVENT_QUEUE_CONTEXT;
+static long count = 1000000;
+
+static int
+replay_open_restricted(const char *path, int flags, void *user_data)
+{
+	return -1;
+}
+
+static void
+replay_close_restricted(int fd, void *user_data)
+{
+	close(fd);
+}
+
+static const struct libinput_interface replay_interface = {
+	.open_restricted = replay_open_restricted,
+	.close_restricted = replay_close_restricted,
+};
+
+static uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static struct libinput *
+replay_create_context(void)
+{
+	struct libinput *libinput;
+
+	libinput = libinput_path_create_context(&replay_interface, NULL);
+	if (libinput == NULL)
+		errx(1, "failed to create a context");
+	if (libinput_set_event_queue_mode(libinput, queue_mode) != 0)
+		errx(1, "failed to set the queue mode");
+
+	return libinput;
+}
+
+static struct libinput_seat *
+replay_seat_get(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+
+	if (!list_empty(&libinput->seat_list)) {
+		seat = container_of(libinput->seat_list.next, seat, link);
+		libinput_seat_ref(seat);
+		return seat;
+	}
+
+	seat = calloc(1, sizeof(*seat));
+	if (seat == NULL)
+		err(1, "calloc");
+	libinput_seat_init(seat, libinput, "seat0", "default");
+
+	return seat;
+}
+
+/*
+ * The read end of a new pipe becomes the device, as dragonfly.c commits
+ * it. The write end is returned in wfd.
+ */
+static struct libinput_device *
+replay_add_device(struct libinput *libinput,
+		  const struct libinput_device_interface *interface, int *wfd)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+	int fds[2];
+
+	if (pipe(fds) == -1)
+		err(1, "pipe");
+	if (fcntl(fds[0], F_SETFL, O_NONBLOCK) == -1)
+		err(1, "fcntl");
+
+	device = calloc(1, sizeof(*device));
+	if (device == NULL)
+		err(1, "calloc");
+
+	seat = replay_seat_get(libinput);
+	libinput_device_init(device, seat);
+
+	device->fd = fds[0];
+	device->devname = "replay";
+	device->interface = interface;
+	device->sendevents_mode = LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+
+	if (interface->init(device) != 0)
+		errx(1, "failed to initialize the device");
+
+	device->source = libinput_add_fd(libinput, device->fd,
+	    interface->dispatch, device);
+	if (device->source == NULL)
+		errx(1, "failed to add the device's fd");
+
+	if (interface->init_accel &&
+	    interface->init_accel(device,
+	    LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE) == -1)
+		errx(1, "failed to initialize pointer acceleration");
+
+	list_insert(&seat->devices_list, &device->link);
+	notify_added_device(device);
+
+	*wfd = fds[1];
+	return device;
+}
+
+/* A device without an fd, for the code that is driven directly */
+static struct libinput_device *
+replay_add_memory_device(struct libinput *libinput, uint32_t caps)
+{
+	struct libinput_seat *seat;
+	struct libinput_device *device;
+
+	device = calloc(1, sizeof(*device));
+	if (device == NULL)
+		err(1, "calloc");
+
+	seat = replay_seat_get(libinput);
+	libinput_device_init(device, seat);
+	device->fd = -1;
+	device->devname = "replay";
+	device->caps = caps;
+	device->sendevents_mode = LIBINPUT_CONFIG_SEND_EVENTS_ENABLED;
+	list_insert(&seat->devices_list, &device->link);
+	notify_added_device(device);
+
+	return device;
+}
+
+static struct libinput_event *
+replay_get_event(struct libinput *libinput, struct libinput_device *device)
+{
+	struct libinput_event *event;
+
+	/* Added and removed events stay on the context in any mode */
+	event = libinput_get_event(libinput);
+	if (event != NULL)
+		return event;
+
+	switch (queue_mode) {
+	case LIBINPUT_EVENT_QUEUE_SEAT:
+		return libinput_seat_get_event(libinput_device_get_seat(device));
+	case LIBINPUT_EVENT_QUEUE_DEVICE:
+		return libinput_device_get_event(device);
+	default:
+		return NULL;
+	}
+}
+
+/* Returns the number of events of the given type */
+static long
+replay_drain(struct libinput *libinput, struct libinput_device *device,
+	     enum libinput_event_type type)
+{
+	struct libinput_event *event;
+	long n = 0;
+
+	while ((event = replay_get_event(libinput, device)) != NULL) {
+		if (libinput_event_get_type(event) == type)
+			n++;
+		libinput_event_destroy(event);
+	}
+
+	return n;
+}
+
+static void
+replay_remove_device(struct libinput *libinput,
+		     struct libinput_device *device, int wfd)
+{
+	struct libinput_event *event;
+
+	/* Before the write end goes, EOF would remove the device as lost */
+	if (device->fd != -1) {
+		libinput_path_remove_device(device);
+	} else {
+		device->removed = true;
+		libinput_device_unref(device);
+	}
+	if (wfd != -1)
+		close(wfd);
+
+	/* The device may be gone now, only its removed event is left */
+	libinput_dispatch(libinput);
+	while ((event = libinput_get_event(libinput)) != NULL)
+		libinput_event_destroy(event);
+}
+
+static void
+write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	ssize_t n;
+
+	while (len > 0) {
+		n = write(fd, p, len);
+		if (n == -1)
+			err(1, "write");
+		p += n;
+		len -= n;
+	}
+}
+
+static void
+report(const char *what, long n, long received, uint64_t elapsed)
+{
+	printf("%-24s %10ld sent %10ld received %8.1f ns/event %10.0f events/s\n",
+	       what, n, received, (double)elapsed / n,
+	       n * 1e9 / elapsed);
+}
+
+static void
+set_input_event(struct input_event *ev, uint64_t time,
+		uint16_t type, uint16_t code, int32_t value)
+{
+	ev->time.tv_sec = time / 1000000;
+	ev->time.tv_usec = time % 1000000;
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+}
+
+/* One motion frame, REL_X, REL_Y and SYN_REPORT */
+static void
+set_motion_frame(struct input_event *evs, uint64_t time, int dx, int dy)
+{
+	set_input_event(&evs[0], time, EV_REL, REL_X, dx);
+	set_input_event(&evs[1], time, EV_REL, REL_Y, dy);
+	set_input_event(&evs[2], time, EV_SYN, SYN_REPORT, 0);
+}
+
+static void
+replay_evdev(void)
+{
+	struct libinput *libinput;
+	struct libinput_device *device;
+	struct input_event evs[BATCH * 3];
+	uint64_t start, time = INTERVAL;
+	long sent, received = 0;
+	int wfd, i, n;
+
+	libinput = replay_create_context();
+	device = replay_add_device(libinput, &evdev_interface, &wfd);
+	replay_drain(libinput, device, LIBINPUT_EVENT_NONE);
+
+	start = now_ns();
+	for (sent = 0; sent < count; sent += n) {
+		n = min(BATCH, count - sent);
+		for (i = 0; i < n; i++) {
+			set_motion_frame(&evs[i * 3], time, i % 7 - 3, i % 5 + 1);
+			time += INTERVAL;
+		}
+		write_all(wfd, evs, n * 3 * sizeof(evs[0]));
+		libinput_dispatch(libinput);
+		received += replay_drain(libinput, device,
+					 LIBINPUT_EVENT_POINTER_MOTION);
+	}
+	report("evdev motion", count, received, now_ns() - start);
+
+	replay_remove_device(libinput, device, wfd);
+	libinput_unref(libinput);
+}
+
+/* A level 1 packet, the deltas are split over both halves */
+static void
+set_sysmouse_packet(char *pkt, int dx, int dy)
+{
+	pkt[0] = 0x80 | 0x07;		/* no buttons, bits are inverted */
+	pkt[1] = dx / 2;
+	pkt[2] = -dy / 2;
+	pkt[3] = dx - dx / 2;
+	pkt[4] = -dy - -dy / 2;
+	pkt[5] = 0;
+	pkt[6] = 0;
+	pkt[7] = 0x7f;			/* no extended buttons */
+}
+
+static void
+replay_sysmouse(void)
+{
+	struct libinput *libinput;
+	struct libinput_device *device;
+	char pkts[BATCH * 8];
+	uint64_t start;
+	long sent, received = 0;
+	int wfd, i, n;
+
+	libinput = replay_create_context();
+	device = replay_add_device(libinput, &sysmouse_interface, &wfd);
+	replay_drain(libinput, device, LIBINPUT_EVENT_NONE);
+
+	start = now_ns();
+	for (sent = 0; sent < count; sent += n) {
+		n = min(BATCH, count - sent);
+		for (i = 0; i < n; i++)
+			set_sysmouse_packet(&pkts[i * 8], i % 7 - 3, i % 5 + 1);
+		write_all(wfd, pkts, n * 8);
+		libinput_dispatch(libinput);
+		received += replay_drain(libinput, device,
+					 LIBINPUT_EVENT_POINTER_MOTION);
+	}
+	report("sysmouse motion", count, received, now_ns() - start);
+
+	replay_remove_device(libinput, device, wfd);
+	libinput_unref(libinput);
+}
+
+/*
+ * One frame per dispatch on a circle of changing speed. After each frame
+ * the motion one interval ahead is predicted and compared to the motion
+ * of the next frame. No prediction at all is the baseline.
+ */
+static void
+replay_predict(void)
+{
+	static const double dampings[] = { 1.0, 0.8, 0.5 };
+	struct libinput *libinput;
+	struct libinput_device *device;
+	struct libinput_event *event;
+	struct libinput_event_pointer *pev;
+	struct input_event evs[3];
+	double pred_x[ARRAY_LENGTH(dampings)], pred_y[ARRAY_LENGTH(dampings)];
+	double err[ARRAY_LENGTH(dampings)] = { 0.0 };
+	double dx, dy, len = 0.0, angle, speed;
+	uint64_t time = INTERVAL;
+	bool have_pred = false;
+	long i, n = 0;
+	size_t d;
+	int wfd;
+
+	libinput = replay_create_context();
+	device = replay_add_device(libinput, &evdev_interface, &wfd);
+	replay_drain(libinput, device, LIBINPUT_EVENT_NONE);
+
+	for (i = 0; i < count; i++) {
+		angle = i * 0.05;
+		speed = 6.0 + 5.0 * sin(i * 0.013);
+		set_motion_frame(evs, time, lround(speed * cos(angle)),
+				 lround(speed * sin(angle)));
+		write_all(wfd, evs, sizeof(evs));
+		libinput_dispatch(libinput);
+
+		dx = dy = 0.0;
+		while ((event = replay_get_event(libinput, device)) != NULL) {
+			if (libinput_event_get_type(event) ==
+			    LIBINPUT_EVENT_POINTER_MOTION) {
+				pev = libinput_event_get_pointer_event(event);
+				dx += libinput_event_pointer_get_dx(pev);
+				dy += libinput_event_pointer_get_dy(pev);
+			}
+			libinput_event_destroy(event);
+		}
+
+		if (have_pred) {
+			len += hypot(dx, dy);
+			for (d = 0; d < ARRAY_LENGTH(dampings); d++)
+				err[d] += hypot(dx - pred_x[d], dy - pred_y[d]);
+			n++;
+		}
+
+		for (d = 0; d < ARRAY_LENGTH(dampings); d++) {
+			if (libinput_device_pointer_predict_motion(device,
+			    time + INTERVAL, dampings[d],
+			    &pred_x[d], &pred_y[d]) != 0)
+				errx(1, "the device can't predict motion");
+		}
+		have_pred = true;
+		time += INTERVAL;
+	}
+
+	if (n == 0 || len == 0.0)
+		errx(1, "no motion to compare");
+
+	/* Errors relative to the mean motion of a frame */
+	printf("%ld frames, mean motion %.2f\n", n, len / n);
+	printf("no prediction      error %.3f\n", 1.0);
+	for (d = 0; d < ARRAY_LENGTH(dampings); d++)
+		printf("damping %.1f        error %.3f\n",
+		       dampings[d], err[d] / len);
+
+	replay_remove_device(libinput, device, wfd);
+	libinput_unref(libinput);
+}
+
+/* 40 units/mm */
+static const struct device_abs pad = {
+	.max_x = 4000, .res_x = 40,
+	.max_y = 3000, .res_y = 40,
+};
+
+static void
+replay_gesture_fingers(struct libinput *libinput,
+		       struct libinput_device *device, int fingers, bool pinch)
+{
+	struct gesture g;
+	struct device_coords p;
+	uint64_t start, time = INTERVAL;
+	long f, received = 0;
+	char what[32];
+	int i, step;
+
+	gesture_init(&g, &pad);
+
+	start = now_ns();
+	for (f = 0; f < count; f++) {
+		/* Back and forth, lift the fingers now and then */
+		step = f % 200 < 100 ? f % 100 : 100 - f % 100;
+		for (i = 0; i < fingers; i++) {
+			if (pinch) {
+				p.x = 2000 + (i - fingers / 2) * (200 + step * 5);
+				p.y = 1500 + (i % 2) * (200 + step * 5);
+			} else {
+				p.x = 1000 + i * 300 + step * 10;
+				p.y = 1000 + step * 5;
+			}
+			if (f % 1000 == 0)
+				gesture_contact_down(&g, i, &p);
+			else if (f % 1000 == 999)
+				gesture_contact_up(&g, i);
+			else
+				gesture_contact_move(&g, i, &p);
+		}
+		gesture_frame(device, &g, time);
+		time += INTERVAL;
+
+		if (f % BATCH == BATCH - 1)
+			received += replay_drain(libinput, device,
+			    pinch ? LIBINPUT_EVENT_GESTURE_PINCH_UPDATE :
+			    LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE);
+	}
+	received += replay_drain(libinput, device,
+	    pinch ? LIBINPUT_EVENT_GESTURE_PINCH_UPDATE :
+	    LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE);
+
+	snprintf(what, sizeof(what), "%d finger %s", fingers,
+		 pinch ? "pinch" : "swipe");
+	report(what, count, received, now_ns() - start);
+}
+
+static void
+replay_gesture(void)
+{
+	struct libinput *libinput;
+	struct libinput_device *device;
+	int fingers;
+
+	libinput = replay_create_context();
+	device = replay_add_memory_device(libinput,
+	    DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_POINTER) |
+	    DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_GESTURE));
+	replay_drain(libinput, device, LIBINPUT_EVENT_NONE);
+
+	for (fingers = 2; fingers <= 5; fingers++) {
+		replay_gesture_fingers(libinput, device, fingers, false);
+		replay_gesture_fingers(libinput, device, fingers, true);
+	}
+
+	replay_remove_device(libinput, device, -1);
+	libinput_unref(libinput);
+}
+
+typedef struct motion_filter *(*create_filter_t)(int dpi);
+
+static void
+replay_filter_one(const char *what, create_filter_t create)
+{
+	struct motion_filter *filter;
+	struct normalized_coords in, out;
+	uint64_t start, time = INTERVAL;
+	double sum = 0.0;
+	long i;
+
+	/* As a device sets it up, flat has no factor before the speed */
+	filter = create(DEFAULT_MOUSE_DPI);
+	if (filter == NULL || !filter_set_speed(filter, 0.0))
+		errx(1, "failed to create the %s filter", what);
+
+	start = now_ns();
+	for (i = 0; i < count; i++) {
+		/* A pause now and then resets the velocity */
+		time += i % 500 == 0 ? 1000000 : INTERVAL;
+		in.x = i % 21 - 10;
+		in.y = i % 13 - 6;
+		out = filter_dispatch(filter, &in, NULL, time);
+		sum += fabs(out.x) + fabs(out.y);
+	}
+	/* The sum keeps the compiler from dropping the loop */
+	report(what, count, sum != 0.0 ? count : 0, now_ns() - start);
+
+	filter_destroy(filter);
+}
+
+static void
+replay_filter(void)
+{
+	replay_filter_one("linear", create_pointer_accelerator_filter_linear);
+	replay_filter_one("flat", create_pointer_accelerator_filter_flat);
+#ifdef LIBINPUT_FIXED_ACCEL
+	replay_filter_one("linear fixed",
+			  create_pointer_accelerator_filter_linear_fixed);
+	replay_filter_one("flat fixed",
+			  create_pointer_accelerator_filter_flat_fixed);
+#endif
+}
+
+/* A press and a release of every key in turn, the same for every run */
+static void
+set_scancodes(uint8_t *codes, size_t len)
+{
+	size_t i;
+	uint8_t key;
+
+	for (i = 0; i < len; i++) {
+		key = 1 + i / 2 % 0x6c;
+		codes[i] = i % 2 == 0 ? key : key | 0x80;
+	}
+}
+
+/* Events are taken want at a time, as a caller would */
+static void
+replay_kbdev_one(const uint8_t *codes, size_t len, int want)
+{
+	struct kbdev_state *state;
+	struct kbdev_event evs[64];
+	uint64_t start;
+	long sent, received = 0;
+	size_t off;
+	char what[32];
+	int n;
+
+	state = kbdev_new_state(-1);
+	if (state == NULL)
+		errx(1, "failed to create the kbdev state");
+
+	start = now_ns();
+	for (sent = 0; sent < count; sent += len) {
+		off = 0;
+		while (off < len) {
+			off += kbdev_push_scancodes(state, &codes[off],
+						    len - off);
+			while (kbdev_buffered(state) > 0) {
+				n = kbdev_read_events(state, evs, want);
+				if (n < 0)
+					errx(1, "kbdev_read_events failed");
+				received += n;
+			}
+		}
+	}
+	snprintf(what, sizeof(what), "kbdev %d per call", want);
+	report(what, sent, received, now_ns() - start);
+
+	kbdev_destroy_state(state);
+}
+
+static void
+replay_kbdev(void)
+{
+	uint8_t codes[4096];
+
+	set_scancodes(codes, sizeof(codes));
+	replay_kbdev_one(codes, sizeof(codes), 1);
+	replay_kbdev_one(codes, sizeof(codes), 8);
+	replay_kbdev_one(codes, sizeof(codes), 64);
+}
+
+struct epoch_consumer {
+	struct libinput_device *device;
+	bool refs;
+	long count;
+	long consumed;		/* updated every BATCH events */
+};
+
+static void *
+epoch_consume(void *data)
+{
+	struct epoch_consumer *c = data;
+	struct libinput_event *event;
+	struct pollfd fds;
+	long n = 0;
+
+	fds.fd = libinput_device_get_fd(c->device);
+	fds.events = POLLIN;
+
+	while (n < c->count) {
+		event = libinput_device_get_event(c->device);
+		if (event == NULL) {
+			poll(&fds, 1, -1);
+			continue;
+		}
+		libinput_event_destroy(event);
+		if (c->refs)
+			libinput_device_unref(c->device);
+		if (++n % BATCH == 0)
+			__atomic_store_n(&c->consumed, n, __ATOMIC_RELEASE);
+	}
+
+	return NULL;
+}
+
+/*
+ * The dispatching thread posts, a second thread takes and destroys. With
+ * refs, each event also takes a device reference that the consumer drops,
+ * the two writes to the device per event that the epochs replaced. They
+ * only cost anything with the threads on different CPUs.
+ */
+static void
+replay_epoch_one(const char *what, bool refs)
+{
+	struct libinput *libinput;
+	struct libinput_device *device;
+	struct epoch_consumer c;
+	const struct normalized_coords delta = { 1.0, 1.0 };
+	const struct device_float_coords raw = { 1.0, 1.0 };
+	pthread_t thread;
+	uint64_t start, time = INTERVAL;
+	long sent;
+	int i, n;
+
+	libinput = replay_create_context();
+	device = replay_add_memory_device(libinput,
+	    DEVICE_CAP_BIT(LIBINPUT_DEVICE_CAP_POINTER));
+	replay_drain(libinput, device, LIBINPUT_EVENT_NONE);
+
+	c.device = device;
+	c.refs = refs;
+	c.count = count;
+	c.consumed = 0;
+	if (pthread_create(&thread, NULL, epoch_consume, &c) != 0)
+		errx(1, "pthread_create failed");
+
+	start = now_ns();
+	for (sent = 0; sent < count; sent += n) {
+		/* Stay below the queue size, a full queue drops and logs */
+		while (sent - __atomic_load_n(&c.consumed, __ATOMIC_ACQUIRE) >
+		       256)
+			sched_yield();
+		n = min(BATCH, count - sent);
+		for (i = 0; i < n; i++) {
+			if (refs)
+				libinput_device_ref(device);
+			pointer_notify_motion(device, time, &delta, &raw);
+			time += INTERVAL;
+		}
+	}
+	pthread_join(thread, NULL);
+	report(what, count, count, now_ns() - start);
+
+	replay_remove_device(libinput, device, -1);
+	libinput_unref(libinput);
+}
+
+static void
+replay_epoch(void)
+{
+	queue_mode = LIBINPUT_EVENT_QUEUE_DEVICE;
+	replay_epoch_one("per-event ref/unref", true);
+	replay_epoch_one("epochs", false);
+}
+
+static const struct {
+	const char *name;
+	void (*run)(void);
+} modes[] = {
+	{ "evdev", replay_evdev },
+	{ "sysmouse", replay_sysmouse },
+	{ "predict", replay_predict },
+	{ "gesture", replay_gesture },
+	{ "filter", replay_filter },
+	{ "kbdev", replay_kbdev },
+	{ "epoch", replay_epoch },
+};
+
+static void
+usage(void)
+{
+	size_t i;
+
+	fprintf(stderr, "usage: input-replay [-n count] "
+		"[-q context|seat|device] mode\n");
+	fprintf(stderr, "modes:");
+	for (i = 0; i < ARRAY_LENGTH(modes); i++)
+		fprintf(stderr, " %s", modes[i].name);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+	char *end;
+	size_t i;
+	int ch;
+
+	while ((ch = getopt(argc, argv, "n:q:")) != -1) {
+		switch (ch) {
+		case 'n':
+			count = strtol(optarg, &end, 10);
+			if (*end != '\0' || count <= 0)
+				usage();
+			break;
+		case 'q':
+			if (streq(optarg, "context"))
+				queue_mode = LIBINPUT_EVENT_QUEUE_CONTEXT;
+			else if (streq(optarg, "seat"))
+				queue_mode = LIBINPUT_EVENT_QUEUE_SEAT;
+			else if (streq(optarg, "device"))
+				queue_mode = LIBINPUT_EVENT_QUEUE_DEVICE;
+			else
+				usage();
+			break;
+		default:
+			usage();
+		}
+	}
+	argc -= optind;
+	argv += optind;
+
+	if (argc != 1)
+		usage();
+
+	for (i = 0; i < ARRAY_LENGTH(modes); i++) {
+		if (streq(argv[0], modes[i].name)) {
+			modes[i].run();
+			return 0;
+		}
+	}
+	usage();
+
+	return 1;
+}